@@ -0,0 +1,291 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_rmt.h"
+#include "led_strip_spi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set RGB for a specific pixel
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ *
+ * @return
+ *      - ESP_OK: Set RGB for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGB for a specific pixel failed because of invalid parameters
+ *      - ESP_FAIL: Set RGB for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+
+/**
+ * @brief Set RGBW for a specific pixel
+ *
+ * @note Only call this function if your led strip does have the white component (e.g. SK6812-RGBW)
+ * @note Also see `led_strip_set_pixel` if you only want to specify the RGB part of the color and bypass the white component
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ * @param white: separate white component
+ *
+ * @return
+ *      - ESP_OK: Set RGBW color for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGBW color for a specific pixel failed because of an invalid argument
+ *      - ESP_FAIL: Set RGBW color for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
+/**
+ * @brief Set HSV for a specific pixel
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param hue: hue part of color (0 - 360)
+ * @param saturation: saturation part of color (0 - 255, rescaled from 0 - 1. e.g. saturation = 0.5, rescaled to 127)
+ * @param value: value part of color (0 - 255, rescaled from 0 - 1. e.g. value = 0.5, rescaled to 127)
+ *
+ * @return
+ *      - ESP_OK: Set HSV color for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set HSV color for a specific pixel failed because of an invalid argument
+ *      - ESP_FAIL: Set HSV color for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value);
+
+/**
+ * @brief Set a span of consecutive pixels from an RGB array
+ *
+ * @note Much faster than calling `led_strip_set_pixel` in a loop: the arguments are checked and
+ *       the color component order is resolved once for the whole span.
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel
+ * @param count: number of pixels
+ * @param rgb: `count` pixels of 3 bytes each, in R-G-B order (white component set to 0 on RGBW strips)
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Span out of the strip or invalid argument
+ */
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *rgb);
+
+/**
+ * @brief Set a span of consecutive pixels from an RGBW array
+ *
+ * @note Only call this function if your led strip does have the white component (e.g. SK6812-RGBW)
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel
+ * @param count: number of pixels
+ * @param rgbw: `count` pixels of 4 bytes each, in R-G-B-W order
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Span out of the strip, invalid argument or strip without white component
+ */
+esp_err_t led_strip_set_pixels_rgbw(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *rgbw);
+
+/**
+ * @brief Set a span of consecutive pixels to the same RGB color
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel
+ * @param count: number of pixels
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Span out of the strip or invalid argument
+ */
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t start, uint32_t count, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief Set a span of consecutive pixels to a linear RGB gradient
+ *
+ * The first pixel gets the `from` color and the last pixel the `to` color.
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel
+ * @param count: number of pixels
+ * @param from: start color, 3 bytes in R-G-B order
+ * @param to: end color, 3 bytes in R-G-B order
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Span out of the strip or invalid argument
+ */
+esp_err_t led_strip_set_gradient(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t from[3], const uint8_t to[3]);
+
+/**
+ * @brief Set a span of consecutive pixels from HSV colors
+ *
+ * The conversion uses integer math only, in chunks on the stack.
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel
+ * @param count: number of pixels
+ * @param hsv: `count` HSV colors
+ *
+ * @return
+ *      - ESP_OK: Set the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Span out of the strip or invalid argument
+ */
+esp_err_t led_strip_set_pixels_hsv(led_strip_handle_t strip, uint32_t start, uint32_t count, const led_strip_hsv_t *hsv);
+
+/**
+ * @brief Convert HSV colors to R-G-B bytes, with integer math only
+ *
+ * @param hsv: `count` HSV colors
+ * @param rgb: output, 3 bytes per color in R-G-B order
+ * @param count: number of colors
+ */
+void led_strip_hsv_to_rgb(const led_strip_hsv_t *hsv, uint8_t *rgb, uint32_t count);
+
+/**
+ * @brief Set the brightness and gamma correction applied by the strip to every color component
+ *
+ * Both are folded into one 256-entry table, built once here: `out = brightness * (in / 255) ^ gamma`.
+ * The backend applies it where it already touches every byte, so the correction costs nothing per pixel:
+ * - RMT backend and SPI streaming mode: on the whole frame at the next refresh
+ * - SPI backend: in the byte encoding table; the frame already drawn is re-encoded by this call
+ *
+ * @param strip: LED strip
+ * @param brightness: global brightness, 255 for full brightness
+ * @param gamma: gamma exponent, 1.0 for linear output (2.2 ~ 2.8 is usual for WS2812)
+ *
+ * @return
+ *      - ESP_OK: Correction set successfully
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ *      - ESP_ERR_NO_MEM: No memory for the correction table
+ *      - ESP_ERR_NOT_SUPPORTED: The backend has no color correction stage
+ */
+esp_err_t led_strip_set_color_correction(led_strip_handle_t strip, uint8_t brightness, float gamma);
+
+/**
+ * @brief Refresh memory colors to LEDs
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ *
+ * @note:
+ *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+ */
+esp_err_t led_strip_refresh(led_strip_handle_t strip);
+
+/**
+ * @brief Start a refresh without waiting for the end of the transfer (double buffered)
+ *
+ * The colors set so far are handed over to the peripheral and sent in the background.
+ * The caller can immediately draw the next frame with the `led_strip_set_pixel*` functions:
+ * they write into a second buffer, initialized with the frame being sent.
+ * If the previous asynchronous refresh is still in progress, this function waits for it first.
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Refresh started successfully
+ *      - ESP_ERR_NOT_SUPPORTED: The backend only supports blocking refresh (use `led_strip_refresh`)
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip);
+
+/**
+ * @brief Wait for the end of the last asynchronous refresh
+ *
+ * @param strip: LED strip
+ * @param timeout_ms: maximum wait time, -1 to wait forever
+ *
+ * @return
+ *      - ESP_OK: No refresh in progress anymore
+ *      - ESP_ERR_TIMEOUT: The refresh is still in progress
+ *      - ESP_ERR_NOT_SUPPORTED: The backend only supports blocking refresh
+ */
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int32_t timeout_ms);
+
+/**
+ * @brief Register a callback invoked (from ISR context) at the end of each asynchronous refresh
+ *
+ * @param strip: LED strip
+ * @param cb: callback, NULL to unregister
+ * @param user_ctx: user data passed to the callback
+ *
+ * @return
+ *      - ESP_OK: Callback registered successfully
+ *      - ESP_ERR_NOT_SUPPORTED: The backend only supports blocking refresh
+ */
+esp_err_t led_strip_register_refresh_done_cb(led_strip_handle_t strip, led_strip_refresh_done_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Enable the peripheral after `led_strip_disable`
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Peripheral enabled (or nothing to enable with this backend)
+ *      - ESP_FAIL: Enable failed because some other error occurred
+ */
+esp_err_t led_strip_enable(led_strip_handle_t strip);
+
+/**
+ * @brief Disable the peripheral until the next `led_strip_enable`
+ *
+ * The RMT backend keeps its channel enabled between refreshes, and the RMT driver holds a power
+ * management lock for as long as a channel is enabled: no light sleep, no CPU frequency scaling.
+ * Disabling the strip once its last frame is sent releases that lock. The frame in progress, if any,
+ * is waited for first; the LEDs keep showing it.
+ *
+ * @note Refreshing a disabled strip fails with `ESP_ERR_INVALID_STATE`. Backends that hold nothing
+ *       between refreshes (SPI) accept both calls and do nothing.
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Peripheral disabled (or nothing to disable with this backend)
+ *      - ESP_FAIL: Disable failed because some other error occurred
+ */
+esp_err_t led_strip_disable(led_strip_handle_t strip);
+
+/**
+ * @brief Clear LED strip (turn off all LEDs)
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Clear LEDs successfully
+ *      - ESP_FAIL: Clear LEDs failed because some other error occurred
+ */
+esp_err_t led_strip_clear(led_strip_handle_t strip);
+
+/**
+ * @brief Free LED strip resources
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Free resources successfully
+ *      - ESP_FAIL: Free resources failed because error occurred
+ */
+esp_err_t led_strip_del(led_strip_handle_t strip);
+
+#ifdef __cplusplus
+}
+#endif
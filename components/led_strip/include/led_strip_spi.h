@@ -20,8 +20,10 @@ extern "C" {
 typedef struct {
     spi_clock_source_t clk_src; /*!< SPI clock source */
     spi_host_device_t spi_bus;  /*!< SPI bus ID. Which buses are available depends on the specific chip */
+    uint32_t stream_chunk_leds; /*!< Streaming mode: number of LEDs encoded per DMA chunk, 0 for the default */
     struct {
         uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+        uint32_t streaming: 1;  /*!< Encode pixels on the fly into a small ring of DMA chunks, requires `with_dma` */
     } flags;                    /*!< Extra driver flags */
 } led_strip_spi_config_t;
 
@@ -29,6 +31,10 @@ typedef struct {
  * @brief Create LED strip based on SPI MOSI channel
  *
  * @note Although only the MOSI line is used for generating the signal, the whole SPI bus can't be used for other purposes.
+ * @note By default the whole encoded strip (9 bytes per RGB LED) is kept in DMA-capable internal memory.
+ *       In streaming mode the strip keeps only the raw colors (3 bytes per RGB LED, any memory) and `led_strip_refresh`
+ *       encodes them into a fixed ring of DMA chunks queued to the SPI driver, so the DMA memory no longer depends on the strip length.
+ *       The refreshing task must keep the queue fed: a stall longer than the LED reset time latches a partial frame.
  *
  * @param led_config LED strip configuration
  * @param spi_config SPI specific configuration
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -16,6 +17,27 @@ extern "C" {
  */
 typedef struct led_strip_t *led_strip_handle_t;
 
+/**
+ * @brief Callback invoked when an asynchronous refresh has been fully sent to the strip
+ *
+ * @note Called from ISR context: keep it short and only use ISR-safe FreeRTOS APIs.
+ *       With CONFIG_RMT_ISR_IRAM_SAFE the callback and its data must be placed in internal RAM.
+ *
+ * @param strip: LED strip
+ * @param user_ctx: user data passed to `led_strip_register_refresh_done_cb`
+ * @return Whether a high priority task has been woken up by this callback
+ */
+typedef bool (*led_strip_refresh_done_cb_t)(led_strip_handle_t strip, void *user_ctx);
+
+/**
+ * @brief HSV color, for the span conversion functions
+ */
+typedef struct {
+    uint16_t hue;        /*!< Hue in degrees: 0~359 */
+    uint8_t saturation;  /*!< Saturation: 0~255 */
+    uint8_t value;       /*!< Value (brightness): 0~255 */
+} led_strip_hsv_t;
+
 /**
  * @brief LED strip model
  * @note Different led model may have different timing parameters, so we need to distinguish them.
@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct led_strip_t led_strip_t; /*!< Type of LED strip */
+
+/**
+ * @brief LED strip interface definition
+ */
+struct led_strip_t {
+    /**
+     * @brief Set RGB for a specific pixel
+     *
+     * @param strip: LED strip
+     * @param index: index of pixel to set
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     *
+     * @return
+     *      - ESP_OK: Set RGB for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGB for a specific pixel failed because of invalid parameters
+     *      - ESP_FAIL: Set RGB for a specific pixel failed because other error occurred
+     */
+    esp_err_t (*set_pixel)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+
+    /**
+     * @brief Set RGBW for a specific pixel. Similar to `set_pixel` but also set the white component
+     *
+     * @param strip: LED strip
+     * @param index: index of pixel to set
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     * @param white: separate white component
+     *
+     * @return
+     *      - ESP_OK: Set RGBW color for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGBW color for a specific pixel failed because of an invalid argument
+     *      - ESP_FAIL: Set RGBW color for a specific pixel failed because other error occurred
+     */
+    esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
+    /**
+     * @brief Set a span of consecutive pixels from a packed color array
+     *
+     * @param strip: LED strip
+     * @param start: index of the first pixel
+     * @param count: number of pixels
+     * @param colors: `count` packed pixels, R-G-B or R-G-B-W byte order
+     * @param components: bytes per pixel in `colors`: 3 (white set to 0) or 4
+     *
+     * @return
+     *      - ESP_OK: Set the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Span out of the strip or unsupported number of components
+     */
+    esp_err_t (*set_pixels)(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *colors, uint8_t components);
+
+    /**
+     * @brief Set a span of consecutive pixels to the same color
+     *
+     * @param strip: LED strip
+     * @param start: index of the first pixel
+     * @param count: number of pixels
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     * @param white: white part of color, ignored by 3-component strips
+     *
+     * @return
+     *      - ESP_OK: Set the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Span out of the strip
+     */
+    esp_err_t (*fill)(led_strip_t *strip, uint32_t start, uint32_t count, uint8_t red, uint8_t green, uint8_t blue, uint8_t white);
+
+    /**
+     * @brief Install the color correction table applied to every color component on its way to the LEDs
+     *
+     * @param strip: LED strip
+     * @param lut: 256-entry table (copied by the backend), NULL to send the colors unchanged
+     *
+     * @return
+     *      - ESP_OK: Table installed
+     *      - ESP_ERR_NO_MEM: No memory for the table
+     *
+     * @note Optional: NULL if the backend has no color correction stage.
+     */
+    esp_err_t (*set_color_lut)(led_strip_t *strip, const uint8_t *lut);
+
+    /**
+     * @brief Refresh memory colors to LEDs
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout value for refreshing task
+     *
+     * @return
+     *      - ESP_OK: Refresh successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     *
+     * @note:
+     *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+     */
+    esp_err_t (*refresh)(led_strip_t *strip);
+
+    /**
+     * @brief Start sending memory colors to LEDs and return without waiting for the end of the transfer
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Refresh started successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     *
+     * @note Optional: NULL if the backend only supports blocking refresh.
+     */
+    esp_err_t (*refresh_async)(led_strip_t *strip);
+
+    /**
+     * @brief Wait for the end of the last asynchronous refresh
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: maximum wait time, -1 to wait forever
+     *
+     * @return
+     *      - ESP_OK: No refresh in progress anymore
+     *      - ESP_ERR_TIMEOUT: The refresh is still in progress
+     */
+    esp_err_t (*wait_refresh_done)(led_strip_t *strip, int32_t timeout_ms);
+
+    /**
+     * @brief Register the callback invoked at the end of each asynchronous refresh
+     *
+     * @param strip: LED strip
+     * @param cb: callback, NULL to unregister
+     * @param user_ctx: user data passed to the callback
+     *
+     * @return
+     *      - ESP_OK: Callback registered successfully
+     */
+    esp_err_t (*register_refresh_done_cb)(led_strip_t *strip, led_strip_refresh_done_cb_t cb, void *user_ctx);
+
+    /**
+     * @brief Enable or disable the peripheral between refreshes
+     *
+     * @param strip: LED strip
+     * @param enable: true to enable, false to release the peripheral (and its power management lock)
+     *
+     * @return
+     *      - ESP_OK: Peripheral enabled or disabled
+     *      - ESP_FAIL: The peripheral could not be enabled or disabled
+     *
+     * @note Optional: NULL if the backend holds nothing between refreshes.
+     */
+    esp_err_t (*enable)(led_strip_t *strip, bool enable);
+
+    /**
+     * @brief Clear LED strip (turn off all LEDs)
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout value for clearing task
+     *
+     * @return
+     *      - ESP_OK: Clear LEDs successfully
+     *      - ESP_FAIL: Clear LEDs failed because some other error occurred
+     */
+    esp_err_t (*clear)(led_strip_t *strip);
+
+    /**
+     * @brief Free LED strip resources
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Free resources successfully
+     *      - ESP_FAIL: Free resources failed because error occurred
+     */
+    esp_err_t (*del)(led_strip_t *strip);
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <math.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+
+static const char *TAG = "led_strip";
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixel(strip, index, red, green, blue);
+}
+
+static inline void led_strip_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value, uint8_t *rgb)
+{
+    uint32_t red = 0;
+    uint32_t green = 0;
+    uint32_t blue = 0;
+
+    uint32_t rgb_max = value;
+    uint32_t rgb_min = rgb_max * (255 - saturation) / 255;
+
+    uint32_t i = hue / 60;
+    uint32_t diff = hue % 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        red = rgb_max;
+        green = rgb_min + rgb_adj;
+        blue = rgb_min;
+        break;
+    case 1:
+        red = rgb_max - rgb_adj;
+        green = rgb_max;
+        blue = rgb_min;
+        break;
+    case 2:
+        red = rgb_min;
+        green = rgb_max;
+        blue = rgb_min + rgb_adj;
+        break;
+    case 3:
+        red = rgb_min;
+        green = rgb_max - rgb_adj;
+        blue = rgb_max;
+        break;
+    case 4:
+        red = rgb_min + rgb_adj;
+        green = rgb_min;
+        blue = rgb_max;
+        break;
+    default:
+        red = rgb_max;
+        green = rgb_min;
+        blue = rgb_max - rgb_adj;
+        break;
+    }
+
+    rgb[0] = red;
+    rgb[1] = green;
+    rgb[2] = blue;
+}
+
+esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    uint8_t rgb[3];
+    led_strip_hsv2rgb(hue, saturation, value, rgb);
+    return strip->set_pixel(strip, index, rgb[0], rgb[1], rgb[2]);
+}
+
+void led_strip_hsv_to_rgb(const led_strip_hsv_t *hsv, uint8_t *rgb, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++, hsv++, rgb += 3) {
+        led_strip_hsv2rgb(hsv->hue, hsv->saturation, hsv->value, rgb);
+    }
+}
+
+esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixel_rgbw(strip, index, red, green, blue, white);
+}
+
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *rgb)
+{
+    ESP_RETURN_ON_FALSE(strip && (rgb || !count), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixels(strip, start, count, rgb, 3);
+}
+
+esp_err_t led_strip_set_pixels_rgbw(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t *rgbw)
+{
+    ESP_RETURN_ON_FALSE(strip && (rgbw || !count), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixels(strip, start, count, rgbw, 4);
+}
+
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t start, uint32_t count, uint8_t red, uint8_t green, uint8_t blue)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->fill(strip, start, count, red, green, blue, 0);
+}
+
+#define LED_STRIP_SPAN_CHUNK 16
+
+esp_err_t led_strip_set_gradient(led_strip_handle_t strip, uint32_t start, uint32_t count, const uint8_t from[3], const uint8_t to[3])
+{
+    ESP_RETURN_ON_FALSE(strip && from && to, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (count < 2) {
+        return strip->set_pixels(strip, start, count, from, 3);
+    }
+
+    // 16.16 fixed point, one step per pixel; rendered by chunks on the stack
+    uint8_t chunk[LED_STRIP_SPAN_CHUNK * 3];
+    int32_t step[3];
+    for (int c = 0; c < 3; c++) {
+        // multiply, not shift: the difference is negative on a decreasing gradient
+        step[c] = (int32_t)(to[c] - from[c]) * 65536 / (int32_t)(count - 1);
+    }
+    for (uint32_t done = 0; done < count; done += LED_STRIP_SPAN_CHUNK) {
+        uint32_t n = count - done < LED_STRIP_SPAN_CHUNK ? count - done : LED_STRIP_SPAN_CHUNK;
+        for (uint32_t i = 0; i < n; i++) {
+            for (int c = 0; c < 3; c++) {
+                // the interpolated value stays between from and to: never negative before the shift
+                chunk[i * 3 + c] = (uint8_t)(((int32_t)from[c] * 65536 + step[c] * (int32_t)(done + i) + 0x8000) >> 16);
+            }
+        }
+        ESP_RETURN_ON_ERROR(strip->set_pixels(strip, start + done, n, chunk, 3), TAG, "set pixels failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixels_hsv(led_strip_handle_t strip, uint32_t start, uint32_t count, const led_strip_hsv_t *hsv)
+{
+    ESP_RETURN_ON_FALSE(strip && (hsv || !count), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    uint8_t chunk[LED_STRIP_SPAN_CHUNK * 3];
+    for (uint32_t done = 0; done < count; done += LED_STRIP_SPAN_CHUNK) {
+        uint32_t n = count - done < LED_STRIP_SPAN_CHUNK ? count - done : LED_STRIP_SPAN_CHUNK;
+        led_strip_hsv_to_rgb(hsv + done, chunk, n);
+        ESP_RETURN_ON_ERROR(strip->set_pixels(strip, start + done, n, chunk, 3), TAG, "set pixels failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_color_correction(led_strip_handle_t strip, uint8_t brightness, float gamma)
+{
+    ESP_RETURN_ON_FALSE(strip && gamma > 0.0f, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->set_color_lut, ESP_ERR_NOT_SUPPORTED, TAG, "color correction not supported by this backend");
+    if (brightness == 255 && gamma == 1.0f) {
+        return strip->set_color_lut(strip, NULL);
+    }
+
+    // the only floating point work: 256 entries, once per setting
+    uint8_t lut[256];
+    for (int i = 0; i < 256; i++) {
+        lut[i] = (uint8_t)(powf(i / 255.0f, gamma) * brightness + 0.5f);
+    }
+    return strip->set_color_lut(strip, lut);
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->refresh(strip);
+}
+
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->refresh_async, ESP_ERR_NOT_SUPPORTED, TAG, "asynchronous refresh not supported by this backend");
+    return strip->refresh_async(strip);
+}
+
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->wait_refresh_done, ESP_ERR_NOT_SUPPORTED, TAG, "asynchronous refresh not supported by this backend");
+    return strip->wait_refresh_done(strip, timeout_ms);
+}
+
+esp_err_t led_strip_register_refresh_done_cb(led_strip_handle_t strip, led_strip_refresh_done_cb_t cb, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->register_refresh_done_cb, ESP_ERR_NOT_SUPPORTED, TAG, "asynchronous refresh not supported by this backend");
+    return strip->register_refresh_done_cb(strip, cb, user_ctx);
+}
+
+esp_err_t led_strip_enable(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->enable ? strip->enable(strip, true) : ESP_OK;
+}
+
+esp_err_t led_strip_disable(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->enable ? strip->enable(strip, false) : ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->clear(strip);
+}
+
+esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->del(strip);
+}
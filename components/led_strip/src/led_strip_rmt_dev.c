@@ -0,0 +1,361 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "driver/rmt_tx.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_rmt_encoder.h"
+
+#define LED_STRIP_RMT_DEFAULT_RESOLUTION 10000000 // 10MHz resolution
+#define LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE 4
+// the memory size of each RMT channel, in words (4 bytes)
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 64
+#else
+#define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 48
+#endif
+
+static const char *TAG = "led_strip_rmt";
+
+typedef struct {
+    led_strip_t base;
+    rmt_channel_handle_t rmt_chan;
+    rmt_encoder_handle_t strip_encoder;
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    led_color_component_format_t component_fmt;
+    uint8_t *pixel_buf;     // back buffer, written by set_pixel
+    uint8_t *front_buf;     // buffer being sent by the RMT
+    volatile bool tx_busy;
+    bool enabled;           // RMT channel enabled: the driver holds its PM lock meanwhile
+    led_strip_refresh_done_cb_t done_cb;
+    void *done_ctx;
+    const uint8_t *color_lut;   // color correction applied when the frame is handed to the RMT, NULL if none
+    uint8_t color_lut_buf[256];
+    uint8_t buffers[];      // 2 x strip_len x bytes_per_pixel
+} led_strip_rmt_obj;
+
+static bool IRAM_ATTR led_strip_rmt_trans_done(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = (led_strip_rmt_obj *)user_ctx;
+    rmt_strip->tx_busy = false;
+    led_strip_refresh_done_cb_t cb = rmt_strip->done_cb;
+    return cb ? cb(&rmt_strip->base, rmt_strip->done_ctx) : false;
+}
+
+static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+
+    led_color_component_format_t component_fmt = rmt_strip->component_fmt;
+    uint32_t start = index * rmt_strip->bytes_per_pixel;
+    uint8_t *pixel_buf = rmt_strip->pixel_buf;
+
+    pixel_buf[start + component_fmt.format.r_pos] = red & 0xFF;
+    pixel_buf[start + component_fmt.format.g_pos] = green & 0xFF;
+    pixel_buf[start + component_fmt.format.b_pos] = blue & 0xFF;
+    if (component_fmt.format.num_components > 3) {
+        pixel_buf[start + component_fmt.format.w_pos] = 0;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    led_color_component_format_t component_fmt = rmt_strip->component_fmt;
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(component_fmt.format.num_components == 4, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    uint32_t start = index * rmt_strip->bytes_per_pixel;
+    uint8_t *pixel_buf = rmt_strip->pixel_buf;
+
+    pixel_buf[start + component_fmt.format.r_pos] = red & 0xFF;
+    pixel_buf[start + component_fmt.format.g_pos] = green & 0xFF;
+    pixel_buf[start + component_fmt.format.b_pos] = blue & 0xFF;
+    pixel_buf[start + component_fmt.format.w_pos] = white & 0xFF;
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *colors, uint8_t components)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(start <= rmt_strip->strip_len && count <= rmt_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "span out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(components == 3 || components == rmt_strip->bytes_per_pixel, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    // resolve the component order once for the whole span
+    led_color_component_format_t component_fmt = rmt_strip->component_fmt;
+    const uint8_t r_pos = component_fmt.format.r_pos;
+    const uint8_t g_pos = component_fmt.format.g_pos;
+    const uint8_t b_pos = component_fmt.format.b_pos;
+    const uint8_t w_pos = component_fmt.format.w_pos;
+    const uint8_t bytes_per_pixel = rmt_strip->bytes_per_pixel;
+    uint8_t *pixel_buf = rmt_strip->pixel_buf + start * bytes_per_pixel;
+
+    if (bytes_per_pixel == 3) {
+        if (r_pos == 0 && g_pos == 1 && b_pos == 2) {
+            memcpy(pixel_buf, colors, count * 3);
+            return ESP_OK;
+        }
+        for (uint32_t i = 0; i < count; i++, pixel_buf += 3, colors += 3) {
+            pixel_buf[r_pos] = colors[0];
+            pixel_buf[g_pos] = colors[1];
+            pixel_buf[b_pos] = colors[2];
+        }
+    } else {
+        for (uint32_t i = 0; i < count; i++, pixel_buf += 4, colors += components) {
+            pixel_buf[r_pos] = colors[0];
+            pixel_buf[g_pos] = colors[1];
+            pixel_buf[b_pos] = colors[2];
+            pixel_buf[w_pos] = components == 4 ? colors[3] : 0;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_fill(led_strip_t *strip, uint32_t start, uint32_t count, uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(start <= rmt_strip->strip_len && count <= rmt_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "span out of maximum number of LEDs");
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    led_color_component_format_t component_fmt = rmt_strip->component_fmt;
+    const uint8_t bytes_per_pixel = rmt_strip->bytes_per_pixel;
+    uint8_t *pixel_buf = rmt_strip->pixel_buf + start * bytes_per_pixel;
+    pixel_buf[component_fmt.format.r_pos] = red;
+    pixel_buf[component_fmt.format.g_pos] = green;
+    pixel_buf[component_fmt.format.b_pos] = blue;
+    if (bytes_per_pixel > 3) {
+        pixel_buf[component_fmt.format.w_pos] = white;
+    }
+    // replicate the first pixel, doubling the copied span each time
+    size_t len = count * bytes_per_pixel;
+    for (size_t done = bytes_per_pixel; done < len; done *= 2) {
+        memcpy(pixel_buf + done, pixel_buf, done < len - done ? done : len - done);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_wait_refresh_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (!rmt_strip->enabled) {
+        // nothing can be in flight on a disabled channel
+        return ESP_OK;
+    }
+    return rmt_tx_wait_all_done(rmt_strip->rmt_chan, timeout_ms);
+}
+
+static esp_err_t led_strip_rmt_refresh_async(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    size_t len = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+    rmt_transmit_config_t tx_conf = {
+        .loop_count = 0,
+    };
+    ESP_RETURN_ON_FALSE(rmt_strip->enabled, ESP_ERR_INVALID_STATE, TAG, "strip disabled, call led_strip_enable first");
+
+    // the front buffer is about to become the back buffer: it must not be on the wire anymore
+    if (rmt_strip->tx_busy) {
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+    }
+    uint8_t *frame;
+    const uint8_t *lut = rmt_strip->color_lut;
+    if (lut) {
+        // correct into the front buffer, the back buffer keeps the colors as written
+        frame = rmt_strip->front_buf;
+        const uint8_t *pixel_buf = rmt_strip->pixel_buf;
+        for (size_t i = 0; i < len; i++) {
+            frame[i] = lut[pixel_buf[i]];
+        }
+    } else {
+        frame = rmt_strip->pixel_buf;
+        rmt_strip->pixel_buf = rmt_strip->front_buf;
+        rmt_strip->front_buf = frame;
+        // the next frame starts from the one being sent, as with a single buffer
+        memcpy(rmt_strip->pixel_buf, frame, len);
+    }
+
+    rmt_strip->tx_busy = true;
+    esp_err_t ret = rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, frame, len, &tx_conf);
+    if (ret != ESP_OK) {
+        rmt_strip->tx_busy = false;
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "transmit pixels by RMT failed");
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+{
+    ESP_RETURN_ON_ERROR(led_strip_rmt_refresh_async(strip), TAG, "refresh failed");
+    return led_strip_rmt_wait_refresh_done(strip, -1);
+}
+
+static esp_err_t led_strip_rmt_register_refresh_done_cb(led_strip_t *strip, led_strip_refresh_done_cb_t cb, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    // the callback is read from the ISR: never leave it half updated
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_refresh_done(strip, -1), TAG, "flush RMT channel failed");
+    rmt_strip->done_ctx = user_ctx;
+    rmt_strip->done_cb = cb;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_color_lut(led_strip_t *strip, const uint8_t *lut)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (lut) {
+        memcpy(rmt_strip->color_lut_buf, lut, sizeof(rmt_strip->color_lut_buf));
+        rmt_strip->color_lut = rmt_strip->color_lut_buf;
+    } else {
+        rmt_strip->color_lut = NULL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_enable(led_strip_t *strip, bool enable)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (enable == rmt_strip->enabled) {
+        return ESP_OK;
+    }
+    if (enable) {
+        ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
+    } else {
+        // the last frame must be fully on the wire before the channel stops
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    }
+    rmt_strip->enabled = enable;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    // Write zero to turn off all leds
+    memset(rmt_strip->pixel_buf, 0, rmt_strip->strip_len * rmt_strip->bytes_per_pixel);
+    return led_strip_rmt_refresh(strip);
+}
+
+static esp_err_t led_strip_rmt_del(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_ERROR(led_strip_rmt_enable(strip, false), TAG, "disable RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
+    free(rmt_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_rmt_obj *rmt_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    led_color_component_format_t component_fmt = led_config->color_component_format;
+    // If R/G/B order is not specified, set default GRB order as fallback
+    if (component_fmt.format_id == 0) {
+        component_fmt = LED_STRIP_COLOR_COMPONENT_FMT_GRB;
+    }
+    // check the validation of the color component format
+    uint8_t mask = 0;
+    if (component_fmt.format.num_components == 3) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x07, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else if (component_fmt.format.num_components == 4) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos) | BIT(component_fmt.format.w_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x0F, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else {
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid number of color components: %d", component_fmt.format.num_components);
+    }
+    // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
+    uint8_t bytes_per_pixel = component_fmt.format.num_components;
+    // two pixel buffers: one being drawn while the other one is sent
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + 2 * led_config->max_leds * bytes_per_pixel);
+    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->pixel_buf = rmt_strip->buffers;
+    rmt_strip->front_buf = rmt_strip->buffers + led_config->max_leds * bytes_per_pixel;
+    uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
+
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    rmt_clock_source_t clk_src = RMT_CLK_SRC_DEFAULT;
+    if (rmt_config->clk_src) {
+        clk_src = rmt_config->clk_src;
+    }
+    size_t mem_block_symbols = LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS;
+    // override the default value if the user sets it
+    if (rmt_config->mem_block_symbols) {
+        mem_block_symbols = rmt_config->mem_block_symbols;
+    }
+    rmt_tx_channel_config_t rmt_chan_config = {
+        .clk_src = clk_src,
+        .gpio_num = led_config->strip_gpio_num,
+        .mem_block_symbols = mem_block_symbols,
+        .resolution_hz = resolution,
+        .trans_queue_depth = LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE,
+        .flags.with_dma = rmt_config->flags.with_dma,
+        .flags.invert_out = led_config->flags.invert_out,
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->rmt_chan), err, TAG, "create RMT TX channel failed");
+
+    led_strip_encoder_config_t strip_encoder_conf = {
+        .resolution = resolution,
+        .led_model = led_config->led_model
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_strip_rmt_trans_done,
+    };
+    ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->rmt_chan, &cbs, rmt_strip), err, TAG, "register RMT callbacks failed");
+    // the channel stays enabled between refreshes, instead of being enabled and disabled at every refresh,
+    // until led_strip_disable releases it (and the RMT power management lock) at rest
+    ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), err, TAG, "enable RMT channel failed");
+    rmt_strip->enabled = true;
+
+    rmt_strip->component_fmt = component_fmt;
+    rmt_strip->bytes_per_pixel = bytes_per_pixel;
+    rmt_strip->strip_len = led_config->max_leds;
+    rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
+    rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
+    rmt_strip->base.fill = led_strip_rmt_fill;
+    rmt_strip->base.set_color_lut = led_strip_rmt_set_color_lut;
+    rmt_strip->base.refresh = led_strip_rmt_refresh;
+    rmt_strip->base.refresh_async = led_strip_rmt_refresh_async;
+    rmt_strip->base.wait_refresh_done = led_strip_rmt_wait_refresh_done;
+    rmt_strip->base.register_refresh_done_cb = led_strip_rmt_register_refresh_done_cb;
+    rmt_strip->base.enable = led_strip_rmt_enable;
+    rmt_strip->base.clear = led_strip_rmt_clear;
+    rmt_strip->base.del = led_strip_rmt_del;
+
+    *ret_strip = &rmt_strip->base;
+    return ESP_OK;
+err:
+    if (rmt_strip) {
+        if (rmt_strip->rmt_chan) {
+            rmt_del_channel(rmt_strip->rmt_chan);
+        }
+        if (rmt_strip->strip_encoder) {
+            rmt_del_encoder(rmt_strip->strip_encoder);
+        }
+        free(rmt_strip);
+    }
+    return ret;
+}
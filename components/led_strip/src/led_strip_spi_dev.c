@@ -0,0 +1,549 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_rom_gpio.h"
+#include "soc/spi_periph.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+
+#define LED_STRIP_SPI_DEFAULT_RESOLUTION (2.5 * 1000 * 1000) // 2.5MHz resolution
+#define LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE 4
+#define LED_STRIP_SPI_DEFAULT_STREAM_CHUNK_LEDS 32 // 288 bytes per RGB chunk, ~0.9ms on the wire
+#define LED_STRIP_SPI_STREAM_CHUNKS LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE
+
+#define SPI_BYTES_PER_COLOR_BYTE 3
+#define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
+
+static const char *TAG = "led_strip_spi";
+
+typedef struct {
+    led_strip_t base;
+    spi_host_device_t spi_host;
+    spi_device_handle_t spi_device;
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    led_color_component_format_t component_fmt;
+    const uint8_t (*enc_lut)[SPI_BYTES_PER_COLOR_BYTE];     // byte encoding table in use
+    uint8_t (*color_enc_lut)[SPI_BYTES_PER_COLOR_BYTE];     // encoding table with the color correction folded in
+    uint8_t *color_buf;             // raw colors in wire order, kept once a correction is set, to re-encode the frame
+    uint8_t *stream_chunks;         // streaming mode: ring of DMA chunks, NULL otherwise
+    uint32_t stream_chunk_bytes;    // streaming mode: raw color bytes encoded per chunk
+    spi_transaction_t stream_trans[LED_STRIP_SPI_STREAM_CHUNKS];
+    uint8_t pixel_buf[];            // encoded SPI bytes, or raw colors in wire order in streaming mode
+} led_strip_spi_obj;
+
+// Each color bit is represented by 3 SPI bits, low_level:100, high_level:110 (MSB first),
+// so a color byte occupies 3 bytes of SPI. The table holds the encoding of every byte value.
+#define SPI_BIT(data, n) (((data) >> (n)) & 0x01 ? 0x06u : 0x04u)
+#define SPI_WORD(data) (SPI_BIT(data, 7) << 21 | SPI_BIT(data, 6) << 18 | SPI_BIT(data, 5) << 15 | SPI_BIT(data, 4) << 12 | \
+                        SPI_BIT(data, 3) << 9 | SPI_BIT(data, 2) << 6 | SPI_BIT(data, 1) << 3 | SPI_BIT(data, 0))
+#define SPI_ENC(data) { (uint8_t)(SPI_WORD(data) >> 16), (uint8_t)(SPI_WORD(data) >> 8), (uint8_t)SPI_WORD(data) }
+#define SPI_ENC4(d) SPI_ENC(d), SPI_ENC((d) + 1), SPI_ENC((d) + 2), SPI_ENC((d) + 3)
+#define SPI_ENC16(d) SPI_ENC4(d), SPI_ENC4((d) + 4), SPI_ENC4((d) + 8), SPI_ENC4((d) + 12)
+#define SPI_ENC64(d) SPI_ENC16(d), SPI_ENC16((d) + 16), SPI_ENC16((d) + 32), SPI_ENC16((d) + 48)
+
+// kept in internal RAM: the encoder runs for every color component of every frame
+static DRAM_ATTR const uint8_t s_spi_bit_lut[256][SPI_BYTES_PER_COLOR_BYTE] = {
+    SPI_ENC64(0), SPI_ENC64(64), SPI_ENC64(128), SPI_ENC64(192)
+};
+
+static inline void __led_strip_spi_bit(const uint8_t (*lut)[SPI_BYTES_PER_COLOR_BYTE], uint8_t data, uint8_t *buf)
+{
+    const uint8_t *enc = lut[data];
+    buf[0] = enc[0];
+    buf[1] = enc[1];
+    buf[2] = enc[2];
+}
+
+// Inverse of the uncorrected encoding: the middle bit of each 3-bit group is the color bit
+static inline uint8_t __led_strip_spi_decode(const uint8_t *buf)
+{
+    uint32_t word = (uint32_t)buf[0] << 16 | (uint32_t)buf[1] << 8 | buf[2];
+    uint8_t data = 0;
+    for (int n = 7; n >= 0; n--) {
+        data |= ((word >> (3 * n + 1)) & 0x01) << n;
+    }
+    return data;
+}
+
+static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    // 3 pixels take 72bits(9bytes)
+    uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *pixel_buf = spi_strip->pixel_buf;
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+
+    __led_strip_spi_bit(spi_strip->enc_lut, red, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.r_pos]);
+    __led_strip_spi_bit(spi_strip->enc_lut, green, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.g_pos]);
+    __led_strip_spi_bit(spi_strip->enc_lut, blue, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.b_pos]);
+    if (component_fmt.format.num_components > 3) {
+        __led_strip_spi_bit(spi_strip->enc_lut, 0, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.w_pos]);
+    }
+    if (spi_strip->color_buf) {
+        uint8_t *color_buf = spi_strip->color_buf + index * spi_strip->bytes_per_pixel;
+        color_buf[component_fmt.format.r_pos] = red & 0xFF;
+        color_buf[component_fmt.format.g_pos] = green & 0xFF;
+        color_buf[component_fmt.format.b_pos] = blue & 0xFF;
+        if (component_fmt.format.num_components > 3) {
+            color_buf[component_fmt.format.w_pos] = 0;
+        }
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(component_fmt.format.num_components == 4, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
+    uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *pixel_buf = spi_strip->pixel_buf;
+
+    __led_strip_spi_bit(spi_strip->enc_lut, red, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.r_pos]);
+    __led_strip_spi_bit(spi_strip->enc_lut, green, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.g_pos]);
+    __led_strip_spi_bit(spi_strip->enc_lut, blue, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.b_pos]);
+    __led_strip_spi_bit(spi_strip->enc_lut, white, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * component_fmt.format.w_pos]);
+    if (spi_strip->color_buf) {
+        uint8_t *color_buf = spi_strip->color_buf + index * spi_strip->bytes_per_pixel;
+        color_buf[component_fmt.format.r_pos] = red & 0xFF;
+        color_buf[component_fmt.format.g_pos] = green & 0xFF;
+        color_buf[component_fmt.format.b_pos] = blue & 0xFF;
+        color_buf[component_fmt.format.w_pos] = white & 0xFF;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *colors, uint8_t components)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "span out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(components == 3 || components == spi_strip->bytes_per_pixel, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    // resolve the component offsets once for the whole span
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+    const uint8_t r_off = component_fmt.format.r_pos * SPI_BYTES_PER_COLOR_BYTE;
+    const uint8_t g_off = component_fmt.format.g_pos * SPI_BYTES_PER_COLOR_BYTE;
+    const uint8_t b_off = component_fmt.format.b_pos * SPI_BYTES_PER_COLOR_BYTE;
+    const uint8_t w_off = component_fmt.format.w_pos * SPI_BYTES_PER_COLOR_BYTE;
+    const uint32_t pixel_size = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *pixel_buf = spi_strip->pixel_buf + start * pixel_size;
+    const uint8_t (*lut)[SPI_BYTES_PER_COLOR_BYTE] = spi_strip->enc_lut;
+
+    if (spi_strip->bytes_per_pixel == 3) {
+        for (uint32_t i = 0; i < count; i++, pixel_buf += pixel_size, colors += 3) {
+            __led_strip_spi_bit(lut, colors[0], pixel_buf + r_off);
+            __led_strip_spi_bit(lut, colors[1], pixel_buf + g_off);
+            __led_strip_spi_bit(lut, colors[2], pixel_buf + b_off);
+        }
+    } else {
+        for (uint32_t i = 0; i < count; i++, pixel_buf += pixel_size, colors += components) {
+            __led_strip_spi_bit(lut, colors[0], pixel_buf + r_off);
+            __led_strip_spi_bit(lut, colors[1], pixel_buf + g_off);
+            __led_strip_spi_bit(lut, colors[2], pixel_buf + b_off);
+            __led_strip_spi_bit(lut, components == 4 ? colors[3] : 0, pixel_buf + w_off);
+        }
+    }
+    if (spi_strip->color_buf) {
+        colors -= count * components;
+        uint8_t *color_buf = spi_strip->color_buf + start * spi_strip->bytes_per_pixel;
+        for (uint32_t i = 0; i < count; i++, color_buf += spi_strip->bytes_per_pixel, colors += components) {
+            color_buf[component_fmt.format.r_pos] = colors[0];
+            color_buf[component_fmt.format.g_pos] = colors[1];
+            color_buf[component_fmt.format.b_pos] = colors[2];
+            if (spi_strip->bytes_per_pixel > 3) {
+                color_buf[component_fmt.format.w_pos] = components == 4 ? colors[3] : 0;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_fill(led_strip_t *strip, uint32_t start, uint32_t count, uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "span out of maximum number of LEDs");
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    const uint8_t rgbw[4] = { red, green, blue, white };
+    ESP_RETURN_ON_ERROR(led_strip_spi_set_pixels(strip, start, 1, rgbw, spi_strip->bytes_per_pixel), TAG, "set pixel failed");
+    // replicate the first encoded pixel, doubling the copied span each time
+    const uint32_t pixel_size = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *pixel_buf = spi_strip->pixel_buf + start * pixel_size;
+    size_t len = count * pixel_size;
+    for (size_t done = pixel_size; done < len; done *= 2) {
+        memcpy(pixel_buf + done, pixel_buf, done < len - done ? done : len - done);
+    }
+    if (spi_strip->color_buf) {
+        uint8_t *color_buf = spi_strip->color_buf + start * spi_strip->bytes_per_pixel;
+        len = count * spi_strip->bytes_per_pixel;
+        for (size_t done = spi_strip->bytes_per_pixel; done < len; done *= 2) {
+            memcpy(color_buf + done, color_buf, done < len - done ? done : len - done);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    spi_transaction_t tx_conf;
+    memset(&tx_conf, 0, sizeof(tx_conf));
+
+    tx_conf.length = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BITS_PER_COLOR_BYTE;
+    tx_conf.tx_buffer = spi_strip->pixel_buf;
+    tx_conf.rx_buffer = NULL;
+    ESP_RETURN_ON_ERROR(spi_device_transmit(spi_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_clear(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    //Write zero to turn off all leds: fill the buffer with the 3-byte encoding of 0x00,
+    //doubling the copied span each time
+    uint8_t *buf = spi_strip->pixel_buf;
+    size_t len = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    if (len) {
+        __led_strip_spi_bit(spi_strip->enc_lut, 0, buf);
+    }
+    for (size_t done = SPI_BYTES_PER_COLOR_BYTE; done < len; done *= 2) {
+        memcpy(buf + done, buf, done < len - done ? done : len - done);
+    }
+    if (spi_strip->color_buf) {
+        memset(spi_strip->color_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel);
+    }
+
+    return led_strip_spi_refresh(strip);
+}
+
+// Streaming mode: pixel_buf holds the raw color bytes in wire order (same layout as the RMT backend),
+// they are only encoded chunk by chunk while the previous chunks are on the wire.
+static esp_err_t led_strip_spi_stream_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+    uint8_t *pixel_buf = spi_strip->pixel_buf + index * spi_strip->bytes_per_pixel;
+
+    pixel_buf[component_fmt.format.r_pos] = red & 0xFF;
+    pixel_buf[component_fmt.format.g_pos] = green & 0xFF;
+    pixel_buf[component_fmt.format.b_pos] = blue & 0xFF;
+    if (component_fmt.format.num_components > 3) {
+        pixel_buf[component_fmt.format.w_pos] = 0;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_stream_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(component_fmt.format.num_components == 4, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+    uint8_t *pixel_buf = spi_strip->pixel_buf + index * spi_strip->bytes_per_pixel;
+
+    pixel_buf[component_fmt.format.r_pos] = red & 0xFF;
+    pixel_buf[component_fmt.format.g_pos] = green & 0xFF;
+    pixel_buf[component_fmt.format.b_pos] = blue & 0xFF;
+    pixel_buf[component_fmt.format.w_pos] = white & 0xFF;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_stream_set_pixels(led_strip_t *strip, uint32_t start, uint32_t count, const uint8_t *colors, uint8_t components)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "span out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(components == 3 || components == spi_strip->bytes_per_pixel, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+    const uint8_t r_pos = component_fmt.format.r_pos;
+    const uint8_t g_pos = component_fmt.format.g_pos;
+    const uint8_t b_pos = component_fmt.format.b_pos;
+    const uint8_t w_pos = component_fmt.format.w_pos;
+    const uint8_t bytes_per_pixel = spi_strip->bytes_per_pixel;
+    uint8_t *pixel_buf = spi_strip->pixel_buf + start * bytes_per_pixel;
+
+    for (uint32_t i = 0; i < count; i++, pixel_buf += bytes_per_pixel, colors += components) {
+        pixel_buf[r_pos] = colors[0];
+        pixel_buf[g_pos] = colors[1];
+        pixel_buf[b_pos] = colors[2];
+        if (bytes_per_pixel > 3) {
+            pixel_buf[w_pos] = components == 4 ? colors[3] : 0;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_stream_fill(led_strip_t *strip, uint32_t start, uint32_t count, uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "span out of maximum number of LEDs");
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    const uint8_t rgbw[4] = { red, green, blue, white };
+    led_strip_spi_stream_set_pixels(strip, start, 1, rgbw, spi_strip->bytes_per_pixel);
+    const uint8_t bytes_per_pixel = spi_strip->bytes_per_pixel;
+    uint8_t *pixel_buf = spi_strip->pixel_buf + start * bytes_per_pixel;
+    size_t len = count * bytes_per_pixel;
+    for (size_t done = bytes_per_pixel; done < len; done *= 2) {
+        memcpy(pixel_buf + done, pixel_buf, done < len - done ? done : len - done);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_stream_refresh(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    const uint8_t *raw = spi_strip->pixel_buf;
+    const uint8_t (*lut)[SPI_BYTES_PER_COLOR_BYTE] = spi_strip->enc_lut;
+    const uint32_t total = spi_strip->strip_len * spi_strip->bytes_per_pixel;
+    uint32_t queued = 0;    // raw bytes handed to the SPI driver
+    uint32_t in_flight = 0; // chunks queued and not yet returned
+    uint32_t slot = 0;
+    esp_err_t ret = ESP_OK;
+
+    // Chunks come back in FIFO order, so the next slot is always free while in_flight < LED_STRIP_SPI_STREAM_CHUNKS.
+    // Every encoded byte ends with a low bit: the line stays low in the short gap between two transactions.
+    while (in_flight || (ret == ESP_OK && queued < total)) {
+        if (ret == ESP_OK && queued < total && in_flight < LED_STRIP_SPI_STREAM_CHUNKS) {
+            uint32_t len = total - queued < spi_strip->stream_chunk_bytes ? total - queued : spi_strip->stream_chunk_bytes;
+            spi_transaction_t *trans = &spi_strip->stream_trans[slot];
+            uint8_t *chunk = (uint8_t *)trans->tx_buffer;
+            for (uint32_t i = 0; i < len; i++) {
+                __led_strip_spi_bit(lut, raw[queued + i], chunk + i * SPI_BYTES_PER_COLOR_BYTE);
+            }
+            trans->length = len * SPI_BITS_PER_COLOR_BYTE;
+            ret = spi_device_queue_trans(spi_strip->spi_device, trans, portMAX_DELAY);
+            if (ret == ESP_OK) {
+                queued += len;
+                in_flight++;
+                slot = (slot + 1) % LED_STRIP_SPI_STREAM_CHUNKS;
+            }
+        } else {
+            spi_transaction_t *done = NULL;
+            ESP_RETURN_ON_ERROR(spi_device_get_trans_result(spi_strip->spi_device, &done, portMAX_DELAY), TAG, "get trans result failed");
+            in_flight--;
+        }
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "queue pixels by SPI failed");
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_stream_clear(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel);
+    return led_strip_spi_stream_refresh(strip);
+}
+
+// The correction is folded into a private copy of the byte encoding table: still one lookup per color byte
+static esp_err_t led_strip_spi_set_color_lut(led_strip_t *strip, const uint8_t *lut)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    size_t len = spi_strip->strip_len * spi_strip->bytes_per_pixel;
+    // outside streaming mode the frame lives encoded only: keep the raw colors from the first correction on,
+    // recovered exactly from the uncorrected encoding, so that every correction change re-encodes the frame
+    if (!spi_strip->stream_chunks && !spi_strip->color_buf && lut) {
+        spi_strip->color_buf = heap_caps_malloc(len, MALLOC_CAP_8BIT);
+        ESP_RETURN_ON_FALSE(spi_strip->color_buf, ESP_ERR_NO_MEM, TAG, "no mem for color buffer");
+        for (size_t i = 0; i < len; i++) {
+            spi_strip->color_buf[i] = __led_strip_spi_decode(spi_strip->pixel_buf + i * SPI_BYTES_PER_COLOR_BYTE);
+        }
+    }
+    if (!lut) {
+        spi_strip->enc_lut = s_spi_bit_lut;
+    } else {
+        if (!spi_strip->color_enc_lut) {
+            spi_strip->color_enc_lut = heap_caps_malloc(sizeof(s_spi_bit_lut), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            ESP_RETURN_ON_FALSE(spi_strip->color_enc_lut, ESP_ERR_NO_MEM, TAG, "no mem for color table");
+        }
+        for (int i = 0; i < 256; i++) {
+            memcpy(spi_strip->color_enc_lut[i], s_spi_bit_lut[lut[i]], SPI_BYTES_PER_COLOR_BYTE);
+        }
+        spi_strip->enc_lut = (const uint8_t (*)[SPI_BYTES_PER_COLOR_BYTE])spi_strip->color_enc_lut;
+    }
+    // the frame shown at the next refresh follows the new correction
+    if (spi_strip->color_buf) {
+        for (size_t i = 0; i < len; i++) {
+            __led_strip_spi_bit(spi_strip->enc_lut, spi_strip->color_buf[i], spi_strip->pixel_buf + i * SPI_BYTES_PER_COLOR_BYTE);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_del(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+
+    ESP_RETURN_ON_ERROR(spi_bus_remove_device(spi_strip->spi_device), TAG, "delete spi device failed");
+    ESP_RETURN_ON_ERROR(spi_bus_free(spi_strip->spi_host), TAG, "free spi bus failed");
+
+    free(spi_strip->color_enc_lut);
+    free(spi_strip->color_buf);
+    free(spi_strip->stream_chunks);
+    free(spi_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_spi_obj *spi_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && spi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    led_color_component_format_t component_fmt = led_config->color_component_format;
+    // If R/G/B order is not specified, set default GRB order as fallback
+    if (component_fmt.format_id == 0) {
+        component_fmt = LED_STRIP_COLOR_COMPONENT_FMT_GRB;
+    }
+    // check the validation of the color component format
+    uint8_t mask = 0;
+    if (component_fmt.format.num_components == 3) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x07, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else if (component_fmt.format.num_components == 4) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos) | BIT(component_fmt.format.w_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x0F, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else {
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid number of color components: %d", component_fmt.format.num_components);
+    }
+    // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
+    uint8_t bytes_per_pixel = component_fmt.format.num_components;
+    bool streaming = spi_config->flags.streaming;
+    ESP_GOTO_ON_FALSE(!streaming || spi_config->flags.with_dma, ESP_ERR_INVALID_ARG, err, TAG, "streaming mode requires DMA");
+    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
+    size_t pixel_buf_size = led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    size_t max_transfer_sz = pixel_buf_size;
+    if (streaming) {
+        // only the raw colors are kept, they are never handed to the DMA
+        pixel_buf_size = led_config->max_leds * bytes_per_pixel;
+    } else if (spi_config->flags.with_dma) {
+        // DMA buffer must be placed in internal SRAM
+        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + pixel_buf_size, mem_caps);
+
+    ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+
+    if (streaming) {
+        uint32_t chunk_leds = spi_config->stream_chunk_leds ? spi_config->stream_chunk_leds : LED_STRIP_SPI_DEFAULT_STREAM_CHUNK_LEDS;
+        spi_strip->stream_chunk_bytes = chunk_leds * bytes_per_pixel;
+        max_transfer_sz = spi_strip->stream_chunk_bytes * SPI_BYTES_PER_COLOR_BYTE;
+        // keep every chunk word aligned for the DMA
+        size_t chunk_stride = (max_transfer_sz + 3) & ~(size_t)3;
+        spi_strip->stream_chunks = heap_caps_calloc(LED_STRIP_SPI_STREAM_CHUNKS, chunk_stride, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+        ESP_GOTO_ON_FALSE(spi_strip->stream_chunks, ESP_ERR_NO_MEM, err, TAG, "no mem for stream chunks");
+        for (int i = 0; i < LED_STRIP_SPI_STREAM_CHUNKS; i++) {
+            spi_strip->stream_trans[i].tx_buffer = spi_strip->stream_chunks + i * chunk_stride;
+        }
+    }
+
+    spi_strip->spi_host = spi_config->spi_bus;
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    spi_clock_source_t clk_src = SPI_CLK_SRC_DEFAULT;
+    if (spi_config->clk_src) {
+        clk_src = spi_config->clk_src;
+    }
+
+    spi_bus_config_t spi_bus_cfg = {
+        .mosi_io_num = led_config->strip_gpio_num,
+        //Only use MOSI to generate the signal, set -1 when other pins are not used.
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = max_transfer_sz,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(spi_strip->spi_host, &spi_bus_cfg, spi_config->flags.with_dma ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED), err, TAG, "create SPI bus failed");
+
+    if (led_config->flags.invert_out == true) {
+        esp_rom_gpio_connect_out_signal(led_config->strip_gpio_num, spi_periph_signal[spi_strip->spi_host].spid_out, true, false);
+    }
+
+    spi_device_interface_config_t spi_dev_cfg = {
+        .clock_source = clk_src,
+        .command_bits = 0,
+        .address_bits = 0,
+        .dummy_bits = 0,
+        .clock_speed_hz = LED_STRIP_SPI_DEFAULT_RESOLUTION,
+        .mode = 0,
+        //set -1 when CS is not used
+        .spics_io_num = -1,
+        .queue_size = LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE,
+    };
+
+    ESP_GOTO_ON_ERROR(spi_bus_add_device(spi_strip->spi_host, &spi_dev_cfg, &spi_strip->spi_device), err, TAG, "Failed to add spi device");
+    //ensure the reset time is enough
+    esp_rom_delay_us(10);
+    int clock_resolution_khz = 0;
+    spi_device_get_actual_freq(spi_strip->spi_device, &clock_resolution_khz);
+    // TODO: ideally we should decide the SPI_BYTES_PER_COLOR_BYTE by the real clock resolution
+    // But now, let's fixed the resolution, the downside is, we don't support a clock source whose frequency is not multiple of LED_STRIP_SPI_DEFAULT_RESOLUTION
+    // clock_resolution between 2.2MHz to 2.8MHz is supported
+    ESP_GOTO_ON_FALSE((clock_resolution_khz < LED_STRIP_SPI_DEFAULT_RESOLUTION / 1000 + 300) && (clock_resolution_khz > LED_STRIP_SPI_DEFAULT_RESOLUTION / 1000 - 300), ESP_ERR_NOT_SUPPORTED, err,
+                      TAG, "unsupported clock resolution:%dKHz", clock_resolution_khz);
+
+    if (led_config->led_model != LED_MODEL_WS2812) {
+        ESP_LOGW(TAG, "Only support WS2812. The timing requirements for other models may not be met");
+    }
+
+    spi_strip->component_fmt = component_fmt;
+    spi_strip->enc_lut = s_spi_bit_lut;
+    spi_strip->bytes_per_pixel = bytes_per_pixel;
+    spi_strip->strip_len = led_config->max_leds;
+    if (streaming) {
+        spi_strip->base.set_pixel = led_strip_spi_stream_set_pixel;
+        spi_strip->base.set_pixel_rgbw = led_strip_spi_stream_set_pixel_rgbw;
+        spi_strip->base.set_pixels = led_strip_spi_stream_set_pixels;
+        spi_strip->base.fill = led_strip_spi_stream_fill;
+        spi_strip->base.refresh = led_strip_spi_stream_refresh;
+        spi_strip->base.clear = led_strip_spi_stream_clear;
+    } else {
+        spi_strip->base.set_pixel = led_strip_spi_set_pixel;
+        spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+        spi_strip->base.set_pixels = led_strip_spi_set_pixels;
+        spi_strip->base.fill = led_strip_spi_fill;
+        spi_strip->base.refresh = led_strip_spi_refresh;
+        spi_strip->base.clear = led_strip_spi_clear;
+    }
+    spi_strip->base.set_color_lut = led_strip_spi_set_color_lut;
+    spi_strip->base.del = led_strip_spi_del;
+
+    *ret_strip = &spi_strip->base;
+    return ESP_OK;
+err:
+    if (spi_strip) {
+        if (spi_strip->spi_device) {
+            spi_bus_remove_device(spi_strip->spi_device);
+        }
+        if (spi_strip->spi_host) {
+            spi_bus_free(spi_strip->spi_host);
+        }
+        free(spi_strip->stream_chunks);
+        free(spi_strip);
+    }
+    return ret;
+}
@@ -0,0 +1,285 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_log.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+
+#include "passbox.h"
+#include "actionneurs.h"
+#include "energie.h"
+
+static const char *TAG = "Actionneurs";
+
+// ======================= BROCHES =======================
+static const gpio_num_t broches[SORTIE_NB] = {
+    [SORTIE_VENTILATEUR]        = CONFIG_PASSBOX_GPIO_VENTILATEUR,
+    [SORTIE_VANNE_INJECTION]    = CONFIG_PASSBOX_GPIO_VANNE,
+    [SORTIE_VERROU_STERILE]     = CONFIG_PASSBOX_GPIO_VERROU_STERILE,
+    [SORTIE_VERROU_CONTAMINEE]  = CONFIG_PASSBOX_GPIO_VERROU_CONTAMINEE,
+};
+
+#if CONFIG_PASSBOX_SORTIES_ACTIVES_BAS
+#define NIVEAU_ACTIF    0                       // modules relais à entrée inversée
+#else
+#define NIVEAU_ACTIF    1
+#endif
+
+// ======================= PWM EXTRACTEUR =======================
+#define PWM_MODE        LEDC_LOW_SPEED_MODE
+#define PWM_TIMER       LEDC_TIMER_0
+#define PWM_CANAL       LEDC_CHANNEL_0
+#define PWM_RESOLUTION  LEDC_TIMER_10_BIT
+#define PWM_DUTY_MAX    ((1u << 10) - 1)
+
+#define PERIODE_SURVEILLANCE_MS 100
+#define PERIODE_REPOS_MS        1000    // toutes sorties au repos (sommeil léger entre deux relectures)
+
+// ======================= ETAT =======================
+// Masques et valeurs en bits de registre : banc 0 = GPIO 0..31, banc 1 = GPIO 32..
+static uint32_t masque_banc[2] = { 0 };
+static uint32_t commande_banc[2] = { 0 };
+static uint32_t commande_duty = 0;
+static volatile uint8_t commande_sorties = 0;
+static uint32_t coupure_banc[2] = { 0 };        // précalculé : écrit tel quel depuis l'ISR
+static uint8_t coupure_sorties = 0;
+static volatile bool coupure_active = false;    // jusqu'à actionneurs_rearmer()
+static portMUX_TYPE sortie_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t pwm_mutex = NULL;      // commande_duty et registres LEDC ensemble
+static actionneurs_defaut_fn_t signaler_defaut = NULL;
+
+static void etat_vers_bancs(uint8_t sorties, uint32_t banc[2])
+{
+    banc[0] = banc[1] = 0;
+    for (int s = 0; s < SORTIE_NB; s++) {
+        bool actif = sorties & SORTIE_BIT(s);
+        if (actif == NIVEAU_ACTIF) {
+            banc[broches[s] / 32] |= 1u << (broches[s] % 32);
+        }
+    }
+}
+
+// Lecture-modification-écriture sous verrou : les autres broches du banc
+// (bus, périphériques routés par la matrice GPIO) ne sont pas touchées.
+// Toutes les sorties GPIO simples du projet passent par ce module.
+// En IRAM quel que soit le profil : appelée par la coupure d'urgence en ISR.
+static void IRAM_ATTR ecrire_bancs(const uint32_t banc[2])
+{
+    REG_WRITE(GPIO_OUT_REG, (REG_READ(GPIO_OUT_REG) & ~masque_banc[0]) | banc[0]);
+#if SOC_GPIO_PIN_COUNT > 32
+    if (masque_banc[1]) {
+        REG_WRITE(GPIO_OUT1_REG, (REG_READ(GPIO_OUT1_REG) & ~masque_banc[1]) | banc[1]);
+    }
+#endif
+}
+
+// ======================= API =======================
+void actionneurs_appliquer(const actionneurs_etat_t *etat)
+{
+    uint32_t banc[2];
+    etat_vers_bancs(etat->sorties, banc);
+    uint32_t vitesse = etat->vitesse_ventilateur > 100 ? 100 : etat->vitesse_ventilateur;
+    uint32_t duty = (etat->sorties & SORTIE_BIT(SORTIE_VENTILATEUR)) ? vitesse * PWM_DUTY_MAX / 100 : 0;
+    uint8_t sorties = etat->sorties;
+
+    xSemaphoreTake(pwm_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&sortie_mux);
+    // Coupure verrouillée : une transition calculée avant l'urgence ne
+    // ré-alimente pas les sorties coupées par l'ISR
+    if (coupure_active) {
+        banc[0] = coupure_banc[0];
+        banc[1] = coupure_banc[1];
+        sorties = coupure_sorties;
+        duty = 0;
+    }
+    ecrire_bancs(banc);
+    commande_banc[0] = banc[0];
+    commande_banc[1] = banc[1];
+    commande_duty = duty;
+    commande_sorties = sorties;
+    portEXIT_CRITICAL(&sortie_mux);
+
+    // Le rapport cyclique est pris en compte au début de la période PWM suivante (40 µs)
+    ledc_set_duty(PWM_MODE, PWM_CANAL, duty);
+    ledc_update_duty(PWM_MODE, PWM_CANAL);
+    xSemaphoreGive(pwm_mutex);
+}
+
+void actionneurs_regler_vitesse(uint16_t pour_mille)
+{
+    uint32_t duty = (pour_mille > 1000 ? 1000 : pour_mille) * PWM_DUTY_MAX / 1000;
+
+    xSemaphoreTake(pwm_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&sortie_mux);
+    bool alimente = (commande_sorties & SORTIE_BIT(SORTIE_VENTILATEUR)) && !coupure_active;
+    if (alimente) commande_duty = duty;
+    portEXIT_CRITICAL(&sortie_mux);
+
+    if (alimente) {
+        ledc_set_duty(PWM_MODE, PWM_CANAL, duty);
+        ledc_update_duty(PWM_MODE, PWM_CANAL);
+    }
+    xSemaphoreGive(pwm_mutex);
+}
+
+void actionneurs_definir_coupure(const actionneurs_etat_t *etat)
+{
+    uint32_t banc[2];
+    etat_vers_bancs(etat->sorties, banc);
+
+    portENTER_CRITICAL(&sortie_mux);
+    coupure_banc[0] = banc[0];
+    coupure_banc[1] = banc[1];
+    coupure_sorties = etat->sorties;
+    portEXIT_CRITICAL(&sortie_mux);
+}
+
+// Le rapport cyclique PWM n'est pas touché (pilote LEDC non utilisable en
+// ISR) : le relais coupe l'alimentation de l'extracteur, la vitesse est
+// remise à zéro par le prochain actionneurs_appliquer(). La coupure reste
+// verrouillée jusqu'à actionneurs_rearmer().
+bool IRAM_ATTR actionneurs_couper(void)
+{
+    portENTER_CRITICAL_SAFE(&sortie_mux);
+    ecrire_bancs(coupure_banc);
+    commande_banc[0] = coupure_banc[0];
+    commande_banc[1] = coupure_banc[1];
+    commande_sorties = coupure_sorties;
+    coupure_active = true;
+    portEXIT_CRITICAL_SAFE(&sortie_mux);
+
+    // Relecture des broches : le niveau du pad suit la sortie en quelques
+    // cycles APB, la boucle est bornée en cas de court-circuit
+    for (int i = 0; i < 64; i++) {
+        bool ok = ((REG_READ(GPIO_IN_REG) ^ coupure_banc[0]) & masque_banc[0]) == 0;
+#if SOC_GPIO_PIN_COUNT > 32
+        ok = ok && ((REG_READ(GPIO_IN1_REG) ^ coupure_banc[1]) & masque_banc[1]) == 0;
+#endif
+        if (ok) return true;
+    }
+    return false;
+}
+
+void actionneurs_rearmer(void)
+{
+    portENTER_CRITICAL(&sortie_mux);
+    coupure_active = false;
+    portEXIT_CRITICAL(&sortie_mux);
+}
+
+uint8_t IRAM_ATTR actionneurs_sorties_commandees(void)
+{
+    return commande_sorties;
+}
+
+uint32_t actionneurs_verifier(void)
+{
+    uint32_t voulu[2], lu[2], duty;
+
+    portENTER_CRITICAL(&sortie_mux);
+    voulu[0] = commande_banc[0];
+    voulu[1] = commande_banc[1];
+    duty = commande_duty;
+    lu[0] = REG_READ(GPIO_IN_REG);
+#if SOC_GPIO_PIN_COUNT > 32
+    lu[1] = REG_READ(GPIO_IN1_REG);
+#else
+    lu[1] = 0;
+#endif
+    portEXIT_CRITICAL(&sortie_mux);
+
+    uint32_t defauts = 0;
+    for (int s = 0; s < SORTIE_NB; s++) {
+        int b = broches[s] / 32;
+        uint32_t bit = 1u << (broches[s] % 32);
+        if ((lu[b] ^ voulu[b]) & bit) defauts |= SORTIE_BIT(s);
+    }
+    if (ledc_get_duty(PWM_MODE, PWM_CANAL) != duty) defauts |= DEFAUT_VITESSE;
+    return defauts;
+}
+
+// ======================= SURVEILLANCE =======================
+static void actionneurs_task(void *arg)
+{
+    TickType_t reveil = xTaskGetTickCount();
+    uint32_t precedents = 0, signales = 0;
+
+    while (1) {
+        vTaskDelayUntil(&reveil, pdMS_TO_TICKS(energie_au_repos() ? PERIODE_REPOS_MS : PERIODE_SURVEILLANCE_MS));
+
+        // Divergence confirmée sur deux relectures : ignore une commande en
+        // cours d'application (front de la broche, période PWM en cours)
+        uint32_t defauts = actionneurs_verifier();
+        uint32_t confirmes = defauts & precedents;
+        precedents = defauts;
+
+        if (confirmes & ~signales) {
+            ESP_LOGE(TAG, "Sortie(s) en défaut: 0x%02x", (unsigned)confirmes);
+            if (signaler_defaut) signaler_defaut(confirmes);
+        }
+        signales = confirmes;
+    }
+}
+
+// ======================= INIT =======================
+esp_err_t actionneurs_init(actionneurs_defaut_fn_t defaut)
+{
+    pwm_mutex = xSemaphoreCreateMutex();
+    if (!pwm_mutex) return ESP_ERR_NO_MEM;
+
+    uint64_t broches_masque = 0;
+    for (int s = 0; s < SORTIE_NB; s++) {
+        broches_masque |= 1ULL << broches[s];
+        masque_banc[broches[s] / 32] |= 1u << (broches[s] % 32);
+    }
+
+    // Niveau de repos écrit avant d'activer les sorties : pas d'impulsion au démarrage
+    uint32_t repos[2];
+    etat_vers_bancs(0, repos);
+    ecrire_bancs(repos);
+    commande_banc[0] = repos[0];
+    commande_banc[1] = repos[1];
+    actionneurs_definir_coupure(&(actionneurs_etat_t){ 0 });
+
+    // Entrée + sortie : GPIO_IN relit le niveau réel de la broche
+    gpio_config_t io_conf = {
+        .pin_bit_mask = broches_masque,
+        .mode = GPIO_MODE_INPUT_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) return err;
+
+    ledc_timer_config_t timer_cfg = {
+        .speed_mode = PWM_MODE,
+        .duty_resolution = PWM_RESOLUTION,
+        .timer_num = PWM_TIMER,
+        .freq_hz = CONFIG_PASSBOX_PWM_VENTILATEUR_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    err = ledc_timer_config(&timer_cfg);
+    if (err != ESP_OK) return err;
+
+    ledc_channel_config_t canal_cfg = {
+        .gpio_num = CONFIG_PASSBOX_GPIO_PWM_VENTILATEUR,
+        .speed_mode = PWM_MODE,
+        .channel = PWM_CANAL,
+        .timer_sel = PWM_TIMER,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    err = ledc_channel_config(&canal_cfg);
+    if (err != ESP_OK) return err;
+
+    signaler_defaut = defaut;
+    xTaskCreatePinnedToCore(actionneurs_task, "actionneurs_task", 2560, NULL, PASSBOX_PRIO_ACTIONNEURS, NULL,
+                            PASSBOX_COEUR_SECURITE);
+    ESP_LOGI(TAG, "Sorties au repos, surveillance toutes les %d ms", PERIODE_SURVEILLANCE_MS);
+    return ESP_OK;
+}
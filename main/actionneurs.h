@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// ======================= ACTIONNEURS =======================
+// Sorties tout-ou-rien (relais, électrovanne, verrous) et vitesse PWM de
+// l'extracteur. Un état complet est appliqué d'un bloc : une seule écriture
+// du registre de sortie par banc de GPIO, toutes les sorties basculent au
+// même instant. Chaque sortie est relue (niveau réel de la broche, rapport
+// cyclique LEDC) et comparée à la commande par une tâche de surveillance.
+
+typedef enum {
+    SORTIE_VENTILATEUR = 0,         // relais d'alimentation de l'extracteur
+    SORTIE_VANNE_INJECTION,         // électrovanne d'injection du produit
+    SORTIE_VERROU_STERILE,          // gâche de la porte stérile (active = verrouillée)
+    SORTIE_VERROU_CONTAMINEE,       // gâche de la porte contaminée (active = verrouillée)
+    SORTIE_NB
+} sortie_t;
+
+#define SORTIE_BIT(s)           (1u << (s))
+#define DEFAUT_VITESSE          SORTIE_BIT(SORTIE_NB)   // rapport cyclique relu différent
+
+typedef struct {
+    uint8_t sorties;                // SORTIE_BIT() des sorties actives
+    uint8_t vitesse_ventilateur;    // en %, appliquée par PWM
+} actionneurs_etat_t;
+
+// Appelée depuis la tâche de surveillance quand une sortie diverge de sa
+// commande (masque de SORTIE_BIT / DEFAUT_VITESSE, divergences confirmées)
+typedef void (*actionneurs_defaut_fn_t)(uint32_t defauts);
+
+// Toutes les sorties au repos, puis démarrage de la surveillance
+esp_err_t actionneurs_init(actionneurs_defaut_fn_t defaut);
+
+void actionneurs_appliquer(const actionneurs_etat_t *etat);
+
+// Vitesse de l'extracteur en ‰ (régulation), sans toucher aux autres
+// sorties. Ignorée si le relais de l'extracteur n'est pas commandé ou si la
+// coupure d'urgence est active.
+void actionneurs_regler_vitesse(uint16_t pour_mille);
+
+// État appliqué par actionneurs_couper() (par défaut : tout au repos)
+void actionneurs_definir_coupure(const actionneurs_etat_t *etat);
+
+// Coupure d'urgence, appelable depuis une ISR en IRAM : écrit l'état de
+// coupure dans les registres de sortie puis attend la relecture des broches.
+// Retourne false si une broche ne suit pas sa commande. Tant que la coupure
+// n'est pas réarmée, actionneurs_appliquer() applique l'état de coupure.
+bool actionneurs_couper(void);
+void actionneurs_rearmer(void);
+
+// SORTIE_BIT() de la dernière commande écrite (appelable depuis une ISR)
+uint8_t actionneurs_sorties_commandees(void);
+
+// Comparaison immédiate commande / relecture, sans confirmation
+uint32_t actionneurs_verifier(void);
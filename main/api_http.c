@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "api_http.h"
+
+#if CONFIG_PASSBOX_API_HTTP
+
+#include "esp_http_server.h"
+
+#include "passbox.h"
+#include "parametres.h"
+
+static const char *TAG = "API";
+
+// ======================= PARAMETRES =======================
+#define ABONNES_MAX         4           // flux SSE simultanés
+#define ETAT_TAILLE         768
+#define COMMANDE_MAX        16
+#define PERIODE_SSE_MS      250         // changements vus au plus 250 ms après
+#define RENVOI_SSE_US       (1000 * 1000)
+
+static const char ENTETE_SSE[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// ======================= ETAT =======================
+// Tout ce qui suit n'est touché que par la tâche du serveur (handlers,
+// close_fn, travaux de httpd_queue_work)
+static api_http_config_t config;
+static httpd_handle_t serveur = NULL;
+static esp_timer_handle_t timer_sse = NULL;
+static int abonnes[ABONNES_MAX] = { -1, -1, -1, -1 };
+static int nb_abonnes = 0;
+static char etat[ETAT_TAILLE];
+static char trame[ETAT_TAILLE + 8];     // "data: <état>\n\n", rendue une fois par changement
+static size_t trame_len = 0;
+static int64_t trame_us = 0;
+
+static esp_err_t repondre_json(httpd_req_t *req, const char *statut, const char *json)
+{
+    httpd_resp_set_status(req, statut);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    return httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t repondre_etat(httpd_req_t *req)
+{
+    if (!config.etat_json(etat, sizeof(etat))) {
+        return repondre_json(req, "500 Internal Server Error", "{\"erreur\":\"etat trop long\"}");
+    }
+    return repondre_json(req, "200 OK", etat);
+}
+
+// ======================= SSE =======================
+static void retirer_abonne(int fd)
+{
+    for (int i = 0; i < ABONNES_MAX; i++) {
+        if (abonnes[i] == fd) {
+            abonnes[i] = -1;
+            nb_abonnes--;
+        }
+    }
+    // Plus d'abonné : plus de réveil périodique (sommeil léger au repos)
+    if (nb_abonnes == 0) esp_timer_stop(timer_sse);
+}
+
+static void envoyer_trame(int fd)
+{
+    if (httpd_socket_send(serveur, fd, trame, trame_len, 0) < 0) {
+        retirer_abonne(fd);
+        httpd_sess_trigger_close(serveur, fd);
+    }
+}
+
+// Trame rendue si l'état a changé, ou pour le renvoi périodique
+static bool rendre_trame(bool forcer)
+{
+    size_t n = config.etat_json(etat, sizeof(etat));
+    if (!n) return false;
+    int64_t maintenant = esp_timer_get_time();
+    bool change = trame_len != n + 8 || memcmp(trame + 6, etat, n) != 0;
+    if (!change && !forcer && maintenant - trame_us < RENVOI_SSE_US) return false;
+    trame_len = (size_t)snprintf(trame, sizeof(trame), "data: %s\n\n", etat);
+    trame_us = maintenant;
+    return true;
+}
+
+static void diffuser(void *arg)
+{
+    if (!nb_abonnes || !rendre_trame(false)) return;
+    for (int i = 0; i < ABONNES_MAX; i++) {
+        if (abonnes[i] >= 0) envoyer_trame(abonnes[i]);
+    }
+}
+
+static void timer_sse_cb(void *arg)
+{
+    httpd_queue_work(serveur, diffuser, NULL);
+}
+
+// La connexion reste ouverte après le handler : en-tête écrit à la main,
+// trames envoyées ensuite directement sur le socket
+static esp_err_t get_evenements(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    int libre = -1;
+    for (int i = 0; i < ABONNES_MAX; i++) {
+        if (abonnes[i] < 0) libre = i;
+    }
+    if (libre < 0) return repondre_json(req, "503 Service Unavailable", "{\"erreur\":\"trop d'abonnes\"}");
+
+    if (httpd_send(req, ENTETE_SSE, sizeof(ENTETE_SSE) - 1) < 0) return ESP_FAIL;
+    abonnes[libre] = fd;
+    if (nb_abonnes++ == 0) esp_timer_start_periodic(timer_sse, PERIODE_SSE_MS * 1000);
+    ESP_LOGI(TAG, "Flux SSE ouvert (%d abonné(s))", nb_abonnes);
+
+    if (rendre_trame(true)) envoyer_trame(fd);
+    return ESP_OK;
+}
+
+static void fermeture(httpd_handle_t hd, int fd)
+{
+    for (int i = 0; i < ABONNES_MAX; i++) {
+        if (abonnes[i] == fd) {
+            retirer_abonne(fd);
+            ESP_LOGI(TAG, "Flux SSE fermé (%d abonné(s))", nb_abonnes);
+        }
+    }
+    close(fd);
+}
+
+// ======================= COMMANDES =======================
+// Comparaison en temps constant : la durée ne dit rien du jeton
+static bool jeton_valide(httpd_req_t *req)
+{
+    char entete[8 + sizeof(parametres->api_jeton)];
+    if (httpd_req_get_hdr_value_str(req, "Authorization", entete, sizeof(entete)) != ESP_OK) return false;
+    if (strncmp(entete, "Bearer ", 7) != 0) return false;
+
+    const char *recu = entete + 7;
+    size_t n = strlen(parametres->api_jeton);
+    if (strlen(recu) != n) return false;
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++) diff |= recu[i] ^ parametres->api_jeton[i];
+    return diff == 0;
+}
+
+// Corps de la commande authentifiée ; false si la réponse est déjà envoyée
+static bool lire_commande(httpd_req_t *req, char *commande)
+{
+    if (!parametres->api_jeton[0]) {
+        repondre_json(req, "403 Forbidden", "{\"erreur\":\"api_jeton non configure\"}");
+        return false;
+    }
+    if (!jeton_valide(req)) {
+        ESP_LOGW(TAG, "Commande refusée : jeton invalide");
+        httpd_resp_set_hdr(req, "WWW-Authenticate", "Bearer");
+        repondre_json(req, "401 Unauthorized", "{\"erreur\":\"jeton invalide\"}");
+        return false;
+    }
+
+    int n = req->content_len < COMMANDE_MAX ? httpd_req_recv(req, commande, req->content_len) : -1;
+    if (n < 0 || (size_t)n != req->content_len) {
+        repondre_json(req, "400 Bad Request", "{\"erreur\":\"corps invalide\"}");
+        return false;
+    }
+    commande[n] = '\0';
+    commande[strcspn(commande, "\r\n")] = '\0';
+    return true;
+}
+
+// Commande exécutée : état qui la suit, ou 409 et motif du refus
+static esp_err_t repondre_commande(httpd_req_t *req, refus_t refus)
+{
+    if (refus == REFUS_AUCUN) return repondre_etat(req);
+
+    char json[64];
+    snprintf(json, sizeof(json), "{\"erreur\":\"%s\",\"code\":%d}", refus_nom(refus), (int)refus);
+    return repondre_json(req, "409 Conflict", json);
+}
+
+static esp_err_t post_cycle(httpd_req_t *req)
+{
+    char commande[COMMANDE_MAX];
+    if (!lire_commande(req, commande)) return ESP_OK;
+
+    if (strcmp(commande, "depart") == 0) return repondre_commande(req, config.cycle(true));
+    if (strcmp(commande, "arret") == 0) return repondre_commande(req, config.cycle(false));
+    return repondre_json(req, "400 Bad Request", "{\"erreur\":\"depart ou arret attendu\"}");
+}
+
+static esp_err_t post_urgence(httpd_req_t *req)
+{
+    char commande[COMMANDE_MAX];
+    if (!lire_commande(req, commande)) return ESP_OK;
+
+    if (strcmp(commande, "activer") == 0) return repondre_commande(req, config.urgence(true));
+    if (strcmp(commande, "desactiver") == 0) return repondre_commande(req, config.urgence(false));
+    return repondre_json(req, "400 Bad Request", "{\"erreur\":\"activer ou desactiver attendu\"}");
+}
+
+static esp_err_t get_etat(httpd_req_t *req)
+{
+    return repondre_etat(req);
+}
+
+// ======================= INIT =======================
+esp_err_t api_http_init(const api_http_config_t *cfg)
+{
+    config = *cfg;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = timer_sse_cb,
+        .name = "api_sse",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &timer_sse);
+    if (err != ESP_OK) return err;
+
+    httpd_config_t hcfg = HTTPD_DEFAULT_CONFIG();
+    hcfg.server_port = CONFIG_PASSBOX_API_PORT;
+    hcfg.core_id = PASSBOX_COEUR_RESEAU;
+    hcfg.close_fn = fermeture;
+    err = httpd_start(&serveur, &hcfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Serveur HTTP: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    static const httpd_uri_t uris[] = {
+        { .uri = "/api/etat",       .method = HTTP_GET,  .handler = get_etat },
+        { .uri = "/api/evenements", .method = HTTP_GET,  .handler = get_evenements },
+        { .uri = "/api/cycle",      .method = HTTP_POST, .handler = post_cycle },
+        { .uri = "/api/urgence",    .method = HTTP_POST, .handler = post_urgence },
+    };
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        httpd_register_uri_handler(serveur, &uris[i]);
+    }
+
+    ESP_LOGI(TAG, "API HTTP sur le port %d%s", CONFIG_PASSBOX_API_PORT,
+             parametres->api_jeton[0] ? "" : " (lecture seule : api_jeton vide)");
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t api_http_init(const api_http_config_t *cfg)
+{
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "passbox.h"
+
+// ======================= API HTTP LOCALE =======================
+// Serveur HTTP sur le réseau du poste, indépendant du broker : état en JSON,
+// commandes de cycle et d'urgence authentifiées par jeton (paramètre
+// api_jeton, vide : commandes refusées), flux Server-Sent Events.
+//
+//   GET  /api/etat          état courant
+//   GET  /api/evenements    flux SSE : une trame "data: <état>" à chaque
+//                           changement, au moins une par seconde
+//   POST /api/cycle         "depart" | "arret"           Authorization: Bearer <jeton>
+//   POST /api/urgence       "activer" | "desactiver"     Authorization: Bearer <jeton>
+//
+// Les commandes acceptées répondent par l'état qui les suit, les commandes
+// refusées par 409 et le motif du nack MQTT équivalent :
+//   {"erreur":"portes_ouvertes","code":2}
+// Les trames SSE sont
+// rendues une fois dans un buffer et envoyées telles quelles à tous les
+// abonnés, depuis la tâche du serveur.
+
+typedef struct {
+    // État courant en JSON ; longueur écrite, 0 si le buffer est trop petit.
+    // Appelée depuis la tâche du serveur.
+    size_t (*etat_json)(char *buf, size_t taille);
+    // Commandes : REFUS_AUCUN si acceptée, motif du refus sinon
+    refus_t (*cycle)(bool depart);
+    refus_t (*urgence)(bool active);
+} api_http_config_t;
+
+// Sans effet si CONFIG_PASSBOX_API_HTTP n'est pas activé
+esp_err_t api_http_init(const api_http_config_t *cfg);
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_cpu.h"
+#include "esp_clk_tree.h"
+#include "sdkconfig.h"
+
+#include "passbox.h"
+#include "bench.h"
+#include "evlog.h"
+#include "securite.h"
+#include "stats.h"
+
+#if CONFIG_PASSBOX_BENCH
+
+static uint32_t cpu_mhz(void)
+{
+    uint32_t hz = 0;
+    esp_clk_tree_src_get_freq_hz(SOC_MOD_CLK_CPU, ESP_CLK_TREE_SRC_FREQ_PRECISION_CACHED, &hz);
+    return hz / 1000000;
+}
+
+static void bench_rapporter(const char *nom, uint32_t cycles, uint32_t iterations)
+{
+    printf("BENCH %s %lu\n", nom, (unsigned long)((uint64_t)cycles * 1000 / cpu_mhz() / iterations));
+}
+
+#define BENCH(nom, iterations, instruction)                                 \
+    do {                                                                    \
+        uint32_t _debut = esp_cpu_get_cycle_count();                        \
+        for (uint32_t _i = 0; _i < (iterations); _i++) { instruction; }     \
+        bench_rapporter(nom, esp_cpu_get_cycle_count() - _debut, iterations); \
+    } while (0)
+
+// ======================= ARRET D'URGENCE =======================
+// Front simulé sur le bouton d'arrêt, du front à la coupure des sorties
+// (ISR) et au réveil de la tâche de sécurité, au repos puis sous inondation
+// MQTT. Le pire cas compte plus que la moyenne.
+#define URGENCE_ITERATIONS      200
+#define URGENCE_PERIODE_MS      10      // un tick à 100 Hz
+#define INONDATION_MONTEE_MS    500
+
+typedef struct {
+    TaskHandle_t appelant;
+    uint32_t n;
+    uint32_t somme_coupure;
+    uint32_t somme_tache;
+    uint32_t pire_coupure;
+    uint32_t pire_tache;
+} urgence_mesure_t;
+
+static void urgence_task(void *arg)
+{
+    urgence_mesure_t *m = arg;
+    for (int i = 0; i < URGENCE_ITERATIONS; i++) {
+        uint32_t coupure, tache;
+        if (securite_bench_arret(&coupure, &tache) == ESP_OK) {
+            m->n++;
+            m->somme_coupure += coupure;
+            m->somme_tache += tache;
+            if (coupure > m->pire_coupure) m->pire_coupure = coupure;
+            if (tache > m->pire_tache) m->pire_tache = tache;
+        }
+        vTaskDelay(pdMS_TO_TICKS(URGENCE_PERIODE_MS));
+    }
+    xTaskNotifyGive(m->appelant);
+    vTaskDelete(NULL);
+}
+
+static void bench_urgence(const char *phase)
+{
+    // Sur le cœur de l'ISR (compteurs de cycles propres à chaque cœur), sous
+    // la tâche de sécurité pour qu'elle reprenne la main aussitôt
+    urgence_mesure_t m = { .appelant = xTaskGetCurrentTaskHandle() };
+    if (xTaskCreatePinnedToCore(urgence_task, "bench_urgence", 3072, &m, PASSBOX_PRIO_SECURITE - 1, NULL,
+                                securite_coeur_isr()) != pdPASS) {
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (!m.n) {
+        printf("bench urgence_%s: aucune mesure (urgence active ?)\n", phase);
+        return;
+    }
+
+    char nom[40];
+    snprintf(nom, sizeof(nom), "urgence_coupure_%s_moy", phase);
+    bench_rapporter(nom, m.somme_coupure, m.n);
+    snprintf(nom, sizeof(nom), "urgence_coupure_%s_max", phase);
+    bench_rapporter(nom, m.pire_coupure, 1);
+    snprintf(nom, sizeof(nom), "urgence_tache_%s_moy", phase);
+    bench_rapporter(nom, m.somme_tache, m.n);
+    snprintf(nom, sizeof(nom), "urgence_tache_%s_max", phase);
+    bench_rapporter(nom, m.pire_tache, 1);
+}
+
+void bench_executer(bench_lcd_fn_t lcd_show, bench_charge_fn_t inonder)
+{
+    char buf[96];
+
+    BENCH("evlog_pub", 100, evlog(EVL_MQTT_PUB, "cycle/etape", "1: Extraction air"));
+    BENCH("snprintf_pub", 100, snprintf(buf, sizeof(buf), "PUB [%s] %s", "cycle/etape", "1: Extraction air"));
+
+    char *json = malloc(8192);
+    if (json) {
+        BENCH("stats_json", 10, stats_json(json, 8192));
+        free(json);
+    }
+
+    BENCH("lcd_show", 3, lcd_show("Bench", "lcd_show"));
+
+    lcd_show("Bench", "Arret urgence");
+    bench_urgence("repos");
+    inonder(true);
+    vTaskDelay(pdMS_TO_TICKS(INONDATION_MONTEE_MS));
+    bench_urgence("inondation");
+    uint32_t messages = inonder(false);
+    printf("bench inondation: %lu message(s) publié(s)\n", (unsigned long)messages);
+}
+
+#else
+
+void bench_executer(bench_lcd_fn_t lcd_show, bench_charge_fn_t inonder)
+{
+}
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+// ======================= BENCHMARKS DE PROFIL =======================
+// Micro-benchmarks exécutés au démarrage si CONFIG_PASSBOX_BENCH est activé.
+// Chaque résultat est imprimé sur une ligne "BENCH <nom> <ns_par_appel>",
+// relue par tools/profil_rapport.py pour comparer les profils debug et prod.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*bench_lcd_fn_t)(const char *l1, const char *l2);
+
+// Charge réseau du banc d'arrêt d'urgence : démarre (true) ou arrête (false)
+// une inondation MQTT ; à l'arrêt, retourne le nombre de messages publiés
+typedef uint32_t (*bench_charge_fn_t)(bool active);
+
+void bench_executer(bench_lcd_fn_t lcd_show, bench_charge_fn_t inonder);
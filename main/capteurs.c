@@ -0,0 +1,348 @@
+#include <stdatomic.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "passbox.h"
+#include "capteurs.h"
+
+#if CONFIG_PASSBOX_CAPTEURS
+
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+static const char *TAG = "Capteurs";
+
+// ======================= ACQUISITION =======================
+#define FREQ_ECHANTILLONNAGE    20000                   // minimum du mode continu sur ESP32
+#define TRAME_RESULTATS         256                     // 12,8 ms, 64 échantillons par canal
+#define TRAME_OCTETS            (TRAME_RESULTATS * SOC_ADC_DIGI_RESULT_BYTES)
+#define ATTENUATION             ADC_ATTEN_DB_12
+#define PEREMPTION_MS           500
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define FORMAT_SORTIE           ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define RESULTAT_CANAL(p)       ((p)->type1.channel)
+#define RESULTAT_DONNEE(p)      ((p)->type1.data)
+#else
+#define FORMAT_SORTIE           ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define RESULTAT_CANAL(p)       ((p)->type2.channel)
+#define RESULTAT_DONNEE(p)      ((p)->type2.data)
+#endif
+
+static const int broches[MESURE_NB] = {
+    [MESURE_PRESSION]       = CONFIG_PASSBOX_GPIO_PRESSION,
+    [MESURE_H2O2]           = CONFIG_PASSBOX_GPIO_H2O2,
+    [MESURE_HUMIDITE]       = CONFIG_PASSBOX_GPIO_HUMIDITE,
+    [MESURE_TEMPERATURE]    = CONFIG_PASSBOX_GPIO_TEMPERATURE,
+};
+
+// ======================= ETALONNAGE =======================
+// Boucle 4-20 mA sur 120 Ω : 480..2400 mV. Hors 3,6..21 mA (NAMUR NE43) : défaut.
+#define MV_4MA                  480
+#define MV_20MA                 2400
+#define MV_DEFAUT_BAS           432
+#define MV_DEFAUT_HAUT          2520
+
+typedef struct {
+    int32_t min;                    // valeur à 4 mA
+    int32_t max;                    // valeur à 20 mA
+} plage_t;
+
+static const plage_t plages[MESURE_NB] = {
+    [MESURE_PRESSION]       = { -100, 100 },    // Pa
+    [MESURE_H2O2]           = { 0, 2000 },      // ppm
+    [MESURE_HUMIDITE]       = { 0, 1000 },      // 0,1 %HR
+    [MESURE_TEMPERATURE]    = { 0, 1000 },      // 0,1 °C
+};
+
+// Droite d'étalonnage mV = origine + (brut - 1000) × pente, relevée une fois
+// sur le schéma eFuse de l'ADC (brut en Q4, pente en Q16)
+#define BRUT_Q                  4
+#define PENTE_Q                 16
+static int32_t origine_mv = 0;
+static int32_t pente_q16 = 0;
+
+// ======================= FILTRES =======================
+// Un échantillon décimé (moyenne de la trame, Q4) entre par canal et par
+// trame. Médiane des 5 derniers, puis moyenne glissante des 8 dernières
+// médianes par somme courante : 5 valeurs triées au plus, moyenne par décalage.
+#define FILTRE_TAILLE           8
+#define FILTRE_MASQUE           (FILTRE_TAILLE - 1)
+#define FILTRE_LOG2             3
+#define MEDIANE_TAILLE          5
+
+_Static_assert((FILTRE_TAILLE & FILTRE_MASQUE) == 0, "filtre: puissance de 2 requise");
+_Static_assert(MEDIANE_TAILLE <= FILTRE_TAILLE, "médiane plus longue que le buffer");
+
+typedef struct {
+    int32_t brut[FILTRE_TAILLE];
+    int32_t mediane[FILTRE_TAILLE];
+    int32_t somme;
+    uint32_t n;
+} filtre_t;
+
+static filtre_t filtres[MESURE_NB];
+
+static int32_t filtrer(filtre_t *f, int32_t x)
+{
+    uint32_t pos = f->n & FILTRE_MASQUE;
+    f->brut[pos] = x;
+
+    // Tri par insertion des derniers échantillons (5 au plus)
+    int32_t tri[MEDIANE_TAILLE];
+    uint32_t k = f->n + 1 < MEDIANE_TAILLE ? f->n + 1 : MEDIANE_TAILLE;
+    for (uint32_t i = 0; i < k; i++) {
+        int32_t v = f->brut[(f->n - i) & FILTRE_MASQUE];
+        uint32_t j = i;
+        while (j > 0 && tri[j - 1] > v) {
+            tri[j] = tri[j - 1];
+            j--;
+        }
+        tri[j] = v;
+    }
+    int32_t med = tri[k / 2];
+
+    f->somme += med - (f->n >= FILTRE_TAILLE ? f->mediane[pos] : 0);
+    f->mediane[pos] = med;
+    f->n++;
+    return f->n >= FILTRE_TAILLE ? f->somme >> FILTRE_LOG2 : f->somme / (int32_t)f->n;
+}
+
+// ======================= PUBLICATION SANS VERROU =======================
+// Séquence impaire pendant l'écriture : un lecteur qui lit deux fois la même
+// valeur paire autour de sa copie a un instantané cohérent. Un seul
+// producteur (capteurs_task).
+static mesures_t publiees;
+static atomic_uint sequence = 0;
+
+static void publier(const mesures_t *m)
+{
+    unsigned s = atomic_load_explicit(&sequence, memory_order_relaxed);
+    atomic_store_explicit(&sequence, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    publiees = *m;
+    atomic_store_explicit(&sequence, s + 2, memory_order_release);
+}
+
+// 1 : instantané cohérent et récent, 0 : pas de mesure récente,
+// -1 : copie concurrente d'une écriture
+static int essayer_lire(mesures_t *m)
+{
+    unsigned s = atomic_load_explicit(&sequence, memory_order_acquire);
+    if (s & 1) return -1;
+    *m = publiees;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&sequence, memory_order_relaxed) != s) return -1;
+    if (s == 0) return 0;
+    return (uint32_t)(esp_timer_get_time() / 1000) - m->horodatage_ms < PEREMPTION_MS;
+}
+
+bool capteurs_lire(mesures_t *m)
+{
+    for (int essai = 0;; essai++) {
+        int r = essayer_lire(m);
+        if (r >= 0) return r;
+        // Producteur interrompu en pleine copie sur ce cœur : lui rendre la main
+        if (essai >= 3) vTaskDelay(1);
+    }
+}
+
+bool capteurs_lire_sans_attente(mesures_t *m)
+{
+    return essayer_lire(m) > 0;
+}
+
+// ======================= TACHE D'ACQUISITION =======================
+static adc_continuous_handle_t adc = NULL;
+static TaskHandle_t tache = NULL;
+static int8_t mesure_du_canal[SOC_ADC_MAX_CHANNEL_NUM];
+static bool actif = false;                      // conversions lancées
+static volatile bool reprise = false;           // filtres à vider avant la trame suivante
+
+static bool IRAM_ATTR conversion_terminee(adc_continuous_handle_t handle,
+                                          const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    BaseType_t reveil = pdFALSE;
+    vTaskNotifyGiveFromISR(tache, &reveil);
+    return reveil == pdTRUE;
+}
+
+static void traiter_trame(const uint8_t *trame, uint32_t octets)
+{
+    uint32_t somme[MESURE_NB] = { 0 }, nb[MESURE_NB] = { 0 };
+
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= octets; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&trame[i];
+        uint32_t canal = RESULTAT_CANAL(p);
+        if (canal >= SOC_ADC_MAX_CHANNEL_NUM || mesure_du_canal[canal] < 0) continue;
+        somme[mesure_du_canal[canal]] += RESULTAT_DONNEE(p);
+        nb[mesure_du_canal[canal]]++;
+    }
+
+    mesures_t m = { 0 };
+    for (int c = 0; c < MESURE_NB; c++) {
+        if (nb[c] == 0) {
+            m.defauts |= MESURE_BIT(c);
+            continue;
+        }
+        int32_t brut_q4 = filtrer(&filtres[c], (int32_t)((somme[c] << BRUT_Q) / nb[c]));
+        int32_t mv = origine_mv + (int32_t)(((int64_t)(brut_q4 - (1000 << BRUT_Q)) * pente_q16) >> (PENTE_Q + BRUT_Q));
+        if (mv < MV_DEFAUT_BAS || mv > MV_DEFAUT_HAUT) m.defauts |= MESURE_BIT(c);
+        m.valeur[c] = plages[c].min +
+                      (int32_t)((int64_t)(mv - MV_4MA) * (plages[c].max - plages[c].min) / (MV_20MA - MV_4MA));
+    }
+    m.horodatage_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    publier(&m);
+}
+
+static void capteurs_task(void *arg)
+{
+    static uint8_t trame[TRAME_OCTETS];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (reprise) {
+            reprise = false;
+            memset(filtres, 0, sizeof(filtres));
+        }
+        uint32_t lus = 0;
+        // Vide le buffer du pilote : plusieurs trames peuvent s'être accumulées
+        while (adc_continuous_read(adc, trame, TRAME_OCTETS, &lus, 0) == ESP_OK) {
+            traiter_trame(trame, lus);
+        }
+    }
+}
+
+// Le pilote ADC continu tient l'APB à pleine fréquence tant qu'il tourne,
+// ce qui interdit le sommeil léger : arrêté au repos. Les mesures d'avant
+// l'arrêt sont périmées à la reprise, les filtres repartent de zéro.
+void capteurs_activer(bool actives)
+{
+    if (!adc || actives == actif) return;
+    actif = actives;
+    if (actives) {
+        reprise = true;
+        adc_continuous_start(adc);
+    } else {
+        adc_continuous_stop(adc);
+    }
+}
+
+// ======================= INIT =======================
+static void etalonner(void)
+{
+    adc_cali_handle_t cali = NULL;
+    adc_cali_line_fitting_config_t cfg = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ATTENUATION,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    int mv1000 = 0, mv3000 = 0;
+    if (adc_cali_create_scheme_line_fitting(&cfg, &cali) == ESP_OK &&
+        adc_cali_raw_to_voltage(cali, 1000, &mv1000) == ESP_OK &&
+        adc_cali_raw_to_voltage(cali, 3000, &mv3000) == ESP_OK) {
+        adc_cali_delete_scheme_line_fitting(cali);
+    } else {
+        // Pas d'étalonnage en eFuse : droite idéale 0..3100 mV à 12 dB
+        ESP_LOGW(TAG, "Etalonnage ADC absent, droite nominale");
+        if (cali) adc_cali_delete_scheme_line_fitting(cali);
+        mv1000 = 757;
+        mv3000 = 2271;
+    }
+    origine_mv = mv1000;
+    pente_q16 = ((mv3000 - mv1000) << PENTE_Q) / 2000;
+}
+
+esp_err_t capteurs_init(void)
+{
+    memset(mesure_du_canal, -1, sizeof(mesure_du_canal));
+
+    adc_digi_pattern_config_t motif[MESURE_NB];
+    for (int c = 0; c < MESURE_NB; c++) {
+        adc_unit_t unite;
+        adc_channel_t canal;
+        esp_err_t err = adc_continuous_io_to_channel(broches[c], &unite, &canal);
+        if (err != ESP_OK || unite != ADC_UNIT_1) {
+            ESP_LOGE(TAG, "GPIO %d: pas une entrée de l'ADC1", broches[c]);
+            return ESP_ERR_INVALID_ARG;
+        }
+        mesure_du_canal[canal] = c;
+        motif[c] = (adc_digi_pattern_config_t){
+            .atten = ATTENUATION,
+            .channel = canal,
+            .unit = ADC_UNIT_1,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+    }
+
+    etalonner();
+
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = 4 * TRAME_OCTETS,
+        .conv_frame_size = TRAME_OCTETS,
+    };
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &adc);
+    if (err != ESP_OK) return err;
+
+    adc_continuous_config_t adc_cfg = {
+        .pattern_num = MESURE_NB,
+        .adc_pattern = motif,
+        .sample_freq_hz = FREQ_ECHANTILLONNAGE,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = FORMAT_SORTIE,
+    };
+    err = adc_continuous_config(adc, &adc_cfg);
+    if (err != ESP_OK) return err;
+
+    if (xTaskCreatePinnedToCore(capteurs_task, "capteurs_task", 3072, NULL, PASSBOX_PRIO_CAPTEURS, &tache,
+                                PASSBOX_COEUR_SECURITE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = conversion_terminee,
+    };
+    err = adc_continuous_register_event_callbacks(adc, &cbs, NULL);
+    if (err != ESP_OK) return err;
+
+    err = adc_continuous_start(adc);
+    if (err != ESP_OK) return err;
+    actif = true;
+
+    ESP_LOGI(TAG, "%d voies à %d Hz, étalonnage %ld mV + %ld/65536 mV par pas",
+             MESURE_NB, FREQ_ECHANTILLONNAGE / MESURE_NB, (long)origine_mv, (long)pente_q16);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t capteurs_init(void)
+{
+    return ESP_OK;
+}
+
+void capteurs_activer(bool actives)
+{
+    (void)actives;
+}
+
+bool capteurs_lire(mesures_t *m)
+{
+    (void)m;
+    return false;
+}
+
+bool capteurs_lire_sans_attente(mesures_t *m)
+{
+    (void)m;
+    return false;
+}
+
+#endif
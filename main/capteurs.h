@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// ======================= CAPTEURS PROCESS =======================
+// Transmetteurs 4-20 mA (shunt 120 Ω) sur l'ADC1 en mode continu : les
+// conversions arrivent par DMA, une tâche les décime par canal puis les
+// filtre en virgule fixe (médiane sur 5 contre les pointes, moyenne glissante
+// sur 8) dans des buffers circulaires. La dernière mesure de tous les canaux
+// est publiée comme un instantané cohérent, lisible sans verrou.
+
+typedef enum {
+    MESURE_PRESSION = 0,            // pression différentielle enceinte / local, Pa
+    MESURE_H2O2,                    // concentration en peroxyde d'hydrogène, ppm
+    MESURE_HUMIDITE,                // humidité relative, 0,1 %HR
+    MESURE_TEMPERATURE,             // température, 0,1 °C
+    MESURE_NB
+} mesure_t;
+
+#define MESURE_BIT(m)           (1u << (m))
+
+typedef struct {
+    int32_t valeur[MESURE_NB];
+    uint32_t defauts;               // MESURE_BIT() : boucle hors 3,6..21 mA (capteur débranché, court-circuit)
+    uint32_t horodatage_ms;         // esp_timer, fin de la dernière trame filtrée
+} mesures_t;
+
+esp_err_t capteurs_init(void);
+
+// Conversions arrêtées (false) ou relancées (true), depuis une seule tâche à
+// la fois. Actives après capteurs_init.
+void capteurs_activer(bool actives);
+
+// Copie la dernière mesure filtrée (depuis une tâche, sans verrou ni attente
+// sur le producteur). Retourne false si aucune mesure récente (< 500 ms).
+bool capteurs_lire(mesures_t *m);
+
+// Une seule tentative, jamais bloquante (callbacks esp_timer) : false aussi
+// quand la copie croise une écriture
+bool capteurs_lire_sans_attente(mesures_t *m);
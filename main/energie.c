@@ -0,0 +1,106 @@
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "energie.h"
+
+#if CONFIG_PASSBOX_VEILLE
+
+#include "esp_pm.h"
+#include "esp_sleep.h"
+
+static const char *TAG = "Energie";
+
+// Fréquence du quartz au repos : PLL arrêtée entre deux réveils. Le pilote
+// Wi-Fi tient lui-même l'APB à 80 MHz le temps de ses échanges.
+#define FREQ_MIN_MHZ    CONFIG_XTAL_FREQ
+#define FREQ_MAX_MHZ    CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+
+// ======================= ETAT =======================
+// esp_pm_lock_acquire/release sont utilisables en section critique
+static portMUX_TYPE energie_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_pm_lock_handle_t verrou_cycle = NULL;        // ESP_PM_CPU_FREQ_MAX
+static esp_pm_lock_handle_t verrou_sorties = NULL;      // ESP_PM_NO_LIGHT_SLEEP
+static bool cycle_actif = false;
+static bool sorties_actives = false;
+static volatile bool repos = false;
+
+static void basculer(esp_pm_lock_handle_t verrou, bool tenu, bool voulu)
+{
+    if (!verrou || tenu == voulu) return;
+    if (voulu) {
+        esp_pm_lock_acquire(verrou);
+    } else {
+        esp_pm_lock_release(verrou);
+    }
+}
+
+// ======================= API =======================
+void energie_appliquer(bool cycle, bool sorties)
+{
+    portENTER_CRITICAL(&energie_mux);
+    basculer(verrou_cycle, cycle_actif, cycle);
+    basculer(verrou_sorties, sorties_actives, sorties);
+    cycle_actif = cycle;
+    sorties_actives = sorties;
+    repos = verrou_cycle && !cycle && !sorties;
+    portEXIT_CRITICAL(&energie_mux);
+}
+
+bool energie_au_repos(void)
+{
+    return repos;
+}
+
+esp_err_t energie_init(void)
+{
+    esp_pm_lock_handle_t cycle = NULL, sorties = NULL;
+    esp_err_t err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "cycle", &cycle);
+    if (err == ESP_OK) err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "sorties", &sorties);
+    if (err != ESP_OK) return err;
+
+    // Entrées armées par gpio_wakeup_enable() (boutons, portes, arrêt)
+    err = esp_sleep_enable_gpio_wakeup();
+    if (err != ESP_OK) return err;
+
+    // Verrous pris selon l'état courant avant d'autoriser le sommeil
+    portENTER_CRITICAL(&energie_mux);
+    verrou_cycle = cycle;
+    verrou_sorties = sorties;
+    basculer(verrou_cycle, false, cycle_actif);
+    basculer(verrou_sorties, false, sorties_actives);
+    repos = !cycle_actif && !sorties_actives;
+    portEXIT_CRITICAL(&energie_mux);
+
+    esp_pm_config_t pm_cfg = {
+        .max_freq_mhz = FREQ_MAX_MHZ,
+        .min_freq_mhz = FREQ_MIN_MHZ,
+        .light_sleep_enable = true,
+    };
+    err = esp_pm_configure(&pm_cfg);
+    if (err != ESP_OK) return err;
+
+    ESP_LOGI(TAG, "CPU %d..%d MHz, sommeil léger au repos", FREQ_MIN_MHZ, FREQ_MAX_MHZ);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t energie_init(void)
+{
+    return ESP_OK;
+}
+
+void energie_appliquer(bool cycle, bool sorties)
+{
+    (void)cycle;
+    (void)sorties;
+}
+
+bool energie_au_repos(void)
+{
+    return false;
+}
+
+#endif
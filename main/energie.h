@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+// ======================= ECONOMIE D'ENERGIE =======================
+// Gestion d'énergie d'ESP-IDF : fréquence CPU variable et sommeil léger
+// automatique (tickless idle) dès que plus rien ne tourne, Wi-Fi en veille
+// modem (association gardée, réveil aux balises DTIM). Deux verrous :
+// - cycle en cours : CPU à pleine fréquence, pas de sommeil ;
+// - sortie ou ventilateur commandé : pas de sommeil, l'arrêt d'urgence
+//   coupe alors sans latence de réveil.
+// Au repos, boutons, portes et arrêt d'urgence réveillent le CPU (GPIO sur
+// niveau) et les tâches périodiques s'espacent.
+
+esp_err_t energie_init(void);
+
+// État courant, après chaque application des sorties. Avant energie_init :
+// mémorisé, appliqué à l'init (pleine fréquence et pas de sommeil d'ici là).
+void energie_appliquer(bool cycle, bool sorties);
+
+// Ni cycle ni sortie, gestion d'énergie active : sommeil permis. Toujours
+// false sans CONFIG_PASSBOX_VEILLE.
+bool energie_au_repos(void);
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_timer.h"
+#include "mbedtls/base64.h"
+#include "sdkconfig.h"
+
+#include "passbox.h"
+#include "energie.h"
+#include "evlog.h"
+
+// ======================= BUFFER CIRCULAIRE =======================
+#define EVLOG_TAILLE        CONFIG_PASSBOX_EVLOG_TAILLE_BUFFER
+#define EVLOG_MASQUE        (EVLOG_TAILLE - 1)
+#define EVLOG_ENTETE        8       // ts_us (u32) | id (u16) | longueur (u8) | réservé (u8)
+#define EVLOG_ARGS_MAX      4
+#define EVLOG_LIGNE_MAX     576     // octets binaires par ligne console
+#define PERIODE_REPOS_MS    1000    // vidage au repos (energie_au_repos)
+#define PERIODE_HORLOGE_US  (600LL * 1000 * 1000)  // EVL_HORLOGE, bien sous 2^31 µs
+
+_Static_assert((EVLOG_TAILLE & EVLOG_MASQUE) == 0, "taille evlog: puissance de 2 requise");
+
+static uint8_t ring[EVLOG_TAILLE];
+static volatile uint32_t tete = 0;      // écrit par les producteurs (sous verrou)
+static volatile uint32_t queue = 0;     // écrit uniquement par evlog_task
+static uint32_t pertes = 0;
+static portMUX_TYPE evlog_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const signatures[EVL_NB] = {
+#define EVLOG_SIG(id, sig, fmt) [id] = sig,
+    EVLOG_MESSAGES(EVLOG_SIG)
+#undef EVLOG_SIG
+};
+
+// ======================= PRODUCTEUR =======================
+PASSBOX_CHEMIN_CRITIQUE void evlog(evlog_id_t id, ...)
+{
+    uint8_t rec[EVLOG_ENTETE + EVLOG_ARGS_MAX * (1 + EVLOG_CHAINE_MAX)];
+    size_t n = EVLOG_ENTETE;
+
+    va_list ap;
+    va_start(ap, id);
+    for (const char *s = signatures[id]; *s; s++) {
+        if (*s == 's') {
+            const char *str = va_arg(ap, const char *);
+            size_t l = strnlen(str, EVLOG_CHAINE_MAX);
+            rec[n++] = (uint8_t)l;
+            memcpy(&rec[n], str, l);
+            n += l;
+        } else {
+            uint32_t v = va_arg(ap, uint32_t);
+            memcpy(&rec[n], &v, sizeof(v));
+            n += sizeof(v);
+        }
+    }
+    va_end(ap);
+
+    rec[4] = id & 0xFF;
+    rec[5] = id >> 8;
+    rec[6] = (uint8_t)(n - EVLOG_ENTETE);
+    rec[7] = 0;
+
+    // Horodatage pris sous le verrou : l'ordre du buffer est celui des
+    // horodatages, quel que soit le cœur ou la priorité du producteur
+    portENTER_CRITICAL_SAFE(&evlog_mux);
+    uint32_t ts = (uint32_t)esp_timer_get_time();
+    memcpy(&rec[0], &ts, sizeof(ts));
+    uint32_t t = tete;
+    if (EVLOG_TAILLE - (t - queue) < n) {
+        pertes++;
+    } else {
+        uint32_t pos = t & EVLOG_MASQUE;
+        uint32_t premier = EVLOG_TAILLE - pos;
+        if (premier >= n) {
+            memcpy(&ring[pos], rec, n);
+        } else {
+            memcpy(&ring[pos], rec, premier);
+            memcpy(&ring[0], rec + premier, n - premier);
+        }
+        tete = t + n;
+    }
+    portEXIT_CRITICAL_SAFE(&evlog_mux);
+}
+
+// ======================= CONSOMMATEUR =======================
+static void ring_lire(uint32_t depuis, uint8_t *dst, size_t n)
+{
+    uint32_t pos = depuis & EVLOG_MASQUE;
+    uint32_t premier = EVLOG_TAILLE - pos;
+    if (premier >= n) {
+        memcpy(dst, &ring[pos], n);
+    } else {
+        memcpy(dst, &ring[pos], premier);
+        memcpy(dst + premier, &ring[0], n - premier);
+    }
+}
+
+// Poids fort de l'horloge 64 bits, au démarrage puis toutes les 10 min : le
+// décodeur recale ses horodatages 32 bits même après un long silence (poste
+// au repos) ou une capture prise en cours de route. Pas à l'approche d'un
+// rebouclage du poids faible, qui pourrait survenir avant l'horodatage.
+static void horloge(void)
+{
+    static int64_t derniere = -PERIODE_HORLOGE_US;
+    int64_t maintenant = esp_timer_get_time();
+    if (maintenant - derniere < PERIODE_HORLOGE_US || (uint32_t)maintenant > UINT32_MAX - 1000000) return;
+    evlog(EVL_HORLOGE, (uint32_t)(maintenant >> 32));
+    derniere = maintenant;
+}
+
+static void evlog_task(void *arg)
+{
+    static uint8_t bin[EVLOG_LIGNE_MAX];
+    static unsigned char b64[(EVLOG_LIGNE_MAX + 2) / 3 * 4 + 1];
+
+    while (1) {
+        // Au repos : vidage espacé, le CPU dort entre deux passages
+        vTaskDelay(pdMS_TO_TICKS(energie_au_repos() ? PERIODE_REPOS_MS : CONFIG_PASSBOX_EVLOG_PERIODE_MS));
+        horloge();
+
+        portENTER_CRITICAL(&evlog_mux);
+        uint32_t fin = tete;
+        uint32_t perdus = pertes;
+        pertes = 0;
+        portEXIT_CRITICAL(&evlog_mux);
+
+        if (perdus) {
+            evlog(EVL_PERTES, perdus);
+            fin = tete;
+        }
+
+        uint32_t q = queue;
+        while (q != fin) {
+            // Lignes composées d'enregistrements entiers : une ligne perdue
+            // ou tronquée ne désynchronise pas le décodeur.
+            size_t n = 0;
+            while (q + n != fin) {
+                uint8_t entete[EVLOG_ENTETE];
+                ring_lire(q + n, entete, EVLOG_ENTETE);
+                size_t l = EVLOG_ENTETE + entete[6];
+                if (n + l > sizeof(bin)) break;
+                ring_lire(q + n, bin + n, l);
+                n += l;
+            }
+            q += n;
+
+            portENTER_CRITICAL(&evlog_mux);
+            queue = q;
+            portEXIT_CRITICAL(&evlog_mux);
+
+            size_t olen = 0;
+            if (mbedtls_base64_encode(b64, sizeof(b64), &olen, bin, n) == 0) {
+                printf("EVL:%.*s\n", (int)olen, b64);
+            }
+        }
+    }
+}
+
+void evlog_init(void)
+{
+    xTaskCreatePinnedToCore(evlog_task, "evlog_task", 3072, NULL, 1, NULL, PASSBOX_COEUR_RESEAU);
+}
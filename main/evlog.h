@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "evlog_ids.h"
+
+// ======================= EVLOG : LOG BINAIRE DIFFERE =======================
+// Sur les chemins chauds, on n'enregistre qu'un identifiant de message, un
+// horodatage et les arguments bruts dans un buffer circulaire (quelques
+// centaines de ns, utilisable en ISR). Une tâche basse priorité vide le buffer
+// sur la console sous forme de lignes "EVL:<base64>", décodées hors de
+// l'ESP32 par tools/evlog_decode.py.
+
+#define EVLOG_CHAINE_MAX    32
+
+typedef enum {
+#define EVLOG_ENUM(id, sig, fmt) id,
+    EVLOG_MESSAGES(EVLOG_ENUM)
+#undef EVLOG_ENUM
+    EVL_NB
+} evlog_id_t;
+
+void evlog_init(void);
+
+// Arguments selon la signature déclarée dans evlog_ids.h
+void evlog(evlog_id_t id, ...);
@@ -0,0 +1,19 @@
+#pragma once
+
+// ======================= MESSAGES EVLOG =======================
+// Table partagée avec le décodeur hôte (tools/evlog_decode.py), qui la relit
+// telle quelle : l'identifiant d'un message est son rang dans la liste.
+// Ajouter les nouveaux messages EN FIN de liste pour garder les anciens logs
+// décodables.
+//
+// Signature des arguments : 's' = chaîne (tronquée à EVLOG_CHAINE_MAX),
+// 'u' = entier 32 bits non signé, 'd' = entier 32 bits signé.
+// Le format n'accepte que %s, %u, %d et %x, sans modificateur de longueur.
+
+#define EVLOG_MESSAGES(X) \
+    X(EVL_PERTES,           "u",  "%u evenements perdus (buffer plein)") \
+    X(EVL_MQTT_PUB,         "ss", "PUB [%s] %s") \
+    X(EVL_MQTT_RX,          "ss", "RX [%s] %s") \
+    X(EVL_ETAPE,            "us", "--- Etape %u: %s ---") \
+    X(EVL_PORTE,            "ss", "Porte %s %s") \
+    X(EVL_HORLOGE,          "u",  "Horloge : poids fort %u (x 2^32 us)")
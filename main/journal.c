@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+
+#include "passbox.h"
+#include "journal.h"
+
+static const char *TAG = "Journal";
+
+// ======================= FORMAT FLASH =======================
+// Secteur (4 Ko) = en-tête 16 octets + 255 enregistrements de 16 octets.
+// L'enregistrement d'index i d'un secteur porte la séquence premier_seq + i :
+// une séquence se retrouve sans parcourir le journal.
+#define JOURNAL_SUBTYPE         0x40
+#define JOURNAL_MAGIC           0x314A4250      // "PBJ1"
+#define SECTEUR_TAILLE          4096
+#define ENREG_TAILLE            16
+#define ENREG_PAR_SECTEUR       ((SECTEUR_TAILLE - sizeof(entete_secteur_t)) / ENREG_TAILLE)
+#define NB_SECTEURS_MAX         128
+
+#define FILE_TAILLE             128             // enregistrements en attente d'écriture
+#define PERIODE_ECRITURE_MS     1000
+#define LOT_RELECTURE           32
+#define RELECTURE_MAX           (4 * LOT_RELECTURE)    // enregistrements par commande
+
+typedef struct {
+    uint32_t magic;
+    uint32_t numero;            // compteur de secteurs ouverts, monotone
+    uint32_t premier_seq;
+    uint32_t reserve;
+} entete_secteur_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t uptime_ms;
+    uint32_t unix_s;            // 0 si l'heure n'est pas synchronisée
+    uint8_t evt;
+    uint8_t etape;
+    uint8_t arg;
+    uint8_t crc;
+} enreg_t;
+
+_Static_assert(sizeof(entete_secteur_t) == 16, "en-tête secteur");
+_Static_assert(sizeof(enreg_t) == ENREG_TAILLE, "enregistrement journal");
+
+// ======================= ETAT =======================
+static const esp_partition_t *partition = NULL;
+static uint32_t nb_secteurs = 0;
+static uint32_t premier_seq[NB_SECTEURS_MAX];   // 0 = secteur vide/invalide
+static uint32_t secteur_courant = 0;
+static uint32_t numero_courant = 0;
+static uint32_t index_ecriture = 0;             // prochain emplacement libre
+static SemaphoreHandle_t flash_mutex = NULL;
+
+// File RAM alimentée par journal_ajouter()
+static enreg_t file[FILE_TAILLE];
+static uint32_t file_tete = 0, file_queue = 0;
+static uint32_t prochain_seq = 1;               // attribué à l'ajout
+static uint32_t pertes = 0;
+static portMUX_TYPE file_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t crc8(const uint8_t *d, size_t n)
+{
+    uint8_t crc = 0;
+    while (n--) {
+        crc ^= *d++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t secteur_offset(uint32_t s)
+{
+    return s * SECTEUR_TAILLE;
+}
+
+static uint32_t enreg_offset(uint32_t s, uint32_t index)
+{
+    return secteur_offset(s) + sizeof(entete_secteur_t) + index * ENREG_TAILLE;
+}
+
+// ======================= SECTEURS =======================
+static esp_err_t secteur_ouvrir(uint32_t s, uint32_t numero, uint32_t seq)
+{
+    premier_seq[s] = 0;
+    esp_err_t err = esp_partition_erase_range(partition, secteur_offset(s), SECTEUR_TAILLE);
+    if (err != ESP_OK) return err;
+
+    entete_secteur_t e = { .magic = JOURNAL_MAGIC, .numero = numero, .premier_seq = seq, .reserve = 0xFFFFFFFF };
+    err = esp_partition_write(partition, secteur_offset(s), &e, sizeof(e));
+    if (err != ESP_OK) return err;
+
+    premier_seq[s] = seq;
+    secteur_courant = s;
+    numero_courant = numero;
+    index_ecriture = 0;
+    return ESP_OK;
+}
+
+// Retrouve le secteur le plus récent et le premier emplacement libre
+static esp_err_t journal_recuperer(void)
+{
+    bool trouve = false;
+    for (uint32_t s = 0; s < nb_secteurs; s++) {
+        entete_secteur_t e;
+        premier_seq[s] = 0;
+        if (esp_partition_read(partition, secteur_offset(s), &e, sizeof(e)) != ESP_OK) continue;
+        if (e.magic != JOURNAL_MAGIC) continue;
+        premier_seq[s] = e.premier_seq;
+        if (!trouve || e.numero > numero_courant) {
+            trouve = true;
+            secteur_courant = s;
+            numero_courant = e.numero;
+        }
+    }
+
+    if (!trouve) {
+        ESP_LOGW(TAG, "Journal vide, initialisation");
+        prochain_seq = 1;
+        return secteur_ouvrir(0, 0, prochain_seq);
+    }
+
+    // Un enregistrement interrompu par une coupure garde sa place (la flash
+    // NOR ne se réécrit pas sans effacement) : seul 0xFF marque un emplacement libre.
+    index_ecriture = ENREG_PAR_SECTEUR;
+    for (uint32_t i = 0; i < ENREG_PAR_SECTEUR; i++) {
+        uint32_t seq;
+        esp_partition_read(partition, enreg_offset(secteur_courant, i), &seq, sizeof(seq));
+        if (seq == 0xFFFFFFFF) {
+            index_ecriture = i;
+            break;
+        }
+    }
+    prochain_seq = premier_seq[secteur_courant] + index_ecriture;
+    ESP_LOGI(TAG, "Journal: secteur %lu, prochaine séquence %lu",
+             (unsigned long)secteur_courant, (unsigned long)prochain_seq);
+    return ESP_OK;
+}
+
+static void ecrire_lot(const enreg_t *lot, uint32_t n)
+{
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    while (n) {
+        if (index_ecriture == ENREG_PAR_SECTEUR) {
+            uint32_t suivant = (secteur_courant + 1) % nb_secteurs;
+            if (secteur_ouvrir(suivant, numero_courant + 1, lot[0].seq) != ESP_OK) {
+                ESP_LOGE(TAG, "Effacement secteur %lu impossible", (unsigned long)suivant);
+                break;
+            }
+        }
+        uint32_t k = ENREG_PAR_SECTEUR - index_ecriture;
+        if (k > n) k = n;
+        esp_err_t err = esp_partition_write(partition, enreg_offset(secteur_courant, index_ecriture),
+                                            lot, k * ENREG_TAILLE);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Ecriture journal: %s", esp_err_to_name(err));
+        }
+        index_ecriture += k;
+        lot += k;
+        n -= k;
+    }
+    xSemaphoreGive(flash_mutex);
+}
+
+// ======================= TACHE D'ECRITURE =======================
+static void journal_task(void *arg)
+{
+    static enreg_t lot[FILE_TAILLE];
+    TickType_t reveil = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&reveil, pdMS_TO_TICKS(PERIODE_ECRITURE_MS));
+
+        uint32_t perdus;
+        portENTER_CRITICAL(&file_mux);
+        perdus = pertes;
+        pertes = 0;
+        portEXIT_CRITICAL(&file_mux);
+        if (perdus) {
+            journal_ajouter(JOURNAL_PERTES, 0, perdus > 255 ? 255 : perdus);
+        }
+
+        uint32_t n = 0;
+        portENTER_CRITICAL(&file_mux);
+        while (file_queue != file_tete) {
+            lot[n++] = file[file_queue % FILE_TAILLE];
+            file_queue++;
+        }
+        portEXIT_CRITICAL(&file_mux);
+
+        if (n) ecrire_lot(lot, n);
+    }
+}
+
+// ======================= API =======================
+esp_err_t journal_init(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, JOURNAL_SUBTYPE, "journal");
+    if (!partition) {
+        ESP_LOGE(TAG, "Partition 'journal' absente (partitions.csv)");
+        return ESP_ERR_NOT_FOUND;
+    }
+    nb_secteurs = partition->size / SECTEUR_TAILLE;
+    if (nb_secteurs > NB_SECTEURS_MAX) nb_secteurs = NB_SECTEURS_MAX;
+    if (nb_secteurs < 2) return ESP_ERR_INVALID_SIZE;
+
+    flash_mutex = xSemaphoreCreateMutex();
+    assert(flash_mutex != NULL);
+
+    esp_err_t err = journal_recuperer();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Récupération du journal: %s", esp_err_to_name(err));
+        partition = NULL;
+        return err;
+    }
+
+    xTaskCreatePinnedToCore(journal_task, "journal_task", 3072, NULL, 2, NULL, PASSBOX_COEUR_RESEAU);
+    journal_ajouter(JOURNAL_DEMARRAGE, 0, 0);
+    return ESP_OK;
+}
+
+void journal_ajouter(journal_evt_t evt, uint8_t etape, uint8_t arg)
+{
+    if (!partition) return;
+
+    time_t maintenant = time(NULL);
+    enreg_t r = {
+        .uptime_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        .unix_s = maintenant > 1700000000 ? (uint32_t)maintenant : 0,
+        .evt = evt,
+        .etape = etape,
+        .arg = arg,
+    };
+
+    portENTER_CRITICAL(&file_mux);
+    if (file_tete - file_queue >= FILE_TAILLE) {
+        pertes++;
+    } else {
+        r.seq = prochain_seq++;
+        r.crc = crc8((const uint8_t *)&r, ENREG_TAILLE - 1);
+        file[file_tete % FILE_TAILLE] = r;
+        file_tete++;
+    }
+    portEXIT_CRITICAL(&file_mux);
+}
+
+// Secteur contenant seq, ou -1 s'il a été recyclé
+static int secteur_de(uint32_t seq)
+{
+    for (uint32_t s = 0; s < nb_secteurs; s++) {
+        if (premier_seq[s] && seq >= premier_seq[s] && seq < premier_seq[s] + ENREG_PAR_SECTEUR) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+static uint32_t plus_ancien_seq(void)
+{
+    uint32_t min = 0;
+    for (uint32_t s = 0; s < nb_secteurs; s++) {
+        if (premier_seq[s] && (min == 0 || premier_seq[s] < min)) min = premier_seq[s];
+    }
+    return min;
+}
+
+uint32_t journal_lire(uint32_t debut, uint32_t fin, journal_publier_fn_t publier)
+{
+    // Appelée uniquement depuis la tâche MQTT
+    static enreg_t copie[RELECTURE_MAX];
+    static char json[2048];
+    if (!partition) return 0;
+
+    // Copie bornée sous le mutex : la tâche d'écriture n'attend que la
+    // lecture flash, pas les publications
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    uint32_t dernier = premier_seq[secteur_courant] + index_ecriture - 1;   // dernier écrit en flash
+    uint32_t ancien = plus_ancien_seq();
+    if (debut < ancien) debut = ancien;
+    if (fin > dernier) fin = dernier;
+    bool tronquee = debut <= fin && fin - debut >= RELECTURE_MAX;
+    if (tronquee) fin = debut + RELECTURE_MAX - 1;
+
+    int nb = 0;
+    for (uint32_t seq = debut; seq <= fin && debut <= fin; seq++) {
+        int s = secteur_de(seq);
+        if (s < 0) continue;
+        enreg_t *r = &copie[nb];
+        esp_partition_read(partition, enreg_offset(s, seq - premier_seq[s]), r, sizeof(*r));
+        if (r->seq != seq || r->crc != crc8((const uint8_t *)r, ENREG_TAILLE - 1)) continue;
+        nb++;
+    }
+    xSemaphoreGive(flash_mutex);
+
+    // Séquence à demander ensuite, 0 si la plage est épuisée
+    uint32_t suivant = tronquee ? fin + 1 : 0;
+    int i = 0;
+    do {
+        int n = snprintf(json, sizeof(json), "{\"ancien\":%lu,\"dernier\":%lu,\"suivant\":",
+                         (unsigned long)ancien, (unsigned long)dernier);
+        n += snprintf(json + n, sizeof(json) - n, suivant ? "%lu,\"r\":[" : "null,\"r\":[",
+                      (unsigned long)suivant);
+        for (int k = 0; k < LOT_RELECTURE && i < nb; k++, i++) {
+            const enreg_t *r = &copie[i];
+            // [seq, unix_s, uptime_ms, evt, etape, arg]
+            n += snprintf(json + n, sizeof(json) - n, "%s[%lu,%lu,%lu,%u,%u,%u]", k ? "," : "",
+                          (unsigned long)r->seq, (unsigned long)r->unix_s, (unsigned long)r->uptime_ms,
+                          r->evt, r->etape, r->arg);
+        }
+        snprintf(json + n, sizeof(json) - n, "]}");
+        publier(json);
+    } while (i < nb);
+    return suivant;
+}
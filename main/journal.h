@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// ======================= JOURNAL D'AUDIT =======================
+// Journal binaire en ajout seul dans la partition "journal" : chaque
+// transition d'état reçoit un numéro de séquence monotone et un horodatage.
+// Les secteurs sont utilisés en anneau (usure uniforme) et les écritures sont
+// regroupées par une tâche dédiée : au plus une écriture flash par seconde.
+
+typedef enum {
+    JOURNAL_DEMARRAGE = 0,
+    JOURNAL_CYCLE_DEPART,
+    JOURNAL_ETAPE,              // etape = nouvelle étape
+    JOURNAL_CYCLE_TERMINE,
+    JOURNAL_CYCLE_ARRETE,
+    JOURNAL_URGENCE_ON,
+    JOURNAL_URGENCE_OFF,
+    JOURNAL_PORTE_STERILE,      // arg = 1 ouverte, 0 fermée
+    JOURNAL_PORTE_CONTAMINEE,   // arg = 1 ouverte, 0 fermée
+    JOURNAL_REFUS,              // arg = refus_t (passbox.h)
+    JOURNAL_PERTES,             // arg = nombre d'événements perdus (saturé à 255)
+} journal_evt_t;
+
+esp_err_t journal_init(void);
+
+// Non bloquant, utilisable depuis n'importe quelle tâche
+void journal_ajouter(journal_evt_t evt, uint8_t etape, uint8_t arg);
+
+// Relecture par plage de séquences [debut, fin] : au plus 128 enregistrements
+// par appel, publiés par lots JSON via la fonction fournie. Retourne la
+// séquence à demander ensuite (aussi publiée dans "suivant"), 0 si la plage
+// est épuisée.
+typedef void (*journal_publier_fn_t)(const char *json);
+uint32_t journal_lire(uint32_t debut, uint32_t fin, journal_publier_fn_t publier);
@@ -1,5 +1,7 @@
 
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
@@ -14,46 +16,200 @@
 #include "esp_netif.h"
 #include "esp_event.h"
 #include "esp_wifi.h"
+#include "esp_mac.h"
 
 #include "mqtt_client.h"
 #include "driver/gpio.h"
+#include "hal/gpio_ll.h"
 
 #include "driver/i2c_master.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_netif_sntp.h"
 #include "string.h"
 
+#include "passbox.h"
+#include "evlog.h"
+#include "stats.h"
+#include "bench.h"
+#include "journal.h"
+#include "voyant.h"
+#include "actionneurs.h"
+#include "securite.h"
+#include "capteurs.h"
+#include "regulation.h"
+#include "mqtt_tls.h"
+#include "reseau.h"
+#include "parametres.h"
+#include "energie.h"
+#include "ota.h"
+#include "api_http.h"
+
 // ======================= CONFIG =======================
-#define WIFI_SSID   "globalnet"
-#define WIFI_PASS   "changeme"
+// Wi-Fi, broker, espace de noms des topics, broches et durées d'étape : registre
+// en NVS (parametres.c), modifiable par cmd/config
 
-// HiveMQ Cloud (sans TLS pour simplifier)
-#define MQTT_URI    "mqtt://broker.hivemq.com:1883"
+// ======================= GPIO =======================
+#define BTN_DEPART              ((gpio_num_t)parametres->gpio_depart)
+#define BTN_ARRET               ((gpio_num_t)parametres->gpio_arret)             // traité en interruption (securite.c)
+#define BTN_STERILE_OUVERT      ((gpio_num_t)parametres->gpio_sterile_ouvert)    // demandes d'ouverture : l'état des
+#define BTN_CONTAMINEE_OUVERT   ((gpio_num_t)parametres->gpio_contaminee_ouvert) // portes vient des capteurs
+
+// ======================= TOPICS =======================
+// Noms complets (<site>/<salle>/<poste>/nom) construits une fois au
+// démarrage : mqtt_pub ne formate rien. Les commandes de groupe atteignent
+// tous les postes d'une salle (<site>/<salle>/cmd/...) ou du site
+// (<site>/cmd/...) ; vides sans site ou sans salle.
+typedef enum {
+    // Publisher
+    T_CYCLE_DEPART = 0,
+    T_CYCLE_ETAPE,
+    T_URGENCE,
+    T_PORTE_STERILE,
+    T_PORTE_CONTAM,
+    T_STATS,
+    T_JOURNAL,
+    T_DIAG_SECURITE,
+    T_MESURES,
+    T_DIAG_MQTT,
+    T_CONFIG,
+    T_BENCH_INONDATION,
+    T_OTA,
+    T_REPONSE,
+    // Subscriber
+    T_CMD_URGENCE,
+    T_CMD_CYCLE_DEPART,
+    T_CMD_STATS,
+    T_CMD_JOURNAL,
+    T_CMD_CONFIG,
+    T_CMD_OTA,
+    T_CMD_OTA_BLOC,
+    T_SALLE_CMD_URGENCE,
+    T_SALLE_CMD_STATS,
+    T_SITE_CMD_URGENCE,
+    T_SITE_CMD_STATS,
+    T_NB
+} topic_t;
 
+typedef enum {
+    PORTEE_POSTE = 0,
+    PORTEE_SALLE,
+    PORTEE_SITE,
+    PORTEE_NB
+} portee_t;
+
+static const char *const topic_noms[T_NB] = {
+    [T_CYCLE_DEPART]        = "cycle/depart",
+    [T_CYCLE_ETAPE]         = "cycle/etape",
+    [T_URGENCE]             = "urgence",
+    [T_PORTE_STERILE]       = "porte/sterile",
+    [T_PORTE_CONTAM]        = "porte/contaminee",
+    [T_STATS]               = "stats",
+    [T_JOURNAL]             = "journal",
+    [T_DIAG_SECURITE]       = "diag/securite",
+    [T_MESURES]             = "mesures",
+    [T_DIAG_MQTT]           = "diag/mqtt",
+    [T_CONFIG]              = "config",
+    [T_BENCH_INONDATION]    = "bench/inondation",
+    [T_OTA]                 = "ota",
+    [T_REPONSE]             = "reponse",
+    [T_CMD_URGENCE]         = "cmd/urgence",
+    [T_CMD_CYCLE_DEPART]    = "cmd/cycle/depart",
+    [T_CMD_STATS]           = "cmd/stats",
+    [T_CMD_JOURNAL]         = "cmd/journal",
+    [T_CMD_CONFIG]          = "cmd/config",
+    [T_CMD_OTA]             = "cmd/ota",
+    [T_CMD_OTA_BLOC]        = "cmd/ota/bloc",
+    [T_SALLE_CMD_URGENCE]   = "cmd/urgence",
+    [T_SALLE_CMD_STATS]     = "cmd/stats",
+    [T_SITE_CMD_URGENCE]    = "cmd/urgence",
+    [T_SITE_CMD_STATS]      = "cmd/stats",
+};
+
+static const uint8_t topic_portees[T_NB] = {
+    [T_SALLE_CMD_URGENCE]   = PORTEE_SALLE,
+    [T_SALLE_CMD_STATS]     = PORTEE_SALLE,
+    [T_SITE_CMD_URGENCE]    = PORTEE_SITE,
+    [T_SITE_CMD_STATS]      = PORTEE_SITE,
+};
+
+// "site/salle/poste/" : chaque champ avec son '\0' tient son '/', plus un '\0'
+#define PREFIXE_MAX     (sizeof(((parametres_t *)0)->site) + sizeof(((parametres_t *)0)->salle) + \
+                         sizeof(((parametres_t *)0)->poste) + 1)
+#define TOPIC_NOM_MAX   24                  // "cmd/cycle/depart" : 16
+
+static char topics[T_NB][PREFIXE_MAX + TOPIC_NOM_MAX];
+static size_t prefixe_poste_len = 0;
+
+static void topics_init(void)
+{
+    char prefixes[PORTEE_NB][PREFIXE_MAX] = { "" };
+    const parametres_t *p = parametres;
+
+    if (p->site[0]) {
+        char poste[sizeof(p->poste)];
+        if (p->poste[0]) {
+            strlcpy(poste, p->poste, sizeof(poste));
+        } else {
+            uint8_t mac[6] = { 0 };
+            esp_read_mac(mac, ESP_MAC_WIFI_STA);
+            snprintf(poste, sizeof(poste), "passbox-%02x%02x%02x", mac[3], mac[4], mac[5]);
+        }
+        snprintf(prefixes[PORTEE_SITE], sizeof(prefixes[0]), "%s/", p->site);
+        if (p->salle[0]) {
+            snprintf(prefixes[PORTEE_SALLE], sizeof(prefixes[0]), "%s/%s/", p->site, p->salle);
+            snprintf(prefixes[PORTEE_POSTE], sizeof(prefixes[0]), "%s/%s/%s/", p->site, p->salle, poste);
+        } else {
+            snprintf(prefixes[PORTEE_POSTE], sizeof(prefixes[0]), "%s/%s/", p->site, poste);
+        }
+    }
+    prefixe_poste_len = strlen(prefixes[PORTEE_POSTE]);
+
+    for (int i = 0; i < T_NB; i++) {
+        portee_t portee = topic_portees[i];
+        if (portee != PORTEE_POSTE && !prefixes[portee][0]) {
+            topics[i][0] = '\0';
+        } else {
+            snprintf(topics[i], sizeof(topics[i]), "%s%s", prefixes[portee], topic_noms[i]);
+        }
+    }
+    ESP_LOGI(TAG, "Topics: %s...", prefixes[PORTEE_POSTE]);
+}
 
-// ======================= GPIO =======================
-#define BTN_DEPART              GPIO_NUM_27
-#define BTN_ARRET               GPIO_NUM_14
-#define BTN_STERILE_OUVERT      GPIO_NUM_26
-#define BTN_STERILE_FERME       GPIO_NUM_25
-#define BTN_CONTAMINEE_OUVERT   GPIO_NUM_13
-#define BTN_CONTAMINEE_FERME    GPIO_NUM_12
-
-// ======================= TOPICS Publisher =======================
-#define TOPIC_CYCLE_DEPART      "cycle/depart"
-#define TOPIC_CYCLE_ETAPE       "cycle/etape"
-#define TOPIC_URGENCE           "urgence"
-#define TOPIC_PORTE_STERILE     "porte/sterile"
-#define TOPIC_PORTE_CONTAM      "porte/contaminee"
-
-// ======================= TOPICS subscriber =======================
-#define TOPIC_CMD_URGENCE       "cmd/urgence"
-#define TOPIC_CMD_CYCLE_DEPART  "cmd/cycle/depart"
+// Nom sans le préfixe du poste, pour evlog (chaînes tronquées à 32 octets)
+static const char *topic_court(const char *topic)
+{
+    return strncmp(topic, topics[T_CYCLE_DEPART], prefixe_poste_len) == 0 ? topic + prefixe_poste_len : topic;
+}
+
+#define TOPIC_CYCLE_DEPART      topics[T_CYCLE_DEPART]
+#define TOPIC_CYCLE_ETAPE       topics[T_CYCLE_ETAPE]
+#define TOPIC_URGENCE           topics[T_URGENCE]
+#define TOPIC_PORTE_STERILE     topics[T_PORTE_STERILE]
+#define TOPIC_PORTE_CONTAM      topics[T_PORTE_CONTAM]
+#define TOPIC_STATS             topics[T_STATS]
+#define TOPIC_JOURNAL           topics[T_JOURNAL]
+#define TOPIC_DIAG_SECURITE     topics[T_DIAG_SECURITE]
+#define TOPIC_MESURES           topics[T_MESURES]
+#define TOPIC_DIAG_MQTT         topics[T_DIAG_MQTT]
+#define TOPIC_CONFIG            topics[T_CONFIG]
+#define TOPIC_BENCH_INONDATION  topics[T_BENCH_INONDATION]
+#define TOPIC_OTA               topics[T_OTA]
+#define TOPIC_REPONSE           topics[T_REPONSE]
+#define TOPIC_CMD_URGENCE       topics[T_CMD_URGENCE]
+#define TOPIC_CMD_CYCLE_DEPART  topics[T_CMD_CYCLE_DEPART]
+#define TOPIC_CMD_STATS         topics[T_CMD_STATS]
+#define TOPIC_CMD_JOURNAL       topics[T_CMD_JOURNAL]
+#define TOPIC_CMD_CONFIG        topics[T_CMD_CONFIG]
+#define TOPIC_CMD_OTA           topics[T_CMD_OTA]
+#define TOPIC_CMD_OTA_BLOC      topics[T_CMD_OTA_BLOC]
 
 // ========= CONFIG LCD=========
 #define I2C_PORT        0
-#define I2C_SDA         21
-#define I2C_SCL         22
+#define I2C_SDA         parametres->gpio_i2c_sda
+#define I2C_SCL         parametres->gpio_i2c_scl
 #define I2C_FREQ_HZ     100000
 #define PCF8574_ADDR    0x27   // adresse 0x4E décalée de 1bit de valeur 0 pour R/W
 
@@ -63,28 +219,61 @@
 #define LCD_RW          0x02
 #define LCD_RS          0x01
 
-// ======================= ETAPES DU CYCLE =======================
+// ======================= DUREES DES ETAPES =======================
+// parametres->duree_etape_ms[], modifiables hors cycle par cmd/config
+
+// ======================= FINS D'ETAPE SUR MESURE =======================
 typedef enum {
-    ETAPE_IDLE = 0,
-    ETAPE_EXTRACTION_AIR,           // 1: 3s
-    ETAPE_ARRET_AIR,                // 2: 2s
-    ETAPE_INJECTION_PRODUIT,        // 3: 2s
-    ETAPE_PAUSE_STERILISATION,      // 4: 20s (20min en réel)
-    ETAPE_EXTRACTION_PRODUIT,       // 5: 3s
-    ETAPE_RENOUVELLEMENT_AIR,       // 6: 3s
-    ETAPE_AUTORISATION_STERILE,     // 7: Déverrouillage porte stérile
-    ETAPE_TERMINE                   // 8: Fin
-} etape_cycle_t;
+    FIN_DUREE = 0,                  // durée fixe (parametres->duree_etape_ms)
+    FIN_AU_DESSUS,                  // mesure >= seuil
+    FIN_EN_DESSOUS,                 // mesure <= seuil
+    FIN_DOSE,                       // intégrale de la mesure >= seuil (unité x min)
+} fin_t;
+
+typedef struct {
+    fin_t type;
+    mesure_t mesure;
+    int32_t seuil;
+} fin_etape_t;
+
+// La durée nominale sert alors de base au délai maximal de l'étape
+static const fin_etape_t fin_etape[ETAPE_NB] = {
+#if CONFIG_PASSBOX_CAPTEURS
+    [ETAPE_EXTRACTION_AIR]          = { FIN_EN_DESSOUS, MESURE_PRESSION, CONFIG_PASSBOX_CONSIGNE_EXTRACTION_AIR_PA },
+    [ETAPE_INJECTION_PRODUIT]       = { FIN_AU_DESSUS, MESURE_H2O2, CONFIG_PASSBOX_SEUIL_INJECTION_PPM },
+    [ETAPE_PAUSE_STERILISATION]     = { FIN_DOSE, MESURE_H2O2, CONFIG_PASSBOX_DOSE_PPM_MIN },
+    [ETAPE_EXTRACTION_PRODUIT]      = { FIN_EN_DESSOUS, MESURE_PRESSION, CONFIG_PASSBOX_CONSIGNE_EXTRACTION_PRODUIT_PA },
+    [ETAPE_RENOUVELLEMENT_AIR]      = { FIN_EN_DESSOUS, MESURE_H2O2, CONFIG_PASSBOX_SEUIL_RESIDUEL_PPM },
+#endif
+};
+
+// Consigne de pression tenue par la régulation de l'extracteur (PID) : la
+// vitesse de sorties_etape ne sert plus que de valeur de départ
+typedef struct {
+    bool active;
+    int32_t consigne_pa;
+} regulation_etape_t;
+
+static const regulation_etape_t regulation_etape[ETAPE_NB] = {
+#if CONFIG_PASSBOX_CAPTEURS
+    [ETAPE_EXTRACTION_AIR]          = { true, CONFIG_PASSBOX_CONSIGNE_EXTRACTION_AIR_PA },
+    [ETAPE_EXTRACTION_PRODUIT]      = { true, CONFIG_PASSBOX_CONSIGNE_EXTRACTION_PRODUIT_PA },
+    [ETAPE_RENOUVELLEMENT_AIR]      = { true, CONFIG_PASSBOX_CONSIGNE_RENOUVELLEMENT_PA },
+#endif
+};
+
+#define PERIODE_MESURE_MS       100
 
 // ======================= LOG =======================
 static const char *TAG = "Pass-Box";
 
-// ======================= WIFI EVENT =======================
-static EventGroupHandle_t wifi_event_group;
-#define WIFI_CONNECTED_BIT BIT0
-
 // ======================= MQTT =======================
 static esp_mqtt_client_handle_t mqtt_client = NULL;
+static volatile bool mqtt_connecte = false;
+static int64_t mqtt_debut_connexion_us = 0;    // début de la tentative en cours
+static uint32_t mqtt_premier_publish_ms = 0;   // tentative -> premier publish envoyé
+static int64_t mqtt_coupure_wifi_us = 0;       // dernière coupure Wi-Fi mesurée
+static uint32_t mqtt_coupure_wifi_ms = 0;      // coupure Wi-Fi -> premier publish envoyé
 
 // ======================= I2C =======================
 static i2c_master_bus_handle_t i2c_bus;
@@ -98,6 +287,12 @@ static volatile bool urgence_active = false;
 static volatile bool autorisation_porte_sterile = false;
 static volatile etape_cycle_t etape_actuelle = ETAPE_IDLE;
 
+// ======================= STATISTIQUES =======================
+static int64_t cycle_debut_us = 0;
+static volatile int64_t etape_debut_us = 0;    // lu aussi par le voyant (progression)
+static volatile bool stats_a_sauver = false;   // NVS écrit par cycle_task, hors chemin d'urgence
+static volatile int32_t progression_mesure = -1;  // ‰ d'une étape sur mesure, -1 : selon la durée
+
 // ======================= LCD (PLACEHOLDER) =======================
 static void lcd_show(const char *l1, const char *l2);
 static void lcd_init(void);
@@ -152,6 +347,18 @@ static void lcd_init_full(void)
 
 
 // ========= LOW LEVEL =========
+// pdMS_TO_TICKS arrondit à la baisse (pdMS_TO_TICKS(1) == 0 à 100 Hz) et un
+// vTaskDelay(1) peut rendre la main presque aussitôt : attente active pour
+// les délais courts du HD44780, vTaskDelay arrondi au-dessus sinon.
+static void lcd_delai_us(uint32_t us)
+{
+    if (us < 2 * 1000 * portTICK_PERIOD_MS) {
+        esp_rom_delay_us(us);
+    } else {
+        vTaskDelay(pdMS_TO_TICKS(us / 1000) + 1);
+    }
+}
+
 static void lcd_write_byte(uint8_t data)
 {
     i2c_master_transmit(lcd_dev, &data, 1, -1);
@@ -160,9 +367,9 @@ static void lcd_write_byte(uint8_t data)
 static void lcd_pulse(uint8_t data)
 {
     lcd_write_byte(data | LCD_ENABLE | LCD_BACKLIGHT);
-    vTaskDelay(pdMS_TO_TICKS(1));
+    lcd_delai_us(1);        // impulsion E >= 450 ns
     lcd_write_byte((data & ~LCD_ENABLE) | LCD_BACKLIGHT);
-    vTaskDelay(pdMS_TO_TICKS(1));
+    lcd_delai_us(50);       // exécution d'une commande : 37 us
 }
 static void lcd_send_nibble(uint8_t nibble, uint8_t rs)
 {
@@ -176,7 +383,7 @@ static void lcd_cmd(uint8_t cmd)
 {
     lcd_send_nibble(cmd >> 4, 0);
     lcd_send_nibble(cmd & 0x0F, 0);
-    vTaskDelay(pdMS_TO_TICKS(2));
+    lcd_delai_us(2000);
 }
 
 
@@ -202,12 +409,12 @@ static void lcd_write_char(char c)
 // ========= HIGH LEVEL =========
 static void lcd_init(void)
 {
-    vTaskDelay(pdMS_TO_TICKS(50));
+    lcd_delai_us(50000);
 
     lcd_write_nibble(0x03, 0);
-    vTaskDelay(pdMS_TO_TICKS(5));
+    lcd_delai_us(5000);
     lcd_write_nibble(0x03, 0);
-    vTaskDelay(pdMS_TO_TICKS(1));
+    lcd_delai_us(1000);
     lcd_write_nibble(0x03, 0);
     lcd_write_nibble(0x02, 0); // 4-bit mode
 
@@ -215,7 +422,7 @@ static void lcd_init(void)
     lcd_write_cmd(0x0C); // display ON
     lcd_write_cmd(0x06); // cursor move
     lcd_write_cmd(0x01); // clear
-    vTaskDelay(pdMS_TO_TICKS(2));
+    lcd_delai_us(2000);
 }
 
 
@@ -230,7 +437,7 @@ static void lcd_print(const char *str)
 static void lcd_show(const char *l1, const char *l2)
 {
     lcd_cmd(0x01);          // Clear LCD
-    vTaskDelay(pdMS_TO_TICKS(2));
+    lcd_delai_us(2000);
 
     lcd_print(l1);          // Ligne 1
 
@@ -249,21 +456,200 @@ static void gpio_init_buttons(void)
         .intr_type = GPIO_INTR_DISABLE,
         .pin_bit_mask =
             (1ULL << BTN_DEPART) |
-            (1ULL << BTN_ARRET) |
             (1ULL << BTN_STERILE_OUVERT) |
-            (1ULL << BTN_STERILE_FERME) |
-            (1ULL << BTN_CONTAMINEE_OUVERT) |
-            (1ULL << BTN_CONTAMINEE_FERME)
+            (1ULL << BTN_CONTAMINEE_OUVERT)
     };
     ESP_ERROR_CHECK(gpio_config(&io_conf));
 }
 
+// Interruption sur niveau, réarmée sur le niveau inverse à chaque
+// déclenchement : un appui puis un relâchement, sans scrutation, et un
+// niveau (pas un front) réveille le CPU du sommeil léger.
+typedef enum {
+    BOUTON_DEPART = 0,
+    BOUTON_STERILE,
+    BOUTON_CONTAMINEE,
+    BOUTON_NB
+} bouton_t;
+
+// Lus par l'ISR : en DRAM
+static gpio_num_t boutons[BOUTON_NB];
+static TaskHandle_t tache_boutons = NULL;
+
+static void IRAM_ATTR bouton_isr(void *arg)
+{
+    bouton_t b = (bouton_t)(intptr_t)arg;
+    bool appui = gpio_ll_get_level(&GPIO, boutons[b]) == 0;
+    gpio_ll_set_intr_type(&GPIO, boutons[b], appui ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+    if (!appui) return;
+
+    BaseType_t reveil = pdFALSE;
+    xTaskNotifyFromISR(tache_boutons, 1u << b, eSetBits, &reveil);
+    portYIELD_FROM_ISR(reveil);
+}
+
+// Service d'interruption installé par securite_init, tâche des boutons créée
+static void gpio_armer_boutons(void)
+{
+    boutons[BOUTON_DEPART] = BTN_DEPART;
+    boutons[BOUTON_STERILE] = BTN_STERILE_OUVERT;
+    boutons[BOUTON_CONTAMINEE] = BTN_CONTAMINEE_OUVERT;
+
+    for (int b = 0; b < BOUTON_NB; b++) {
+        // Bouton tenu au démarrage : attendre le relâchement
+        gpio_int_type_t attendu = gpio_get_level(boutons[b]) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+        ESP_ERROR_CHECK(gpio_isr_handler_add(boutons[b], bouton_isr, (void *)(intptr_t)b));
+        ESP_ERROR_CHECK(gpio_set_intr_type(boutons[b], attendu));
+#if CONFIG_PASSBOX_VEILLE
+        ESP_ERROR_CHECK(gpio_wakeup_enable(boutons[b], attendu));
+#endif
+        ESP_ERROR_CHECK(gpio_intr_enable(boutons[b]));
+    }
+}
+
 // ======================= HELPERS MQTT PUBLISH =======================
+static void topic_abonner(topic_t t, int qos)
+{
+    if (topics[t][0]) esp_mqtt_client_subscribe(mqtt_client, topics[t], qos);
+}
+
 static void mqtt_pub(const char *topic, const char *payload)
 {
     if (!mqtt_client) return;
     esp_mqtt_client_publish(mqtt_client, topic, payload, 0, 1, 0);
-    ESP_LOGI(TAG, "PUB [%s] %s", topic, payload);
+    evlog(EVL_MQTT_PUB, topic_court(topic), payload);
+}
+
+static void publier_stats(void)
+{
+    size_t taille = 2048;
+    while (taille <= 32768) {
+        char *buf = malloc(taille);
+        if (!buf) break;
+        if (stats_json(buf, taille) > 0) {
+            mqtt_pub(TOPIC_STATS, buf);
+            free(buf);
+            return;
+        }
+        free(buf);
+        taille *= 2;
+    }
+    ESP_LOGE(TAG, "Statistiques: buffer JSON insuffisant");
+}
+
+static void publier_diag_securite(void)
+{
+    securite_diag_t diag;
+    securite_diagnostic(&diag);
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"coupures\":%lu,\"derniere_ns\":%lu,\"pire_ns\":%lu,\"confirmee\":%s}",
+             (unsigned long)diag.nb, (unsigned long)diag.derniere_ns, (unsigned long)diag.pire_ns,
+             diag.confirmee ? "true" : "false");
+    mqtt_pub(TOPIC_DIAG_SECURITE, buf);
+}
+
+static void publier_diag_mqtt(void)
+{
+    mqtt_tls_diag_t diag;
+    mqtt_tls_diagnostic(&diag);
+    reseau_diag_t wifi;
+    reseau_diagnostic(&wifi);
+
+    char buf[352];
+    snprintf(buf, sizeof(buf),
+             "{\"connexions\":%lu,\"avec_ticket\":%lu,\"echecs_tls\":%lu,\"handshake_ms\":%lu,"
+             "\"ticket\":%s,\"premier_publish_ms\":%lu,\"coupure_wifi_ms\":%lu,"
+             "\"wifi\":{\"connexions\":%lu,\"derniere_ms\":%lu,\"pire_ms\":%lu,\"tentatives\":%lu,\"cache\":%s}}",
+             (unsigned long)diag.connexions, (unsigned long)diag.avec_ticket, (unsigned long)diag.echecs,
+             (unsigned long)diag.dernier_handshake_ms, diag.dernier_avec_ticket ? "true" : "false",
+             (unsigned long)mqtt_premier_publish_ms, (unsigned long)mqtt_coupure_wifi_ms,
+             (unsigned long)wifi.connexions, (unsigned long)wifi.derniere_ms, (unsigned long)wifi.pire_ms,
+             (unsigned long)wifi.tentatives, wifi.cache ? "true" : "false");
+    mqtt_pub(TOPIC_DIAG_MQTT, buf);
+}
+
+static void publier_mesures(void)
+{
+    mesures_t m;
+    if (!capteurs_lire(&m)) return;
+
+    regulation_etat_t reg;
+    regulation_lire(&reg);
+
+    char buf[224];
+    int n = snprintf(buf, sizeof(buf),
+                     "{\"pression_pa\":%ld,\"h2o2_ppm\":%ld,\"humidite\":%.1f,\"temperature\":%.1f,\"defauts\":%lu",
+                     (long)m.valeur[MESURE_PRESSION], (long)m.valeur[MESURE_H2O2],
+                     m.valeur[MESURE_HUMIDITE] / 10.0, m.valeur[MESURE_TEMPERATURE] / 10.0,
+                     (unsigned long)m.defauts);
+    if (reg.active) {
+        n += snprintf(buf + n, sizeof(buf) - n, ",\"extracteur\":{\"consigne_pa\":%ld,\"vitesse_pm\":%u}",
+                      (long)reg.consigne_pa, (unsigned)reg.sortie_pm);
+    }
+    snprintf(buf + n, sizeof(buf) - n, "}");
+    mqtt_pub(TOPIC_MESURES, buf);
+}
+
+static void publier_journal(const char *json)
+{
+    mqtt_pub(TOPIC_JOURNAL, json);
+}
+
+static void publier_ota(const char *json)
+{
+    mqtt_pub(TOPIC_OTA, json);
+}
+
+static bool ota_occupe(void)
+{
+    return cycle_en_cours;
+}
+
+// ======================= SORTIES =======================
+#define VERROUS     (SORTIE_BIT(SORTIE_VERROU_STERILE) | SORTIE_BIT(SORTIE_VERROU_CONTAMINEE))
+#define EXTRACTEUR  SORTIE_BIT(SORTIE_VENTILATEUR)
+
+// Sorties de chaque étape, portes verrouillées pendant tout le cycle
+static const actionneurs_etat_t sorties_etape[ETAPE_NB] = {
+    [ETAPE_EXTRACTION_AIR]          = { EXTRACTEUR | VERROUS, 100 },
+    [ETAPE_ARRET_AIR]               = { VERROUS, 0 },
+    [ETAPE_INJECTION_PRODUIT]       = { SORTIE_BIT(SORTIE_VANNE_INJECTION) | VERROUS, 0 },
+    [ETAPE_PAUSE_STERILISATION]     = { VERROUS, 0 },
+    [ETAPE_EXTRACTION_PRODUIT]      = { EXTRACTEUR | VERROUS, 100 },
+    [ETAPE_RENOUVELLEMENT_AIR]      = { EXTRACTEUR | VERROUS, 60 },
+    [ETAPE_AUTORISATION_STERILE]    = { SORTIE_BIT(SORTIE_VERROU_CONTAMINEE), 0 },
+};
+
+// Urgence : vanne fermée, extracteur coupé, enceinte confinée
+static const actionneurs_etat_t sorties_urgence = { VERROUS, 0 };
+
+static SemaphoreHandle_t sorties_mutex = NULL;
+
+// Recalcule l'état complet des sorties depuis l'état système et l'applique
+// d'un bloc. Appelée après chaque transition (étape, portes, urgence).
+static void appliquer_sorties(void)
+{
+    xSemaphoreTake(sorties_mutex, portMAX_DELAY);
+
+    actionneurs_etat_t etat = { 0 };
+    if (urgence_active) {
+        etat = sorties_urgence;
+    } else if (cycle_en_cours) {
+        etat = sorties_etape[etape_actuelle];
+    }
+    // Inter-verrouillage matériel : une porte ouverte verrouille l'autre
+    if (porte_contaminee_ouverte) etat.sorties |= SORTIE_BIT(SORTIE_VERROU_STERILE);
+    if (porte_sterile_ouverte) etat.sorties |= SORTIE_BIT(SORTIE_VERROU_CONTAMINEE);
+    actionneurs_appliquer(&etat);
+    securite_controler();
+
+    // Sommeil léger seulement sans cycle ni sortie commandée : l'arrêt
+    // d'urgence n'a alors rien à couper en urgence. Capteurs arrêtés au repos.
+    energie_appliquer(cycle_en_cours, etat.sorties != 0 || etat.vitesse_ventilateur != 0);
+    capteurs_activer(!energie_au_repos());
+
+    xSemaphoreGive(sorties_mutex);
 }
 
 // ======================= ACTIONS =======================
@@ -271,14 +657,22 @@ static void activer_urgence(const char *source)
 {
     if (urgence_active) return;
     urgence_active = true;
+    securite_urgence(true);
+    regulation_arreter();
+    journal_ajouter(JOURNAL_URGENCE_ON, etape_actuelle, 0);
+    if (cycle_en_cours) stats_cycle_abandonne();
     cycle_en_cours = false;
     etape_actuelle = ETAPE_IDLE;
     autorisation_porte_sterile = false;
+    appliquer_sorties();
 
     lcd_show_mutex("ARRET URGENCE", source);
     mqtt_pub(TOPIC_URGENCE, "true");
     mqtt_pub(TOPIC_CYCLE_DEPART, "false");
     mqtt_pub(TOPIC_CYCLE_ETAPE, "URGENCE");
+
+    stats_urgence();
+    stats_a_sauver = true;
     
     ESP_LOGW(TAG, "URGENCE activée depuis: %s", source);
 }
@@ -287,23 +681,64 @@ static void desactiver_urgence(void)
 {
     if (!urgence_active) return;
     urgence_active = false;
+    securite_urgence(false);
+    journal_ajouter(JOURNAL_URGENCE_OFF, etape_actuelle, 0);
+    appliquer_sorties();
 
     lcd_show_mutex("Urgence OFF", "Etat normal");
     mqtt_pub(TOPIC_URGENCE, "false");
     ESP_LOGI(TAG, "Urgence désactivée");
 }
 
+static void sorties_en_defaut(uint32_t defauts)
+{
+    char buf[17];
+    snprintf(buf, sizeof(buf), "Sorties 0x%02x", (unsigned)defauts);
+    activer_urgence(buf);
+}
+
+// ======================= ENTREES DE SECURITE =======================
+// Appelés depuis la tâche de sécurité
+static void porte_changee(porte_t porte, bool ouverte)
+{
+    bool sterile = porte == PORTE_STERILE;
+    if (sterile) {
+        porte_sterile_ouverte = ouverte;
+        if (ouverte) autorisation_porte_sterile = false;
+    } else {
+        porte_contaminee_ouverte = ouverte;
+    }
+    journal_ajouter(sterile ? JOURNAL_PORTE_STERILE : JOURNAL_PORTE_CONTAMINEE, etape_actuelle, ouverte);
+    appliquer_sorties();
+    mqtt_pub(sterile ? TOPIC_PORTE_STERILE : TOPIC_PORTE_CONTAM, ouverte ? "true" : "false");
+    lcd_show_mutex(sterile ? "Porte sterile" : "Porte contam.", ouverte ? "OUVERTE" : "FERMEE");
+    evlog(EVL_PORTE, sterile ? "sterile" : "contaminee", ouverte ? "ouverte" : "fermee");
+}
+
+static void sorties_coupees(coupure_t cause)
+{
+    static const char *const sources[] = {
+        [COUPURE_ARRET]             = "BTN_ARRET",
+        [COUPURE_INTERVERROUILLAGE] = "Inter-verrouil.",
+        [COUPURE_PORTE_FORCEE]      = "Porte forcee",
+    };
+    activer_urgence(sources[cause]);
+    publier_diag_securite();
+}
+
 // ======================= INTER-VERROUILLAGE =======================
 static bool verifier_interverrouillage_ouverture_sterile(void)
 {
     if (urgence_active) {
         lcd_show_mutex("REFUS STERILE", "Urgence active");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_URGENCE);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: urgence active");
         return false;
     }
     
     if (porte_contaminee_ouverte) {
         lcd_show_mutex("REFUS STERILE", "Porte contam. ON");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_INTERVERROUILLAGE);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: inter-verrouillage");
         ESP_LOGW(TAG, "INTER-VERROUILLAGE: Porte contaminée ouverte!");
         return false;
@@ -311,6 +746,7 @@ static bool verifier_interverrouillage_ouverture_sterile(void)
     
     if (cycle_en_cours && !autorisation_porte_sterile) {
         lcd_show_mutex("REFUS STERILE", "Cycle en cours");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_CYCLE_EN_COURS);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: cycle non termine");
         return false;
     }
@@ -322,12 +758,14 @@ static bool verifier_interverrouillage_ouverture_contaminee(void)
 {
     if (urgence_active) {
         lcd_show_mutex("REFUS CONTAM.", "Urgence active");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_URGENCE);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: urgence active");
         return false;
     }
     
     if (porte_sterile_ouverte) {
         lcd_show_mutex("REFUS CONTAM.", "Porte sterile ON");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_INTERVERROUILLAGE);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: inter-verrouillage");
         ESP_LOGW(TAG, "INTER-VERROUILLAGE: Porte stérile ouverte!");
         return false;
@@ -335,6 +773,7 @@ static bool verifier_interverrouillage_ouverture_contaminee(void)
     
     if (cycle_en_cours) {
         lcd_show_mutex("REFUS CONTAM.", "Cycle en cours");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_CYCLE_EN_COURS);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: cycle en cours");
         return false;
     }
@@ -348,131 +787,267 @@ static bool portes_ok_pour_demarrer(void)
     return (!porte_sterile_ouverte && !porte_contaminee_ouverte);
 }
 
-static void demarrer_cycle(const char *source)
+static refus_t demarrer_cycle(const char *source)
 {
     if (urgence_active) {
         lcd_show_mutex("Refus: urgence", source);
-        return;
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_URGENCE);
+        return REFUS_URGENCE;
     }
     
     if (cycle_en_cours) {
         ESP_LOGW(TAG, "Cycle déjà en cours");
-        return;
+        return REFUS_CYCLE_EN_COURS;
     }
 
     if (!portes_ok_pour_demarrer()) {
         lcd_show_mutex("ERREUR PORTES", "Fermer les 2");
+        journal_ajouter(JOURNAL_REFUS, etape_actuelle, REFUS_PORTES_OUVERTES);
         mqtt_pub(TOPIC_CYCLE_ETAPE, "Erreur: portes ouvertes");
         ESP_LOGE(TAG, "Impossible démarrer: portes ouvertes");
-        return;
+        return REFUS_PORTES_OUVERTES;
     }
 
     // Démarrage effectif
+    cycle_debut_us = esp_timer_get_time();
     cycle_en_cours = true;
     etape_actuelle = ETAPE_EXTRACTION_AIR;
     autorisation_porte_sterile = false;
+    journal_ajouter(JOURNAL_CYCLE_DEPART, etape_actuelle, 0);
+    appliquer_sorties();
     
     lcd_show_mutex("Cycle DEMARRE", source);
     mqtt_pub(TOPIC_CYCLE_DEPART, "true");
     mqtt_pub(TOPIC_CYCLE_ETAPE, "0: Demarrage");
+    // Sorties déjà commandées : une mise à jour en cours est abandonnée
+    ota_annuler("cycle");
     
     ESP_LOGI(TAG, "=== CYCLE DEMARRE depuis %s ===", source);
+    return REFUS_AUCUN;
 }
 
-static void arreter_cycle(const char *source)
+static refus_t arreter_cycle(const char *source)
 {
-    if (!cycle_en_cours) return;
+    if (!cycle_en_cours) return REFUS_AUCUN_CYCLE;
 
+    journal_ajouter(JOURNAL_CYCLE_ARRETE, etape_actuelle, 0);
+    regulation_arreter();
     cycle_en_cours = false;
     etape_actuelle = ETAPE_IDLE;
     autorisation_porte_sterile = false;
+    appliquer_sorties();
 
     lcd_show_mutex("Cycle STOP", source);
     mqtt_pub(TOPIC_CYCLE_DEPART, "false");
     mqtt_pub(TOPIC_CYCLE_ETAPE, "Arrete");
+
+    stats_cycle_abandonne();
+    stats_a_sauver = true;
     
     ESP_LOGW(TAG, "Cycle arrêté depuis: %s", source);
+    return REFUS_AUCUN;
 }
 
 // ======================= CYCLE DE DECONTAMINATION =======================
+#if CONFIG_PASSBOX_CAPTEURS
+// Condition évaluée toutes les 100 ms sur la dernière mesure filtrée. Mesure
+// absente ou capteur en défaut : rien n'est cumulé, le délai court toujours.
+static void attendre_condition(etape_cycle_t etape, const fin_etape_t *fin)
+{
+    const int64_t dose_visee = (int64_t)fin->seuil * 60000;     // unité x ms
+    const uint32_t delai_max_ms = parametres->duree_etape_ms[etape] * CONFIG_PASSBOX_DELAI_MAX_FACTEUR;
+    int64_t dose = 0;
+    int64_t precedent_us = esp_timer_get_time();
+    uint32_t secondes = 0;
+
+    progression_mesure = fin->type == FIN_EN_DESSOUS ? -1 : 0;
+    while (cycle_en_cours && !urgence_active) {
+        vTaskDelay(pdMS_TO_TICKS(PERIODE_MESURE_MS));
+        int64_t maintenant_us = esp_timer_get_time();
+        uint32_t ecoule_ms = (maintenant_us - etape_debut_us) / 1000;
+
+        mesures_t m;
+        bool atteinte = false;
+        if (capteurs_lire(&m) && !(m.defauts & MESURE_BIT(fin->mesure))) {
+            int32_t v = m.valeur[fin->mesure];
+            switch (fin->type) {
+                case FIN_AU_DESSUS:
+                    atteinte = v >= fin->seuil;
+                    progression_mesure = atteinte ? 1000 : v <= 0 ? 0 : v * 1000 / fin->seuil;
+                    break;
+                case FIN_EN_DESSOUS:
+                    atteinte = v <= fin->seuil;
+                    break;
+                case FIN_DOSE:
+                    if (v > 0) dose += (int64_t)v * (maintenant_us - precedent_us) / 1000;
+                    atteinte = dose >= dose_visee;
+                    progression_mesure = atteinte ? 1000 : dose * 1000 / dose_visee;
+                    break;
+                default:
+                    break;
+            }
+        }
+        precedent_us = maintenant_us;
+
+        if (atteinte) {
+            if (fin->type == FIN_DOSE) stats_maintien_dose(true, delai_max_ms);
+            break;
+        }
+        if (ecoule_ms >= delai_max_ms) {
+            if (fin->type == FIN_DOSE) stats_maintien_dose(false, delai_max_ms);
+            // Dose non délivrée ou enceinte encore chargée : verrous maintenus
+            char buf[17];
+            snprintf(buf, sizeof(buf), "Delai etape %d", (int)etape);
+            activer_urgence(buf);
+            break;
+        }
+
+        if (ecoule_ms / 1000 != secondes) {
+            secondes = ecoule_ms / 1000;
+            if (fin->type == FIN_DOSE) {
+                char buf[17];
+                snprintf(buf, sizeof(buf), "Dose: %ld%%", (long)(progression_mesure / 10));
+                lcd_show_mutex("Etape 4/7", buf);
+            }
+            publier_mesures();
+        }
+    }
+    progression_mesure = -1;
+}
+#endif
+
+// Durée fixe, ou condition mesurée bornée à CONFIG_PASSBOX_DELAI_MAX_FACTEUR
+// fois la durée nominale (urgence au-delà)
+static void attendre_fin_etape(etape_cycle_t etape)
+{
+#if CONFIG_PASSBOX_CAPTEURS
+    if (fin_etape[etape].type != FIN_DUREE) {
+        attendre_condition(etape, &fin_etape[etape]);
+        return;
+    }
+#endif
+    vTaskDelay(pdMS_TO_TICKS(parametres->duree_etape_ms[etape]));
+}
+
+// Texte publié sur cycle/etape au début de chaque étape, et à la connexion
+static const char *const etape_textes[ETAPE_NB] = {
+    [ETAPE_IDLE]                    = "Systeme pret",
+    [ETAPE_EXTRACTION_AIR]          = "1: Extraction air",
+    [ETAPE_ARRET_AIR]               = "2: Arret air",
+    [ETAPE_INJECTION_PRODUIT]       = "3: Injection produit",
+    [ETAPE_PAUSE_STERILISATION]     = "4: Pause sterilisation",
+    [ETAPE_EXTRACTION_PRODUIT]      = "5: Extraction produit",
+    [ETAPE_RENOUVELLEMENT_AIR]      = "6: Renouvellement air",
+    [ETAPE_AUTORISATION_STERILE]    = "7: Autorisation porte sterile",
+    [ETAPE_TERMINE]                 = "8: Termine",
+};
+
+// La pause à durée fixe annonce sa durée (paramètre duree_pause)
+static const char *etape_texte(etape_cycle_t etape, char *buf, size_t len)
+{
+    if (etape != ETAPE_PAUSE_STERILISATION || fin_etape[etape].type != FIN_DUREE) return etape_textes[etape];
+    int32_t duree = parametres->duree_etape_ms[etape];
+    if (duree % 1000) snprintf(buf, len, "%s %ldms", etape_textes[etape], (long)duree);
+    else snprintf(buf, len, "%s %lds", etape_textes[etape], (long)(duree / 1000));
+    return buf;
+}
+
 static void cycle_task(void *arg)
 {
     while (1) {
         if (!cycle_en_cours || urgence_active) {
+            if (stats_a_sauver) {
+                stats_a_sauver = false;
+                stats_sauvegarder();
+            }
             vTaskDelay(pdMS_TO_TICKS(500));
             continue;
         }
 
-        switch (etape_actuelle) {
+        etape_cycle_t etape = etape_actuelle;
+        etape_debut_us = esp_timer_get_time();
+        journal_ajouter(JOURNAL_ETAPE, etape, 0);
+        appliquer_sorties();
+        if (regulation_etape[etape].active) regulation_demarrer(regulation_etape[etape].consigne_pa);
+
+        switch (etape) {
             
             case ETAPE_EXTRACTION_AIR:
-                ESP_LOGI(TAG, "--- Etape 1: Extraction air ---");
+                evlog(EVL_ETAPE, 1, "Extraction air");
                 lcd_show_mutex("Etape 1/7", "Extraction air");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "1: Extraction air");
-                vTaskDelay(pdMS_TO_TICKS(3000));
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_EXTRACTION_AIR]);
+                attendre_fin_etape(ETAPE_EXTRACTION_AIR);
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_ARRET_AIR;
                 break;
 
             case ETAPE_ARRET_AIR:
-                ESP_LOGI(TAG, "--- Etape 2: Arret air ---");
+                evlog(EVL_ETAPE, 2, "Arret air");
                 lcd_show_mutex("Etape 2/7", "Arret air");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "2: Arret air");
-                vTaskDelay(pdMS_TO_TICKS(2000));
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_ARRET_AIR]);
+                attendre_fin_etape(ETAPE_ARRET_AIR);
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_INJECTION_PRODUIT;
                 break;
 
             case ETAPE_INJECTION_PRODUIT:
-                ESP_LOGI(TAG, "--- Etape 3: Injection produit ---");
+                evlog(EVL_ETAPE, 3, "Injection produit");
                 lcd_show_mutex("Etape 3/7", "Injection produit");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "3: Injection produit");
-                vTaskDelay(pdMS_TO_TICKS(2000));
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_INJECTION_PRODUIT]);
+                attendre_fin_etape(ETAPE_INJECTION_PRODUIT);
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_PAUSE_STERILISATION;
                 break;
 
             case ETAPE_PAUSE_STERILISATION:
-                ESP_LOGI(TAG, "--- Etape 4: Pause sterilisation (20s) ---");
+                evlog(EVL_ETAPE, 4, "Pause sterilisation");
                 lcd_show_mutex("Etape 4/7", "Sterilisation");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "4: Pause sterilisation 20s");
+                char texte[48];
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_texte(ETAPE_PAUSE_STERILISATION, texte, sizeof(texte)));
                 
-                for (int i = 20; i > 0 && cycle_en_cours && !urgence_active; i--) {
-                    char buf[32];
-                    snprintf(buf, sizeof(buf), "Steril: %ds", i);
-                    lcd_show_mutex("Etape 4/7", buf);
-                    vTaskDelay(pdMS_TO_TICKS(1000));
+                if (fin_etape[ETAPE_PAUSE_STERILISATION].type != FIN_DUREE) {
+                    attendre_fin_etape(ETAPE_PAUSE_STERILISATION);
+                } else {
+                    // Fraction de seconde d'abord : le décompte finit à la durée exacte
+                    int32_t duree = parametres->duree_etape_ms[ETAPE_PAUSE_STERILISATION];
+                    vTaskDelay(pdMS_TO_TICKS(duree % 1000));
+                    for (int i = duree / 1000; i > 0 && cycle_en_cours && !urgence_active; i--) {
+                        char buf[32];
+                        snprintf(buf, sizeof(buf), "Steril: %ds", i);
+                        lcd_show_mutex("Etape 4/7", buf);
+                        vTaskDelay(pdMS_TO_TICKS(1000));
+                    }
                 }
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_EXTRACTION_PRODUIT;
                 break;
 
             case ETAPE_EXTRACTION_PRODUIT:
-                ESP_LOGI(TAG, "--- Etape 5: Extraction produit ---");
+                evlog(EVL_ETAPE, 5, "Extraction produit");
                 lcd_show_mutex("Etape 5/7", "Extract. produit");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "5: Extraction produit");
-                vTaskDelay(pdMS_TO_TICKS(3000));
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_EXTRACTION_PRODUIT]);
+                attendre_fin_etape(ETAPE_EXTRACTION_PRODUIT);
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_RENOUVELLEMENT_AIR;
                 break;
 
             case ETAPE_RENOUVELLEMENT_AIR:
-                ESP_LOGI(TAG, "--- Etape 6: Renouvellement air ---");
+                evlog(EVL_ETAPE, 6, "Renouvellement air");
                 lcd_show_mutex("Etape 6/7", "Renouvel. air");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "6: Renouvellement air");
-                vTaskDelay(pdMS_TO_TICKS(3000));
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_RENOUVELLEMENT_AIR]);
+                attendre_fin_etape(ETAPE_RENOUVELLEMENT_AIR);
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_AUTORISATION_STERILE;
                 break;
 
             case ETAPE_AUTORISATION_STERILE:
-                ESP_LOGI(TAG, "--- Etape 7: Autorisation porte sterile ---");
+                evlog(EVL_ETAPE, 7, "Autorisation porte sterile");
                 lcd_show_mutex("Etape 7/7", "Autorisation OK");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "7: Autorisation porte sterile");
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_AUTORISATION_STERILE]);
                 
                 autorisation_porte_sterile = true;
                 
-                vTaskDelay(pdMS_TO_TICKS(2000));
+                attendre_fin_etape(ETAPE_AUTORISATION_STERILE);
                 
                 if (cycle_en_cours) etape_actuelle = ETAPE_TERMINE;
                 break;
@@ -480,11 +1055,16 @@ static void cycle_task(void *arg)
             case ETAPE_TERMINE:
                 ESP_LOGI(TAG, "=== CYCLE TERMINE ===");
                 lcd_show_mutex("CYCLE TERMINE", "Ouvrir sterile");
-                mqtt_pub(TOPIC_CYCLE_ETAPE, "8: Termine");
+                mqtt_pub(TOPIC_CYCLE_ETAPE, etape_textes[ETAPE_TERMINE]);
                 mqtt_pub(TOPIC_CYCLE_DEPART, "false");
                 
                 cycle_en_cours = false;
                 etape_actuelle = ETAPE_IDLE;
+                journal_ajouter(JOURNAL_CYCLE_TERMINE, ETAPE_TERMINE, 0);
+                appliquer_sorties();
+
+                stats_cycle_termine((esp_timer_get_time() - cycle_debut_us) / 1000);
+                stats_sauvegarder();
                 
                 vTaskDelay(pdMS_TO_TICKS(2000));
                 lcd_show_mutex("Pret", "Attente...");
@@ -494,7 +1074,139 @@ static void cycle_task(void *arg)
                 etape_actuelle = ETAPE_IDLE;
                 break;
         }
+        regulation_arreter();
+
+        // Étape menée à son terme (pas d'arrêt ni d'urgence entre-temps)
+        if (cycle_en_cours && etape_actuelle != etape) {
+            uint32_t duree_ms = (esp_timer_get_time() - etape_debut_us) / 1000;
+            // Fin sur mesure : pas de consigne de durée, la conformité du
+            // maintien est jugée sur la dose (attendre_condition)
+            uint32_t consigne_ms = fin_etape[etape].type == FIN_DUREE ? parametres->duree_etape_ms[etape] : 0;
+            stats_etape_terminee(etape, duree_ms, consigne_ms);
+        }
+    }
+}
+
+// ======================= VOYANT =======================
+static void voyant_lire_etat(voyant_etat_t *e)
+{
+    etape_cycle_t etape = etape_actuelle;
+
+    e->urgence = urgence_active;
+    e->cycle_en_cours = cycle_en_cours;
+    e->porte_sterile_ouverte = porte_sterile_ouverte;
+    e->porte_contaminee_ouverte = porte_contaminee_ouverte;
+    e->autorisation_sterile = autorisation_porte_sterile;
+    e->etape = etape;
+    e->progression = 0;
+
+    int32_t mesuree = progression_mesure;
+    if (cycle_en_cours && mesuree >= 0) {
+        e->progression = mesuree;
+    } else if (cycle_en_cours && etape < ETAPE_NB && parametres->duree_etape_ms[etape]) {
+        uint32_t ecoule_ms = (esp_timer_get_time() - etape_debut_us) / 1000;
+        e->progression = ecoule_ms >= parametres->duree_etape_ms[etape] ? 1000 : ecoule_ms * 1000 / parametres->duree_etape_ms[etape];
+    }
+}
+
+// ======================= API HTTP LOCALE =======================
+// Même instantané que le voyant, plus les compteurs de sécurité et les
+// mesures : tâche du serveur HTTP, lecture seule
+static size_t api_etat_json(char *buf, size_t taille)
+{
+    voyant_etat_t e;
+    voyant_lire_etat(&e);
+    securite_diag_t diag;
+    securite_diagnostic(&diag);
+
+    int n = snprintf(buf, taille,
+                     "{\"uptime_s\":%lu,\"cycle\":{\"en_cours\":%s,\"etape\":%d,\"progression\":%u},"
+                     "\"urgence\":%s,\"portes\":{\"sterile\":%s,\"contaminee\":%s,\"autorisation_sterile\":%s},"
+                     "\"mqtt\":%s,\"securite\":{\"coupures\":%lu,\"pire_ns\":%lu}",
+                     (unsigned long)(esp_timer_get_time() / 1000000), e.cycle_en_cours ? "true" : "false",
+                     (int)e.etape, (unsigned)e.progression, e.urgence ? "true" : "false",
+                     e.porte_sterile_ouverte ? "true" : "false", e.porte_contaminee_ouverte ? "true" : "false",
+                     e.autorisation_sterile ? "true" : "false", mqtt_connecte ? "true" : "false",
+                     (unsigned long)diag.nb, (unsigned long)diag.pire_ns);
+    if (n < 0 || (size_t)n >= taille) return 0;
+
+    mesures_t m;
+    if (capteurs_lire(&m)) {
+        n += snprintf(buf + n, taille - n,
+                      ",\"mesures\":{\"pression_pa\":%ld,\"h2o2_ppm\":%ld,\"humidite\":%.1f,\"temperature\":%.1f}",
+                      (long)m.valeur[MESURE_PRESSION], (long)m.valeur[MESURE_H2O2],
+                      m.valeur[MESURE_HUMIDITE] / 10.0, m.valeur[MESURE_TEMPERATURE] / 10.0);
+        if ((size_t)n >= taille) return 0;
     }
+    n += snprintf(buf + n, taille - n, "}");
+    return (size_t)n < taille ? (size_t)n : 0;
+}
+
+static refus_t api_cycle(bool depart)
+{
+    return depart ? demarrer_cycle("HTTP") : arreter_cycle("HTTP");
+}
+
+// Toujours acceptée, comme cmd/urgence
+static refus_t api_urgence(bool active)
+{
+    if (active) {
+        activer_urgence("HTTP");
+    } else {
+        desactiver_urgence();
+    }
+    return REFUS_AUCUN;
+}
+
+// ======================= ACQUITTEMENT DES COMMANDES =======================
+// Chaque commande de cycle ou d'urgence reçoit une réponse sur reponse :
+// ack, ou nack avec le motif du refus, l'identifiant de corrélation de la
+// requête et le temps entre la réception et la décision
+#define ID_CORRELATION_MAX      37      // 36 caractères, '\0' compris
+
+// Accepter "ON", "true", "1"
+static bool valeur_vraie(const char *v)
+{
+    return strcmp(v, "ON") == 0 || strcmp(v, "true") == 0 || strcmp(v, "1") == 0;
+}
+
+// Accepter "OFF", "false", "0"
+static bool valeur_fausse(const char *v)
+{
+    return strcmp(v, "OFF") == 0 || strcmp(v, "false") == 0 || strcmp(v, "0") == 0;
+}
+
+// "valeur" ou "valeur\nid=<id>" : data réduit à la valeur, id copié
+// (lettres, chiffres, ". _ : -", tronqué), vide sans identifiant
+static void commande_separer(char *data, char *id)
+{
+    id[0] = '\0';
+    char *ligne = strchr(data, '\n');
+    if (!ligne) return;
+    *ligne = '\0';
+    if (ligne > data && ligne[-1] == '\r') ligne[-1] = '\0';
+    if (strncmp(ligne + 1, "id=", 3) != 0) return;
+
+    size_t n = 0;
+    for (const char *c = ligne + 4; *c && n < ID_CORRELATION_MAX - 1; c++) {
+        if (!isalnum((unsigned char)*c) && !strchr("._:-", *c)) break;
+        id[n++] = *c;
+    }
+    id[n] = '\0';
+}
+
+static void acquitter(const char *topic, const char *id, refus_t refus, int64_t recu_us)
+{
+    unsigned long latence_us = (unsigned long)(esp_timer_get_time() - recu_us);
+    char buf[256];
+    int n = id[0] ? snprintf(buf, sizeof(buf), "{\"id\":\"%s\"", id) : snprintf(buf, sizeof(buf), "{\"id\":null");
+    n += snprintf(buf + n, sizeof(buf) - n, ",\"commande\":\"%s\",\"resultat\":\"%s\"", topic_court(topic),
+                  refus == REFUS_AUCUN ? "ack" : "nack");
+    if (refus != REFUS_AUCUN) {
+        n += snprintf(buf + n, sizeof(buf) - n, ",\"code\":%d,\"raison\":\"%s\"", (int)refus, refus_nom(refus));
+    }
+    snprintf(buf + n, sizeof(buf) - n, ",\"latence_us\":%lu}", latence_us);
+    mqtt_pub(TOPIC_REPONSE, buf);
 }
 
 // ======================= MQTT EVENT HANDLER =======================
@@ -505,26 +1217,74 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
 
     switch (event_id) {
 
+    case MQTT_EVENT_BEFORE_CONNECT:
+        mqtt_debut_connexion_us = esp_timer_get_time();
+        break;
+
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "MQTT connecté à HiveMQ");
+        mqtt_connecte = true;
         lcd_show_mutex("MQTT OK", "Subscribe...");
 
-        esp_mqtt_client_subscribe(mqtt_client, TOPIC_CMD_CYCLE_DEPART, 0);
-        esp_mqtt_client_subscribe(mqtt_client, TOPIC_CMD_URGENCE, 0);
+        topic_abonner(T_CMD_CYCLE_DEPART, 0);
+        topic_abonner(T_CMD_URGENCE, 0);
+        topic_abonner(T_CMD_STATS, 0);
+        topic_abonner(T_CMD_JOURNAL, 0);
+        topic_abonner(T_CMD_CONFIG, 1);
+#if CONFIG_PASSBOX_OTA
+        topic_abonner(T_CMD_OTA, 1);
+        topic_abonner(T_CMD_OTA_BLOC, 1);
+#endif
+        topic_abonner(T_SALLE_CMD_URGENCE, 0);
+        topic_abonner(T_SALLE_CMD_STATS, 0);
+        topic_abonner(T_SITE_CMD_URGENCE, 0);
+        topic_abonner(T_SITE_CMD_STATS, 0);
+#if CONFIG_PASSBOX_BENCH
+        topic_abonner(T_BENCH_INONDATION, 0);       // renvoyé par le broker : charge en réception
+#endif
         
-        // Publier l'état initial
-        mqtt_pub(TOPIC_PORTE_STERILE, "false");
-        mqtt_pub(TOPIC_PORTE_CONTAM, "false");
-        mqtt_pub(TOPIC_URGENCE, "false");
-        mqtt_pub(TOPIC_CYCLE_DEPART, "false");
-        mqtt_pub(TOPIC_CYCLE_ETAPE, "Systeme pret");
+        // Publier l'état courant (reconnexion en plein cycle comprise). Le
+        // premier publish part dans cette tâche : au retour, il est écrit sur
+        // la connexion.
+        mqtt_pub(TOPIC_PORTE_STERILE, porte_sterile_ouverte ? "true" : "false");
+        mqtt_premier_publish_ms = (uint32_t)((esp_timer_get_time() - mqtt_debut_connexion_us) / 1000);
+        ESP_LOGI(TAG, "Reconnexion -> premier publish: %lu ms", (unsigned long)mqtt_premier_publish_ms);
+        reseau_diag_t wifi;
+        reseau_diagnostic(&wifi);
+        if (wifi.coupure_us && wifi.coupure_us != mqtt_coupure_wifi_us) {
+            mqtt_coupure_wifi_us = wifi.coupure_us;
+            mqtt_coupure_wifi_ms = (uint32_t)((esp_timer_get_time() - wifi.coupure_us) / 1000);
+            ESP_LOGI(TAG, "Coupure WiFi -> premier publish: %lu ms", (unsigned long)mqtt_coupure_wifi_ms);
+        }
+        mqtt_pub(TOPIC_PORTE_CONTAM, porte_contaminee_ouverte ? "true" : "false");
+        mqtt_pub(TOPIC_URGENCE, urgence_active ? "true" : "false");
+        mqtt_pub(TOPIC_CYCLE_DEPART, cycle_en_cours ? "true" : "false");
+        char texte[48];
+        mqtt_pub(TOPIC_CYCLE_ETAPE, urgence_active ? "URGENCE" : etape_texte(etape_actuelle, texte, sizeof(texte)));
+        publier_diag_mqtt();
+        ota_connecte();
         break;
 
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG, "MQTT déconnecté");
+        mqtt_connecte = false;
         break;
 
     case MQTT_EVENT_DATA: {
+        int64_t recu_us = esp_timer_get_time();
+
+        // Blocs OTA : livrés par fragments (topic sur le premier seulement),
+        // écrits en flash sans copie ni journal
+        static bool bloc_ota = false;       // tâche esp-mqtt uniquement
+        if (event->topic_len) {
+            bloc_ota = event->topic_len == strlen(TOPIC_CMD_OTA_BLOC) &&
+                       memcmp(event->topic, TOPIC_CMD_OTA_BLOC, event->topic_len) == 0;
+        }
+        if (bloc_ota) {
+            ota_bloc(event->data, event->data_len, event->current_data_offset, event->total_data_len);
+            break;
+        }
+
         char topic[event->topic_len + 1];
         char data[event->data_len + 1];
 
@@ -534,31 +1294,94 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
         memcpy(data, event->data, event->data_len);
         data[event->data_len] = 0;
 
-        ESP_LOGI(TAG, "RX [%s] %s", topic, data);
+        evlog(EVL_MQTT_RX, topic_court(topic), data);
 
-        // Commande cycle depuis Node-RED
+        // Commande cycle depuis Node-RED, identifiant de corrélation
+        // facultatif en seconde ligne ("ON\nid=42")
         if (strcmp(topic, TOPIC_CMD_CYCLE_DEPART) == 0) {
-            // Accepter "ON", "true", "1"
-            if (strcmp(data, "ON") == 0 || strcmp(data, "true") == 0 || strcmp(data, "1") == 0) {
-                demarrer_cycle("MQTT");
-            } 
-            // Accepter "OFF", "false", "0"
-            else if (strcmp(data, "OFF") == 0 || strcmp(data, "false") == 0 || strcmp(data, "0") == 0) {
-                arreter_cycle("MQTT");
+            char id[ID_CORRELATION_MAX];
+            commande_separer(data, id);
+            refus_t refus = REFUS_COMMANDE_INVALIDE;
+            if (valeur_vraie(data)) {
+                refus = demarrer_cycle("MQTT");
+            } else if (valeur_fausse(data)) {
+                refus = arreter_cycle("MQTT");
             }
+            acquitter(topic, id, refus, recu_us);
         }
 
-        // Commande urgence depuis Node-RED
-        if (strcmp(topic, TOPIC_CMD_URGENCE) == 0) {
-            // Accepter "ON", "true", "1"
-            if (strcmp(data, "ON") == 0 || strcmp(data, "true") == 0 || strcmp(data, "1") == 0) {
-                activer_urgence("MQTT");
-            } 
-            // Accepter "OFF", "false", "0"
-            else if (strcmp(data, "OFF") == 0 || strcmp(data, "false") == 0 || strcmp(data, "0") == 0) {
+        // Commande urgence depuis Node-RED, pour ce poste ou son groupe.
+        // Toujours acceptée : l'état demandé est atteint, même s'il l'était déjà.
+        bool groupe = strcmp(topic, topics[T_SALLE_CMD_URGENCE]) == 0 ||
+                      strcmp(topic, topics[T_SITE_CMD_URGENCE]) == 0;
+        if (groupe || strcmp(topic, TOPIC_CMD_URGENCE) == 0) {
+            char id[ID_CORRELATION_MAX];
+            commande_separer(data, id);
+            refus_t refus = REFUS_AUCUN;
+            if (valeur_vraie(data)) {
+                activer_urgence(groupe ? "MQTT groupe" : "MQTT");
+            } else if (valeur_fausse(data)) {
                 desactiver_urgence();
+            } else {
+                refus = REFUS_COMMANDE_INVALIDE;
+            }
+            acquitter(topic, id, refus, recu_us);
+        }
+
+        // Statistiques à la demande (rapport Node-RED)
+        if (strcmp(topic, TOPIC_CMD_STATS) == 0 || strcmp(topic, topics[T_SALLE_CMD_STATS]) == 0 ||
+            strcmp(topic, topics[T_SITE_CMD_STATS]) == 0) {
+            // Remise à zéro : poste par poste uniquement
+            if (strcmp(data, "reset") == 0 && strcmp(topic, TOPIC_CMD_STATS) == 0) {
+                stats_reinitialiser();
+            }
+            publier_stats();
+            publier_diag_securite();
+            publier_diag_mqtt();
+            publier_mesures();
+        }
+
+        // Relecture du journal : "debut-fin" ou "debut" (jusqu'au dernier)
+        if (strcmp(topic, TOPIC_CMD_JOURNAL) == 0) {
+            unsigned long debut = 0, fin = UINT32_MAX;
+            if (sscanf(data, "%lu-%lu", &debut, &fin) >= 1) {
+                journal_lire(debut, fin, publier_journal);
             }
         }
+
+        // Configuration : "cle=valeur" par ligne, "?" (ou vide) relit,
+        // "defaut" efface les surcharges, "redemarrer" applique hors cycle
+        if (strcmp(topic, TOPIC_CMD_CONFIG) == 0) {
+            static char reponse[1024];     // tâche esp-mqtt uniquement
+            if (strcmp(data, "redemarrer") == 0) {
+                if (cycle_en_cours) {
+                    mqtt_pub(TOPIC_CONFIG, "{\"erreur\":\"cycle en cours\"}");
+                } else {
+                    ESP_LOGW(TAG, "Redémarrage demandé par MQTT");
+                    mqtt_pub(TOPIC_CONFIG, "{\"redemarrage\":true}");
+                    vTaskDelay(pdMS_TO_TICKS(200));
+                    esp_restart();
+                }
+            } else if (strcmp(data, "defaut") == 0) {
+                if (parametres_reinitialiser() == ESP_OK && parametres_json(reponse, sizeof(reponse))) {
+                    mqtt_pub(TOPIC_CONFIG, reponse);
+                } else {
+                    mqtt_pub(TOPIC_CONFIG, "{\"erreur\":\"nvs\"}");
+                }
+            } else if (data[0] == 0 || strcmp(data, "?") == 0) {
+                if (parametres_json(reponse, sizeof(reponse))) mqtt_pub(TOPIC_CONFIG, reponse);
+            } else {
+                parametres_modifier(data, cycle_en_cours, reponse, sizeof(reponse));
+                mqtt_pub(TOPIC_CONFIG, reponse);
+            }
+        }
+
+        // Mise à jour : début, fin (redémarrage hors cycle), annulation
+        if (strcmp(topic, TOPIC_CMD_OTA) == 0 && ota_commande(data)) {
+            ESP_LOGW(TAG, "Redémarrage sur la nouvelle image");
+            vTaskDelay(pdMS_TO_TICKS(200));
+            esp_restart();
+        }
         break;
     }
 
@@ -575,11 +1398,13 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
 static void mqtt_init(void)
 {
     esp_mqtt_client_config_t cfg = {
-        .broker.address.uri = MQTT_URI,
+        .broker.address.uri = parametres->mqtt_uri,
         .session.keepalive = 120,
         .network.reconnect_timeout_ms = 10000,
         .network.timeout_ms = 30000,
         .session.disable_clean_session = false,
+        // NULL sans TLS : transport choisi par esp-mqtt d'après l'URI
+        .network.transport = strncmp(parametres->mqtt_uri, "mqtts://", 8) == 0 ? mqtt_tls_creer() : NULL,
     };
     
   
@@ -592,55 +1417,31 @@ static void mqtt_init(void)
     esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
     esp_mqtt_client_start(mqtt_client);
     
-    ESP_LOGI(TAG, "MQTT client started, connecting to %s", MQTT_URI);
+    ESP_LOGI(TAG, "MQTT client started, connecting to %s", parametres->mqtt_uri);
 }
 
-// ======================= WIFI HANDLER =======================
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data)
+// ======================= WIFI =======================
+// IP de nouveau disponible : esp-mqtt attendrait la fin de son délai de
+// reconnexion (10 s), on le relance tout de suite
+static void wifi_ip_obtenue(void)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    }
-    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        ESP_LOGW(TAG, "WiFi déconnecté, reconnexion...");
-        esp_wifi_connect();
-    }
-    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "IP obtenue: " IPSTR, IP2STR(&event->ip_info.ip));
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
-    }
+    if (mqtt_client) esp_mqtt_client_reconnect(mqtt_client);
 }
 
-// ======================= WIFI INIT =======================
 static void wifi_init(void)
 {
-    wifi_event_group = xEventGroupCreate();
-
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
-
-    wifi_init_config_t wifi_cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&wifi_cfg));
-
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, 
-                                               &wifi_event_handler, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, 
-                                               &wifi_event_handler, NULL));
 
-    wifi_config_t sta_cfg = {0};
-    strncpy((char *)sta_cfg.sta.ssid, WIFI_SSID, sizeof(sta_cfg.sta.ssid));
-    strncpy((char *)sta_cfg.sta.password, WIFI_PASS, sizeof(sta_cfg.sta.password));
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_cfg));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    reseau_config_t cfg = {
+        .ssid = parametres->wifi_ssid,
+        .mot_de_passe = parametres->wifi_mdp,
+        .ip_obtenue = wifi_ip_obtenue,
+    };
+    ESP_ERROR_CHECK(reseau_init(&cfg));
 
     lcd_show_mutex("WiFi...", "Connexion");
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT, 
-                       pdFALSE, pdTRUE, portMAX_DELAY);
+    reseau_attendre(portMAX_DELAY);
     lcd_show_mutex("WiFi OK", "IP obtenue");
 }
 
@@ -648,18 +1449,11 @@ static void wifi_init(void)
 static void button_task(void *arg)
 {
     while (1) {
-        // ========== URGENCE (TOGGLE) ==========
-        if (gpio_get_level(BTN_ARRET) == 0) {
-            if (!urgence_active) {
-                activer_urgence("BTN_ARRET");
-            } else {
-                desactiver_urgence();
-            }
-            vTaskDelay(pdMS_TO_TICKS(400));
-        }
+        uint32_t appuis = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &appuis, portMAX_DELAY);
 
         // ========== DEPART/ARRET CYCLE (TOGGLE) ==========
-        if (gpio_get_level(BTN_DEPART) == 0) {
+        if (appuis & (1u << BOUTON_DEPART)) {
             if (!cycle_en_cours) {
                 demarrer_cycle("BTN_DEPART");
             } else {
@@ -668,51 +1462,24 @@ static void button_task(void *arg)
             vTaskDelay(pdMS_TO_TICKS(400));
         }
 
-        // ========== PORTE STERILE OUVRIR ==========
-        if (gpio_get_level(BTN_STERILE_OUVERT) == 0) {
+        // ========== DEMANDE D'OUVERTURE PORTE STERILE ==========
+        if (appuis & (1u << BOUTON_STERILE)) {
             if (verifier_interverrouillage_ouverture_sterile()) {
-                porte_sterile_ouverte = true;
-                mqtt_pub(TOPIC_PORTE_STERILE, "true");
-                lcd_show_mutex("Porte sterile", "OUVERTE");
-                ESP_LOGI(TAG, "Porte stérile ouverte");
-                
-                if (autorisation_porte_sterile) {
-                    autorisation_porte_sterile = false;
-                }
+                lcd_show_mutex("Porte sterile", "Ouverture OK");
             }
             vTaskDelay(pdMS_TO_TICKS(400));
         }
 
-        // ========== PORTE STERILE FERMER ==========
-        if (gpio_get_level(BTN_STERILE_FERME) == 0) {
-            porte_sterile_ouverte = false;
-            mqtt_pub(TOPIC_PORTE_STERILE, "false");
-            lcd_show_mutex("Porte sterile", "FERMEE");
-            ESP_LOGI(TAG, "Porte stérile fermée");
-            vTaskDelay(pdMS_TO_TICKS(400));
-        }
-
-        // ========== PORTE CONTAMINEE OUVRIR ==========
-        if (gpio_get_level(BTN_CONTAMINEE_OUVERT) == 0) {
+        // ========== DEMANDE D'OUVERTURE PORTE CONTAMINEE ==========
+        if (appuis & (1u << BOUTON_CONTAMINEE)) {
             if (verifier_interverrouillage_ouverture_contaminee()) {
-                porte_contaminee_ouverte = true;
-                mqtt_pub(TOPIC_PORTE_CONTAM, "true");
-                lcd_show_mutex("Porte contam.", "OUVERTE");
-                ESP_LOGI(TAG, "Porte contaminée ouverte");
+                lcd_show_mutex("Porte contam.", "Ouverture OK");
             }
             vTaskDelay(pdMS_TO_TICKS(400));
         }
 
-        // ========== PORTE CONTAMINEE FERMER ==========
-        if (gpio_get_level(BTN_CONTAMINEE_FERME) == 0) {
-            porte_contaminee_ouverte = false;
-            mqtt_pub(TOPIC_PORTE_CONTAM, "false");
-            lcd_show_mutex("Porte contam.", "FERMEE");
-            ESP_LOGI(TAG, "Porte contaminée fermée");
-            vTaskDelay(pdMS_TO_TICKS(400));
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Appuis arrivés pendant le traitement (rebonds compris) ignorés
+        xTaskNotifyWait(0, UINT32_MAX, NULL, 0);
     }
 }
 
@@ -727,20 +1494,93 @@ static void button_task(void *arg)
 
 
 
+#if CONFIG_PASSBOX_BENCH
+// ======================= BANC : INONDATION MQTT =======================
+// Publications QoS 0 en boucle depuis le cœur réseau sur un topic auquel le
+// poste est abonné : émission et réception chargent Wi-Fi, lwIP et esp-mqtt
+// pendant la mesure de l'arrêt d'urgence
+static volatile bool inondation_active = false;
+static volatile uint32_t inondation_messages = 0;
+
+static void inondation_task(void *arg)
+{
+    static const char charge[] = "inondation inondation inondation inondation inondation inondation "
+                                 "inondation inondation inondation inondation inondation inondation";
+    while (inondation_active) {
+        if (esp_mqtt_client_publish(mqtt_client, TOPIC_BENCH_INONDATION, charge, sizeof(charge) - 1, 0, 0) < 0) {
+            vTaskDelay(1);      // pas encore connecté
+        } else {
+            inondation_messages++;
+        }
+    }
+    xTaskNotifyGive((TaskHandle_t)arg);
+    vTaskDelete(NULL);
+}
+
+static uint32_t bench_inonder(bool active)
+{
+    if (active) {
+        inondation_messages = 0;
+        inondation_active = true;
+        xTaskCreatePinnedToCore(inondation_task, "inondation", 3072, xTaskGetCurrentTaskHandle(), 5, NULL,
+                                PASSBOX_COEUR_RESEAU);
+        return 0;
+    }
+    inondation_active = false;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5000));
+    return inondation_messages;
+}
+#else
+#define bench_inonder NULL
+#endif
+
 // ======================= APP_MAIN =======================
 void app_main(void)
 {
     ESP_LOGI(TAG, "=== DEMARRAGE SYSTEME PASS-BOX ===");
     
+    evlog_init();
     ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(parametres_init());
+    topics_init();
+    stats_init();
+    journal_init();
 
     gpio_init_buttons();
+
+    // Sorties au repos le plus tôt possible après le démarrage
+    sorties_mutex = xSemaphoreCreateMutex();
+    assert(sorties_mutex != NULL);
+    ESP_ERROR_CHECK(actionneurs_init(sorties_en_defaut));
+    actionneurs_definir_coupure(&sorties_urgence);
+
         ESP_LOGI(TAG, "Init LCD");
 
     lcd_init_full();
     lcd_show_mutex("Systeme", "Init...");
 
+    // Capteurs de porte et arrêt d'urgence : coupure directe en interruption
+    // (callbacks : LCD initialisé)
+    securite_config_t securite_cfg = {
+        .gpio_arret = BTN_ARRET,
+        .porte = porte_changee,
+        .coupure = sorties_coupees,
+        .rearmement = desactiver_urgence,
+    };
+    ESP_ERROR_CHECK(securite_init(&securite_cfg));
+    porte_sterile_ouverte = securite_porte_ouverte(PORTE_STERILE);
+    porte_contaminee_ouverte = securite_porte_ouverte(PORTE_CONTAMINEE);
+    appliquer_sorties();
+
+    ESP_ERROR_CHECK(capteurs_init());
+    ESP_ERROR_CHECK(regulation_init());
+
     wifi_init();
+
+    // Horodatage du journal d'audit
+    esp_sntp_config_t sntp_cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
+    esp_netif_sntp_init(&sntp_cfg);
+
     mqtt_init();
      ESP_LOGI(TAG, "Init I2C");
 
@@ -767,12 +1607,39 @@ void app_main(void)
 
 
 
+    bench_executer(lcd_show_mutex, bench_inonder);
+
     lcd_show_mutex("Pret", "Attente...");
+    voyant_init(voyant_lire_etat);
+
 
 
+    xTaskCreatePinnedToCore(button_task, "button_task", 4096, NULL, PASSBOX_PRIO_BOUTONS, &tache_boutons,
+                            PASSBOX_COEUR_SECURITE);
+    gpio_armer_boutons();
+    xTaskCreatePinnedToCore(cycle_task, "cycle_task", 4096, NULL, PASSBOX_PRIO_CYCLE, NULL, PASSBOX_COEUR_SECURITE);
 
-    xTaskCreate(button_task, "button_task", 4096, NULL, 5, NULL);
-    xTaskCreate(cycle_task, "cycle_task", 4096, NULL, 5, NULL);
+    // Après le banc et l'initialisation : fréquence variable et sommeil
+    // léger au repos, verrous et capteurs repris selon l'état courant
+    ESP_ERROR_CHECK(energie_init());
+    appliquer_sorties();
+
+    // Initialisation complète : la nouvelle image, s'il y en a une, n'attend
+    // plus que le broker pour être validée
+    ota_config_t ota_cfg = {
+        .publier = publier_ota,
+        .occupe = ota_occupe,
+    };
+    ESP_ERROR_CHECK(ota_init(&ota_cfg));
+
+    // Accès local quand broker ou Node-RED manquent ; non vital, un échec
+    // n'arrête pas le poste
+    api_http_config_t api_cfg = {
+        .etat_json = api_etat_json,
+        .cycle = api_cycle,
+        .urgence = api_urgence,
+    };
+    ESP_ERROR_CHECK_WITHOUT_ABORT(api_http_init(&api_cfg));
     
     ESP_LOGI(TAG, "=== SYSTEME OPERATIONNEL ===");
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include <string.h>
+#include <sys/select.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+#include "mbedtls/ssl_ciphersuites.h"
+#include "sdkconfig.h"
+
+#include "mqtt_tls.h"
+
+#if CONFIG_PASSBOX_MQTT_TLS
+
+static const char *TAG = "MQTT_TLS";
+
+#define PORT_MQTTS      8883
+
+// Forward secrecy et AES-GCM (accéléré par le matériel) uniquement
+static const int suites[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+#if !CONFIG_PASSBOX_MQTT_TLS_ECDSA_SEUL
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+#endif
+    0
+};
+
+// ======================= ETAT =======================
+// Connexion et ticket : tâche esp-mqtt uniquement. Diagnostic lu ailleurs.
+typedef struct {
+    esp_tls_t *tls;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t *session;
+#endif
+} contexte_t;
+
+static contexte_t contexte = { 0 };
+static portMUX_TYPE diag_mux = portMUX_INITIALIZER_UNLOCKED;
+static mqtt_tls_diag_t diag = { 0 };
+
+static void oublier_session(contexte_t *ctx)
+{
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (ctx->session) esp_tls_free_client_session(ctx->session);
+    ctx->session = NULL;
+#endif
+}
+
+static int attendre_socket(contexte_t *ctx, bool ecriture, int timeout_ms)
+{
+    int fd;
+    if (!ctx->tls || esp_tls_get_conn_sockfd(ctx->tls, &fd) != ESP_OK || fd < 0) return -1;
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    return select(fd + 1, ecriture ? NULL : &fds, ecriture ? &fds : NULL, NULL,
+                  timeout_ms < 0 ? NULL : &tv);
+}
+
+// ======================= FONCTIONS DU TRANSPORT =======================
+static int tls_connect(esp_transport_handle_t t, const char *hote, int port, int timeout_ms)
+{
+    contexte_t *ctx = esp_transport_get_context_data(t);
+    ctx->tls = esp_tls_init();
+    if (!ctx->tls) return -1;
+
+    esp_tls_cfg_t cfg = {
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .ciphersuites_list = suites,
+        .timeout_ms = timeout_ms,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .client_session = ctx->session,
+#endif
+    };
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    bool avec_ticket = ctx->session != NULL;
+#else
+    bool avec_ticket = false;
+#endif
+
+    int64_t debut = esp_timer_get_time();
+    if (esp_tls_conn_new_sync(hote, strlen(hote), port, &cfg, ctx->tls) <= 0) {
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+        // Ticket refusé en cours de route ou broker changé : handshake
+        // complet à la prochaine tentative
+        oublier_session(ctx);
+        portENTER_CRITICAL(&diag_mux);
+        diag.echecs++;
+        portEXIT_CRITICAL(&diag_mux);
+        return -1;
+    }
+    uint32_t duree_ms = (uint32_t)((esp_timer_get_time() - debut) / 1000);
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // Le broker peut renouveler le ticket à chaque handshake : garder le dernier
+    esp_tls_client_session_t *session = esp_tls_get_client_session(ctx->tls);
+    if (session) {
+        oublier_session(ctx);
+        ctx->session = session;
+    }
+#endif
+
+    portENTER_CRITICAL(&diag_mux);
+    diag.connexions++;
+    if (avec_ticket) diag.avec_ticket++;
+    diag.dernier_handshake_ms = duree_ms;
+    diag.dernier_avec_ticket = avec_ticket;
+    portEXIT_CRITICAL(&diag_mux);
+
+    ESP_LOGI(TAG, "Handshake %s en %lu ms", avec_ticket ? "avec ticket" : "complet", (unsigned long)duree_ms);
+    return 0;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    contexte_t *ctx = esp_transport_get_context_data(t);
+    // Octets déjà déchiffrés par mbedTLS : le socket peut rester muet
+    if (ctx->tls && esp_tls_get_bytes_avail(ctx->tls) > 0) return 1;
+    return attendre_socket(ctx, false, timeout_ms);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    return attendre_socket(esp_transport_get_context_data(t), true, timeout_ms);
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    contexte_t *ctx = esp_transport_get_context_data(t);
+    int pret = tls_poll_read(t, timeout_ms);
+    if (pret <= 0) return pret < 0 ? -1 : ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+
+    ssize_t n = esp_tls_conn_read(ctx->tls, buffer, len);
+    if (n == ESP_TLS_ERR_SSL_WANT_READ || n == ESP_TLS_ERR_SSL_WANT_WRITE) return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    if (n == 0) return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    return n < 0 ? -1 : (int)n;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    contexte_t *ctx = esp_transport_get_context_data(t);
+    int pret = tls_poll_write(t, timeout_ms);
+    if (pret <= 0) return pret < 0 ? -1 : ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+
+    ssize_t n = esp_tls_conn_write(ctx->tls, buffer, len);
+    if (n == ESP_TLS_ERR_SSL_WANT_READ || n == ESP_TLS_ERR_SSL_WANT_WRITE) return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    return n < 0 ? -1 : (int)n;
+}
+
+static int tls_close(esp_transport_handle_t t)
+{
+    // Le ticket survit à la connexion : c'est tout l'intérêt
+    contexte_t *ctx = esp_transport_get_context_data(t);
+    int ret = 0;
+    if (ctx->tls) ret = esp_tls_conn_destroy(ctx->tls);
+    ctx->tls = NULL;
+    return ret;
+}
+
+static int tls_destroy(esp_transport_handle_t t)
+{
+    contexte_t *ctx = esp_transport_get_context_data(t);
+    tls_close(t);
+    oublier_session(ctx);
+    return 0;
+}
+
+// ======================= API =======================
+esp_transport_handle_t mqtt_tls_creer(void)
+{
+    esp_transport_handle_t t = esp_transport_init();
+    if (!t) return NULL;
+
+    esp_transport_set_context_data(t, &contexte);
+    esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close,
+                           tls_poll_read, tls_poll_write, tls_destroy);
+    esp_transport_set_default_port(t, PORT_MQTTS);
+    return t;
+}
+
+void mqtt_tls_diagnostic(mqtt_tls_diag_t *d)
+{
+    portENTER_CRITICAL(&diag_mux);
+    *d = diag;
+    portEXIT_CRITICAL(&diag_mux);
+}
+
+#else
+
+esp_transport_handle_t mqtt_tls_creer(void)
+{
+    return NULL;
+}
+
+void mqtt_tls_diagnostic(mqtt_tls_diag_t *d)
+{
+    *d = (mqtt_tls_diag_t){ 0 };
+}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_transport.h"
+
+// ======================= TRANSPORT MQTT TLS =======================
+// Transport esp-tls pour esp-mqtt : broker vérifié par le bundle x509 de
+// l'image, suites ECDHE AES-GCM, et ticket de session TLS de la connexion
+// précédente présenté à la suivante. Après une coupure Wi-Fi, la reconnexion
+// fait un handshake abrégé : ni échange ECDHE ni vérification de chaîne.
+
+typedef struct {
+    uint32_t connexions;            // handshakes réussis
+    uint32_t avec_ticket;           // dont avec un ticket présenté
+    uint32_t echecs;
+    uint32_t dernier_handshake_ms;  // TCP + TLS
+    bool dernier_avec_ticket;
+} mqtt_tls_diag_t;
+
+// Transport à passer dans esp_mqtt_client_config_t.network.transport
+// (détruit avec le client). NULL si MQTT TLS est désactivé.
+esp_transport_handle_t mqtt_tls_creer(void);
+
+void mqtt_tls_diagnostic(mqtt_tls_diag_t *diag);
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "ota.h"
+
+#if CONFIG_PASSBOX_OTA
+
+#include "esp_app_desc.h"
+#include "esp_ota_ops.h"
+#include "esp_rom_crc.h"
+#include "rom/miniz.h"
+
+#include "ota_delta.h"
+
+static const char *TAG = "OTA";
+
+// ======================= PARAMETRES =======================
+#define TAMPON_ECRITURE         4096    // un secteur par esp_ota_write
+#define MORCEAU_CRC             1024
+#define DELAI_REESSAI_US        (10 * 1000 * 1000)      // validation repoussée pendant un cycle
+
+typedef enum {
+    FORMAT_IMAGE = 0,
+    FORMAT_DELTA,
+} format_t;
+
+static const char *const formats[] = {
+    [FORMAT_IMAGE] = "image",
+    [FORMAT_DELTA] = "delta",
+};
+
+// ======================= ETAT =======================
+// Transfert : tâche esp-mqtt, plus l'annulation (démarrage de cycle depuis
+// une autre tâche) ; toujours sous verrou
+typedef struct {
+    bool actif;
+    format_t format;
+    uint32_t taille;                // octets transférés attendus (image ou patch)
+    uint32_t recu;                  // prochaine position attendue
+    bool ignorer;                   // message en cours : doublon ou hors séquence
+    const esp_partition_t *cible;
+    const esp_partition_t *base;
+    esp_ota_handle_t handle;
+    uint8_t *tampon;
+    size_t tampon_len;
+    // Différentielle : en-tête, puis flux zlib décompressé dans un
+    // dictionnaire circulaire de 32 Ko
+    uint8_t entete[OTA_DELTA_ENTETE];
+    size_t entete_len;
+    tinfl_decompressor *inflateur;
+    uint8_t *dico;
+    size_t dico_pos;
+    bool flux_fini;
+    ota_delta_t delta;
+} transfert_t;
+
+static ota_config_t config;
+static SemaphoreHandle_t verrou = NULL;
+static transfert_t tr;
+
+// Validation de l'image en cours
+static portMUX_TYPE validation_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t timer_validation = NULL;
+static bool en_attente = false;     // premier démarrage de l'image, non validée
+static bool demarre = false;        // ota_init passé
+static bool joint = false;          // broker joint au moins une fois
+static bool validee_ici = false;    // validée pendant ce démarrage
+
+static void publier(const char *json)
+{
+    if (config.publier) config.publier(json);
+}
+
+static void publier_erreur(const char *raison)
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"etat\":\"erreur\",\"raison\":\"%s\",\"recu\":%lu}", raison,
+             (unsigned long)tr.recu);
+    publier(buf);
+    ESP_LOGE(TAG, "%s (position %lu)", raison, (unsigned long)tr.recu);
+}
+
+static void liberer(void)
+{
+    if (tr.handle) esp_ota_abort(tr.handle);
+    free(tr.tampon);
+    free(tr.inflateur);
+    free(tr.dico);
+    memset(&tr, 0, sizeof(tr));
+}
+
+// ======================= ECRITURE =======================
+static esp_err_t vider(void)
+{
+    if (!tr.tampon_len) return ESP_OK;
+    esp_err_t err = esp_ota_write(tr.handle, tr.tampon, tr.tampon_len);
+    tr.tampon_len = 0;
+    return err;
+}
+
+static esp_err_t ecrire_image(const uint8_t *p, size_t n)
+{
+    while (n > 0) {
+        size_t k = TAMPON_ECRITURE - tr.tampon_len;
+        if (k > n) k = n;
+        memcpy(tr.tampon + tr.tampon_len, p, k);
+        tr.tampon_len += k;
+        p += k;
+        n -= k;
+        if (tr.tampon_len == TAMPON_ECRITURE) {
+            esp_err_t err = vider();
+            if (err != ESP_OK) return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static int lire_base(void *ctx, uint32_t position, uint8_t *buf, size_t len)
+{
+    return esp_partition_read(tr.base, position, buf, len) == ESP_OK ? 0 : -1;
+}
+
+static int ecrire_nouvelle(void *ctx, const uint8_t *buf, size_t len)
+{
+    return ecrire_image(buf, len) == ESP_OK ? 0 : -1;
+}
+
+// ======================= DIFFERENTIELLE =======================
+// Le patch ne s'applique qu'à l'image exacte dont il est issu
+static const char *verifier_base(void)
+{
+    ota_delta_entete_t e;
+    if (!ota_delta_lire_entete(tr.entete, &e)) return "patch invalide";
+    if (e.taille_base > tr.base->size || e.taille_image > tr.cible->size) return "patch trop grand";
+
+    uint8_t buf[MORCEAU_CRC];
+    uint32_t crc = 0;
+    for (uint32_t pos = 0; pos < e.taille_base; pos += sizeof(buf)) {
+        uint32_t k = e.taille_base - pos < sizeof(buf) ? e.taille_base - pos : sizeof(buf);
+        if (esp_partition_read(tr.base, pos, buf, k) != ESP_OK) return "lecture base";
+        crc = esp_rom_crc32_le(crc, buf, k);
+    }
+    if (crc != e.crc_base) return "base differente";
+
+    ota_delta_init(&tr.delta, &e, lire_base, ecrire_nouvelle, NULL);
+    return NULL;
+}
+
+static const char *inflater(const uint8_t *p, size_t n)
+{
+    while (1) {
+        if (tr.flux_fini) return n ? "donnees apres le patch" : NULL;
+
+        size_t entree = n, sortie = TINFL_LZ_DICT_SIZE - tr.dico_pos;
+        tinfl_status st = tinfl_decompress(tr.inflateur, p, &entree, tr.dico, tr.dico + tr.dico_pos, &sortie,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        p += entree;
+        n -= entree;
+        if (sortie) {
+            if (ota_delta_appliquer(&tr.delta, tr.dico + tr.dico_pos, sortie) != 0) return "patch incoherent";
+            tr.dico_pos = (tr.dico_pos + sortie) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+        if (st < TINFL_STATUS_DONE) return "flux zlib";
+        if (st == TINFL_STATUS_DONE) tr.flux_fini = true;
+        else if (st == TINFL_STATUS_NEEDS_MORE_INPUT && n == 0) return NULL;
+    }
+}
+
+// Octets du transfert à partir de tr.recu
+static const char *recevoir(const uint8_t *p, size_t n)
+{
+    if (tr.format == FORMAT_IMAGE) return ecrire_image(p, n) == ESP_OK ? NULL : "ecriture";
+
+    // En-tête non compressé, éventuellement à cheval sur deux blocs
+    if (tr.entete_len < OTA_DELTA_ENTETE) {
+        size_t k = OTA_DELTA_ENTETE - tr.entete_len;
+        if (k > n) k = n;
+        memcpy(tr.entete + tr.entete_len, p, k);
+        tr.entete_len += k;
+        p += k;
+        n -= k;
+        if (tr.entete_len < OTA_DELTA_ENTETE) return NULL;
+        const char *erreur = verifier_base();
+        if (erreur) return erreur;
+    }
+    return n ? inflater(p, n) : NULL;
+}
+
+// ======================= COMMANDES =======================
+static void debuter(const char *requete)
+{
+    unsigned long taille = 0;
+    char format[8] = "image";
+    for (const char *l = requete; l && *l; l = strchr(l, '\n') ? strchr(l, '\n') + 1 : NULL) {
+        if (sscanf(l, "taille=%lu", &taille) == 1) continue;
+        sscanf(l, "format=%7[a-z]", format);
+    }
+
+    if (tr.actif) {
+        ESP_LOGW(TAG, "Transfert précédent abandonné");
+        liberer();
+    }
+    if (config.occupe && config.occupe()) {
+        publier_erreur("cycle en cours");
+        return;
+    }
+
+    tr.format = strcmp(format, "delta") == 0 ? FORMAT_DELTA : FORMAT_IMAGE;
+    tr.taille = taille;
+    tr.base = esp_ota_get_running_partition();
+    tr.cible = esp_ota_get_next_update_partition(NULL);
+    if (!tr.cible || !tr.base) {
+        publier_erreur("pas de partition OTA");
+        return;
+    }
+    if (!taille || (tr.format == FORMAT_IMAGE && taille > tr.cible->size)) {
+        publier_erreur("taille invalide");
+        return;
+    }
+
+    tr.tampon = malloc(TAMPON_ECRITURE);
+    if (tr.format == FORMAT_DELTA) {
+        tr.inflateur = malloc(sizeof(tinfl_decompressor));
+        tr.dico = malloc(TINFL_LZ_DICT_SIZE);
+        if (tr.inflateur) tinfl_init(tr.inflateur);
+    }
+    if (!tr.tampon || (tr.format == FORMAT_DELTA && (!tr.inflateur || !tr.dico))) {
+        liberer();
+        publier_erreur("memoire");
+        return;
+    }
+
+    // Effacement au fil de l'écriture : pas de pause de plusieurs secondes
+    esp_err_t err = esp_ota_begin(tr.cible, OTA_WITH_SEQUENTIAL_WRITES, &tr.handle);
+    if (err != ESP_OK) {
+        tr.handle = 0;
+        liberer();
+        publier_erreur(esp_err_to_name(err));
+        return;
+    }
+    tr.actif = true;
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"etat\":\"pret\",\"format\":\"%s\",\"taille\":%lu,\"partition\":\"%s\"}",
+             formats[tr.format], taille, tr.cible->label);
+    publier(buf);
+    ESP_LOGI(TAG, "Réception %s de %lu octets vers %s", formats[tr.format], taille, tr.cible->label);
+}
+
+static bool terminer(void)
+{
+    if (!tr.actif) {
+        publier_erreur("aucun transfert");
+        return false;
+    }
+    if (tr.recu != tr.taille) {
+        publier_erreur("transfert incomplet");
+        return false;
+    }
+    if (tr.format == FORMAT_DELTA && (!tr.flux_fini || !ota_delta_termine(&tr.delta))) {
+        publier_erreur("patch incomplet");
+        liberer();
+        return false;
+    }
+
+    // esp_ota_end vérifie l'image reconstituée, signature comprise
+    // (PASSBOX_OTA dépend de SECURE_SIGNED_ON_UPDATE), et libère le handle
+    // dans tous les cas
+    esp_err_t err = vider();
+    if (err == ESP_OK) {
+        err = esp_ota_end(tr.handle);
+        tr.handle = 0;
+    }
+    if (err == ESP_OK) err = esp_ota_set_boot_partition(tr.cible);
+    if (err != ESP_OK) {
+        publier_erreur(err == ESP_ERR_OTA_VALIDATE_FAILED ? "image ou signature invalide" : esp_err_to_name(err));
+        liberer();
+        return false;
+    }
+
+    bool redemarrer = !(config.occupe && config.occupe());
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"etat\":\"termine\",\"partition\":\"%s\",\"redemarrage\":%s}", tr.cible->label,
+             redemarrer ? "true" : "false");
+    ESP_LOGI(TAG, "Image écrite dans %s, démarrage suivant dessus", tr.cible->label);
+    liberer();
+    publier(buf);
+    return redemarrer;
+}
+
+bool ota_commande(const char *commande)
+{
+    if (!verrou) return false;
+    bool redemarrer = false;
+
+    xSemaphoreTake(verrou, portMAX_DELAY);
+    if (strcmp(commande, "fin") == 0) {
+        redemarrer = terminer();
+    } else if (strcmp(commande, "annuler") == 0) {
+        if (tr.actif) liberer();
+        publier("{\"etat\":\"annulee\",\"raison\":\"commande\"}");
+    } else {
+        debuter(commande);
+    }
+    xSemaphoreGive(verrou);
+    return redemarrer;
+}
+
+void ota_bloc(const char *data, int len, int position_message, int taille_message)
+{
+    if (!verrou) return;
+    const uint8_t *p = (const uint8_t *)data;
+    bool dernier = position_message + len >= taille_message;
+
+    xSemaphoreTake(verrou, portMAX_DELAY);
+    if (!tr.actif) {
+        if (dernier) publier_erreur("aucun transfert");
+        xSemaphoreGive(verrou);
+        return;
+    }
+
+    // Début du message : position du bloc. Doublon (accusé perdu) ou bloc
+    // en avance (bloc perdu) : ignoré, l'accusé redonne la position attendue.
+    if (position_message == 0) {
+        uint32_t position = len >= 4 ? (uint32_t)p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24 : UINT32_MAX;
+        tr.ignorer = position != tr.recu;
+        p += 4;
+        len -= 4;
+    }
+
+    const char *erreur = NULL;
+    if (!tr.ignorer && len > 0) {
+        if (tr.recu + len > tr.taille) {
+            erreur = "au-dela de la taille annoncee";
+        } else {
+            erreur = recevoir(p, len);
+            tr.recu += len;
+        }
+    }
+
+    if (erreur) {
+        publier_erreur(erreur);
+        liberer();
+    } else if (dernier) {
+        char buf[80];
+        snprintf(buf, sizeof(buf), "{\"etat\":\"reception\",\"recu\":%lu,\"taille\":%lu}", (unsigned long)tr.recu,
+                 (unsigned long)tr.taille);
+        publier(buf);
+    }
+    xSemaphoreGive(verrou);
+}
+
+void ota_annuler(const char *raison)
+{
+    if (!verrou) return;
+    xSemaphoreTake(verrou, portMAX_DELAY);
+    if (tr.actif) {
+        ESP_LOGW(TAG, "Transfert annulé: %s", raison);
+        liberer();
+        char buf[96];
+        snprintf(buf, sizeof(buf), "{\"etat\":\"annulee\",\"raison\":\"%s\"}", raison);
+        publier(buf);
+    }
+    xSemaphoreGive(verrou);
+}
+
+// ======================= VALIDATION =======================
+static void publier_etat(void)
+{
+    const esp_partition_t *courante = esp_ota_get_running_partition();
+    const esp_partition_t *invalide = esp_ota_get_last_invalid_partition();
+    portENTER_CRITICAL(&validation_mux);
+    const char *validation = en_attente ? "en attente" : validee_ici ? "validee" : "ok";
+    portEXIT_CRITICAL(&validation_mux);
+
+    char buf[192];
+    int n = snprintf(buf, sizeof(buf), "{\"etat\":\"active\",\"version\":\"%s\",\"partition\":\"%s\",\"validation\":\"%s\"",
+                     esp_app_get_description()->version, courante ? courante->label : "?", validation);
+    // Image précédente rejetée (auto-test échoué) : retour signalé
+    if (invalide) n += snprintf(buf + n, sizeof(buf) - n, ",\"rejetee\":\"%s\"", invalide->label);
+    snprintf(buf + n, sizeof(buf) - n, "}");
+    publier(buf);
+}
+
+static void valider(void)
+{
+    esp_timer_stop(timer_validation);
+    esp_err_t err = esp_ota_mark_app_valid_cancel_rollback();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Validation: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Image validée (initialisation complète, broker joint)");
+}
+
+// Auto-test non passé à temps : retour à l'image précédente, jamais au
+// milieu d'un cycle
+static void delai_depasse(void *arg)
+{
+    if (config.occupe && config.occupe()) {
+        esp_timer_start_once(timer_validation, DELAI_REESSAI_US);
+        return;
+    }
+    ESP_LOGE(TAG, "Broker injoignable avec la nouvelle image : retour à la précédente");
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+}
+
+void ota_connecte(void)
+{
+    portENTER_CRITICAL(&validation_mux);
+    joint = true;
+    bool a_valider = demarre && en_attente;
+    if (a_valider) {
+        en_attente = false;
+        validee_ici = true;
+    }
+    portEXIT_CRITICAL(&validation_mux);
+
+    if (a_valider) valider();
+    if (demarre) publier_etat();
+}
+
+esp_err_t ota_init(const ota_config_t *cfg)
+{
+    config = *cfg;
+    verrou = xSemaphoreCreateMutex();
+    if (!verrou) return ESP_ERR_NO_MEM;
+
+    esp_ota_img_states_t etat;
+    const esp_partition_t *courante = esp_ota_get_running_partition();
+    bool nouvelle = esp_ota_get_state_partition(courante, &etat) == ESP_OK && etat == ESP_OTA_IMG_PENDING_VERIFY;
+    if (nouvelle) {
+        esp_timer_create_args_t timer_args = {
+            .callback = delai_depasse,
+            .name = "ota_validation",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &timer_validation);
+        if (err != ESP_OK) return err;
+        esp_timer_start_once(timer_validation, (uint64_t)CONFIG_PASSBOX_OTA_DELAI_VALIDATION_S * 1000000);
+        ESP_LOGW(TAG, "Nouvelle image sur %s, validation au premier contact du broker (%d s)",
+                 courante->label, CONFIG_PASSBOX_OTA_DELAI_VALIDATION_S);
+    }
+
+    // Broker peut-être déjà joint pendant l'initialisation
+    portENTER_CRITICAL(&validation_mux);
+    en_attente = nouvelle;
+    demarre = true;
+    bool a_valider = joint && en_attente;
+    if (a_valider) {
+        en_attente = false;
+        validee_ici = true;
+    }
+    portEXIT_CRITICAL(&validation_mux);
+
+    if (a_valider) valider();
+    if (joint) publier_etat();
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t ota_init(const ota_config_t *cfg)
+{
+    return ESP_OK;
+}
+
+void ota_connecte(void)
+{
+}
+
+bool ota_commande(const char *commande)
+{
+    return false;
+}
+
+void ota_bloc(const char *data, int len, int position_message, int taille_message)
+{
+}
+
+void ota_annuler(const char *raison)
+{
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+// ======================= MISE A JOUR (OTA) =======================
+// Image complète ou différentielle (ota_delta.h) reçue par blocs sur la
+// connexion MQTT et écrite au fil de l'eau dans la partition OTA inactive :
+// ni l'image ni le patch ne sont gardés en RAM. La signature de l'image
+// reconstituée est vérifiée par esp_ota_end (applications signées d'ESP-IDF)
+// avant de changer la partition de démarrage.
+// Nouvelle image en attente de validation au démarrage suivant : validée
+// une fois l'initialisation terminée et le broker joint, sinon le chargeur
+// revient à l'image précédente (redémarrage au plus tard après
+// CONFIG_PASSBOX_OTA_DELAI_VALIDATION_S, jamais pendant un cycle).
+//
+// Protocole (topics du poste) :
+//   cmd/ota       "taille=<octets>\nformat=image|delta" : début
+//                 "fin" : vérification, partition de démarrage, redémarrage
+//                 "annuler"
+//   cmd/ota/bloc  position u32 petit-boutiste + données, dans l'ordre
+//   ota           état JSON, un accusé par bloc ("recu" : prochaine position)
+
+typedef struct {
+    void (*publier)(const char *json);      // état, sur le topic ota
+    bool (*occupe)(void);                   // cycle en cours : ni début, ni redémarrage
+} ota_config_t;
+
+// Après l'initialisation complète du poste : arme la validation si l'image
+// en cours démarre pour la première fois
+esp_err_t ota_init(const ota_config_t *cfg);
+
+// Broker joint : valide l'image en attente, publie l'état courant
+void ota_connecte(void);
+
+// Commande texte de cmd/ota (tâche esp-mqtt). Retourne true si le poste
+// doit redémarrer sur la nouvelle image.
+bool ota_commande(const char *commande);
+
+// Fragment d'un message de cmd/ota/bloc, tel que livré par esp-mqtt
+void ota_bloc(const char *data, int len, int position_message, int taille_message);
+
+// Annule un transfert en cours (démarrage de cycle)
+void ota_annuler(const char *raison);
@@ -0,0 +1,116 @@
+#include <string.h>
+
+#include "ota_delta.h"
+
+// Morceau de base relu à la fois pendant une phase diff
+#define MORCEAU         256
+
+static uint32_t lire_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void ecrire_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// ======================= EN-TETE =======================
+bool ota_delta_lire_entete(const uint8_t buf[OTA_DELTA_ENTETE], ota_delta_entete_t *e)
+{
+    if (memcmp(buf, OTA_DELTA_MAGIC, 4) != 0) return false;
+    e->taille_base = lire_u32(buf + 4);
+    e->crc_base = lire_u32(buf + 8);
+    e->taille_image = lire_u32(buf + 12);
+    return true;
+}
+
+void ota_delta_ecrire_entete(const ota_delta_entete_t *e, uint8_t buf[OTA_DELTA_ENTETE])
+{
+    memcpy(buf, OTA_DELTA_MAGIC, 4);
+    ecrire_u32(buf + 4, e->taille_base);
+    ecrire_u32(buf + 8, e->crc_base);
+    ecrire_u32(buf + 12, e->taille_image);
+}
+
+// ======================= APPLICATION =======================
+void ota_delta_init(ota_delta_t *d, const ota_delta_entete_t *e, ota_delta_lire_fn_t lire,
+                    ota_delta_ecrire_fn_t ecrire, void *ctx)
+{
+    memset(d, 0, sizeof(*d));
+    d->entete = *e;
+    d->lire = lire;
+    d->ecrire = ecrire;
+    d->ctx = ctx;
+}
+
+// Octets ajoutés à la base : relue par morceaux, somme écrite aussitôt
+static int appliquer_diff(ota_delta_t *d, const uint8_t *buf, size_t n)
+{
+    uint8_t base[MORCEAU];
+    while (n > 0) {
+        size_t k = n < MORCEAU ? n : MORCEAU;
+        if (d->position_base < 0 || d->position_base + k > d->entete.taille_base) return -1;
+        int err = d->lire(d->ctx, (uint32_t)d->position_base, base, k);
+        if (err) return err;
+        for (size_t i = 0; i < k; i++) base[i] += buf[i];
+        err = d->ecrire(d->ctx, base, k);
+        if (err) return err;
+        d->position_base += k;
+        d->produits += k;
+        buf += k;
+        n -= k;
+    }
+    return 0;
+}
+
+int ota_delta_appliquer(ota_delta_t *d, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        // En-tête d'enregistrement, éventuellement à cheval sur deux appels
+        if (d->enreg_len < OTA_DELTA_ENREG) {
+            size_t k = OTA_DELTA_ENREG - d->enreg_len;
+            if (k > len) k = len;
+            memcpy(d->enreg + d->enreg_len, buf, k);
+            d->enreg_len += k;
+            buf += k;
+            len -= k;
+            if (d->enreg_len < OTA_DELTA_ENREG) return 0;
+
+            d->diff = lire_u32(d->enreg);
+            d->extra = lire_u32(d->enreg + 4);
+            d->saut = (int32_t)lire_u32(d->enreg + 8);
+            if ((uint64_t)d->produits + d->diff + d->extra > d->entete.taille_image) return -1;
+        } else if (d->diff > 0) {
+            size_t k = d->diff < len ? d->diff : len;
+            int err = appliquer_diff(d, buf, k);
+            if (err) return err;
+            d->diff -= k;
+            buf += k;
+            len -= k;
+        } else if (d->extra > 0) {
+            size_t k = d->extra < len ? d->extra : len;
+            int err = d->ecrire(d->ctx, buf, k);
+            if (err) return err;
+            d->produits += k;
+            d->extra -= k;
+            buf += k;
+            len -= k;
+        }
+
+        // Enregistrement terminé (ou vide) : saut dans la base, suivant
+        if (d->enreg_len == OTA_DELTA_ENREG && d->diff == 0 && d->extra == 0) {
+            d->position_base += d->saut;
+            d->enreg_len = 0;
+        }
+    }
+    return 0;
+}
+
+bool ota_delta_termine(const ota_delta_t *d)
+{
+    return d->enreg_len == 0 && d->produits == d->entete.taille_image;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ======================= IMAGE DIFFERENTIELLE =======================
+// Patch de type bsdiff rejoué en flux : l'ancienne image (partition en
+// cours) est relue par petits morceaux, la nouvelle écrite strictement en
+// séquence, sans jamais tenir l'une ou l'autre en RAM. Sans dépendance
+// ESP-IDF : compilé aussi par tools/passbox_ota pour vérifier un patch
+// avant envoi.
+//
+// Fichier patch (entiers petit-boutistes) :
+//   en-tête  "PBD1", taille de la base, CRC-32 de la base, taille de la
+//            nouvelle image (16 octets, non compressés)
+//   corps    flux zlib d'enregistrements :
+//              diff u32, extra u32, saut i32 (12 octets)
+//              diff octets ajoutés (mod 256) à la base à la position courante
+//              extra octets copiés tels quels
+//            la position dans la base avance de diff, puis de saut.
+
+#define OTA_DELTA_MAGIC         "PBD1"
+#define OTA_DELTA_ENTETE        16
+#define OTA_DELTA_ENREG         12
+
+typedef struct {
+    uint32_t taille_base;
+    uint32_t crc_base;              // CRC-32 (zlib) des taille_base premiers octets
+    uint32_t taille_image;
+} ota_delta_entete_t;
+
+// Lecture de la base (position absolue) et écriture de la nouvelle image ;
+// 0 en cas de succès
+typedef int (*ota_delta_lire_fn_t)(void *ctx, uint32_t position, uint8_t *buf, size_t len);
+typedef int (*ota_delta_ecrire_fn_t)(void *ctx, const uint8_t *buf, size_t len);
+
+typedef struct {
+    ota_delta_entete_t entete;
+    ota_delta_lire_fn_t lire;
+    ota_delta_ecrire_fn_t ecrire;
+    void *ctx;
+    // Enregistrement en cours
+    uint8_t enreg[OTA_DELTA_ENREG];
+    uint32_t enreg_len;
+    uint32_t diff;                  // octets restants de chaque phase
+    uint32_t extra;
+    int32_t saut;
+    // Positions
+    int64_t position_base;
+    uint32_t produits;              // octets de la nouvelle image écrits
+} ota_delta_t;
+
+// false : magic absent
+bool ota_delta_lire_entete(const uint8_t buf[OTA_DELTA_ENTETE], ota_delta_entete_t *e);
+void ota_delta_ecrire_entete(const ota_delta_entete_t *e, uint8_t buf[OTA_DELTA_ENTETE]);
+
+void ota_delta_init(ota_delta_t *d, const ota_delta_entete_t *e, ota_delta_lire_fn_t lire,
+                    ota_delta_ecrire_fn_t ecrire, void *ctx);
+
+// Corps décompressé, par morceaux de taille quelconque. 0 si accepté, -1 si
+// le patch sort de la base ou de la nouvelle image, code de lire/ecrire sinon.
+int ota_delta_appliquer(ota_delta_t *d, const uint8_t *buf, size_t len);
+
+// Nouvelle image complète, sans enregistrement entamé
+bool ota_delta_termine(const ota_delta_t *d);
@@ -0,0 +1,420 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#include "parametres.h"
+
+static const char *TAG = "Parametres";
+
+#define PARAM_NVS_NAMESPACE     "config"
+#define REQUETE_MAX             512
+#define API_JETON_MIN           16
+
+// ======================= REGISTRE =======================
+typedef enum {
+    TYPE_ENTIER = 0,
+    TYPE_CHAINE,
+} type_t;
+
+typedef enum {
+    APPLICATION_HORS_CYCLE = 0,     // aussitôt, refusé pendant un cycle
+    APPLICATION_REDEMARRAGE,        // enregistré, pris en compte au démarrage
+} application_t;
+
+typedef struct {
+    const char *cle;                // clé NVS (15 caractères max) et nom dans cmd/config
+    type_t type;
+    application_t application;
+    uint16_t offset;
+    uint16_t taille;                // chaîne : taille du tableau, '\0' compris
+    int32_t min;                    // entier : bornes ; chaîne : longueur minimale
+    int32_t max;
+    int32_t defaut;
+    const char *defaut_chaine;
+    bool secret;                    // jamais renvoyé en clair
+    bool protege;                   // Kconfig ou NVS provisionnée, pas cmd/config
+} parametre_t;
+
+#define CHAMP_TAILLE(champ)     sizeof(((parametres_t *)0)->champ)
+
+#define CHAINE(c, champ, mn, def, sec) \
+    { .cle = c, .type = TYPE_CHAINE, .application = APPLICATION_REDEMARRAGE, \
+      .offset = offsetof(parametres_t, champ), .taille = CHAMP_TAILLE(champ), \
+      .min = mn, .defaut_chaine = def, .secret = sec }
+
+#define CHAINE_PROTEGEE(c, champ, mn, def) \
+    { .cle = c, .type = TYPE_CHAINE, .application = APPLICATION_REDEMARRAGE, \
+      .offset = offsetof(parametres_t, champ), .taille = CHAMP_TAILLE(champ), \
+      .min = mn, .defaut_chaine = def, .secret = true, .protege = true }
+
+#define BROCHE(c, champ, def) \
+    { .cle = c, .type = TYPE_ENTIER, .application = APPLICATION_REDEMARRAGE, \
+      .offset = offsetof(parametres_t, champ), .min = 0, .max = GPIO_NUM_MAX - 1, .defaut = def }
+
+#define DUREE(c, etape, mn, mx, def) \
+    { .cle = c, .type = TYPE_ENTIER, .application = APPLICATION_HORS_CYCLE, \
+      .offset = offsetof(parametres_t, duree_etape_ms[etape]), .min = mn, .max = mx, .defaut = def }
+
+static const parametre_t registre[] = {
+    CHAINE("wifi_ssid",         wifi_ssid,      1, CONFIG_PASSBOX_WIFI_SSID, false),
+    CHAINE("wifi_mdp",          wifi_mdp,       0, CONFIG_PASSBOX_WIFI_MDP, true),
+    CHAINE("mqtt_uri",          mqtt_uri,       8, CONFIG_PASSBOX_MQTT_URI, false),
+    CHAINE_PROTEGEE("api_jeton", api_jeton,     0, CONFIG_PASSBOX_API_JETON),
+    CHAINE("site",              site,           0, "", false),
+    CHAINE("salle",             salle,          0, "", false),
+    CHAINE("poste",             poste,          0, "", false),
+
+    BROCHE("gpio_depart",         gpio_depart,            27),
+    BROCHE("gpio_arret",          gpio_arret,             14),
+    BROCHE("gpio_sterile",        gpio_sterile_ouvert,    26),
+    BROCHE("gpio_contaminee",     gpio_contaminee_ouvert, 13),
+    BROCHE("gpio_i2c_sda",        gpio_i2c_sda,           21),
+    BROCHE("gpio_i2c_scl",        gpio_i2c_scl,           22),
+
+    // ms ; sur les étapes à fin mesurée, base du délai maximal
+    DUREE("duree_extr_air",     ETAPE_EXTRACTION_AIR,       500, 3600000, 3000),
+    DUREE("duree_arret_air",    ETAPE_ARRET_AIR,            500, 3600000, 2000),
+    DUREE("duree_injection",    ETAPE_INJECTION_PRODUIT,    500, 3600000, 2000),
+    DUREE("duree_pause",        ETAPE_PAUSE_STERILISATION, 1000, 7200000, 20000),
+    DUREE("duree_extr_prod",    ETAPE_EXTRACTION_PRODUIT,   500, 3600000, 3000),
+    DUREE("duree_renouv",       ETAPE_RENOUVELLEMENT_AIR,   500, 3600000, 3000),
+    DUREE("duree_autoris",      ETAPE_AUTORISATION_STERILE, 500, 3600000, 2000),
+};
+
+#define NB_PARAMETRES   (sizeof(registre) / sizeof(registre[0]))
+
+// Broches déjà attribuées par Kconfig (actionneurs, capteurs, voyant)
+static const int broches_kconfig[] = {
+    CONFIG_PASSBOX_GPIO_VENTILATEUR,
+    CONFIG_PASSBOX_GPIO_VANNE,
+    CONFIG_PASSBOX_GPIO_VERROU_STERILE,
+    CONFIG_PASSBOX_GPIO_VERROU_CONTAMINEE,
+    CONFIG_PASSBOX_GPIO_PWM_VENTILATEUR,
+    CONFIG_PASSBOX_GPIO_CAPTEUR_STERILE,
+    CONFIG_PASSBOX_GPIO_CAPTEUR_CONTAMINEE,
+#if CONFIG_PASSBOX_CAPTEURS
+    CONFIG_PASSBOX_GPIO_PRESSION,
+    CONFIG_PASSBOX_GPIO_H2O2,
+    CONFIG_PASSBOX_GPIO_HUMIDITE,
+    CONFIG_PASSBOX_GPIO_TEMPERATURE,
+#endif
+#if CONFIG_PASSBOX_VOYANT
+    CONFIG_PASSBOX_VOYANT_GPIO,
+#endif
+};
+
+// ======================= ETAT =======================
+// valeurs : en vigueur, lues partout sans verrou. Seuls les entiers
+// APPLICATION_HORS_CYCLE y sont réécrits en marche (mot de 32 bits aligné).
+// enregistrees : contenu de la NVS, en avance sur valeurs tant qu'un
+// redémarrage est attendu. Modifié par la seule tâche MQTT.
+static parametres_t valeurs;
+static parametres_t enregistrees;
+static bool redemarrage_requis = false;
+
+const parametres_t *const parametres = &valeurs;
+
+static int32_t *entier(parametres_t *p, const parametre_t *d)
+{
+    return (int32_t *)((uint8_t *)p + d->offset);
+}
+
+static char *chaine(parametres_t *p, const parametre_t *d)
+{
+    return (char *)p + d->offset;
+}
+
+static const parametre_t *chercher(const char *cle)
+{
+    for (size_t i = 0; i < NB_PARAMETRES; i++) {
+        if (strcmp(registre[i].cle, cle) == 0) return &registre[i];
+    }
+    return NULL;
+}
+
+// ======================= VALIDATION =======================
+static const char *valider_valeur(const parametre_t *d, parametres_t *p, const char *texte)
+{
+    if (d->type == TYPE_CHAINE) {
+        size_t n = strlen(texte);
+        if (n < (size_t)d->min) return "valeur trop courte";
+        if (n >= d->taille) return "valeur trop longue";
+        for (const char *c = texte; *c; c++) {
+            if ((unsigned char)*c < 0x20) return "caractère de contrôle";
+        }
+        strcpy(chaine(p, d), texte);
+        return NULL;
+    }
+
+    char *fin;
+    errno = 0;
+    long v = strtol(texte, &fin, 10);
+    if (errno || fin == texte || *fin) return "entier attendu";
+    if (v < d->min || v > d->max) return "hors bornes";
+    *entier(p, d) = (int32_t)v;
+    return NULL;
+}
+
+// Contrôles croisés sur une configuration complète
+static const char *valider(const parametres_t *p)
+{
+    const int32_t broches[] = {
+        p->gpio_depart, p->gpio_arret, p->gpio_sterile_ouvert,
+        p->gpio_contaminee_ouvert, p->gpio_i2c_sda, p->gpio_i2c_scl,
+    };
+    uint64_t prises = 0;
+    for (size_t i = 0; i < sizeof(broches_kconfig) / sizeof(broches_kconfig[0]); i++) {
+        prises |= 1ULL << broches_kconfig[i];
+    }
+    for (size_t i = 0; i < sizeof(broches) / sizeof(broches[0]); i++) {
+        // Pull-up interne (boutons) et drain ouvert (I2C) : broches bidirectionnelles
+        if (!GPIO_IS_VALID_OUTPUT_GPIO(broches[i])) return "broche d'entrée seule ou inexistante";
+        if (prises & (1ULL << broches[i])) return "broche déjà utilisée";
+        prises |= 1ULL << broches[i];
+    }
+
+    if (strncmp(p->mqtt_uri, "mqtt://", 7) != 0 && strncmp(p->mqtt_uri, "mqtts://", 8) != 0) {
+        return "URI mqtt:// ou mqtts:// attendue";
+    }
+    if (p->api_jeton[0] && strlen(p->api_jeton) < API_JETON_MIN) return "api_jeton : 16 caractères au moins";
+
+    // Un niveau de topic chacun, sans joker ni "cmd" (topics de groupe)
+    const char *niveaux[] = { p->site, p->salle, p->poste };
+    for (size_t i = 0; i < sizeof(niveaux) / sizeof(niveaux[0]); i++) {
+        if (strpbrk(niveaux[i], "/+#")) return "site, salle, poste : ni '/', ni '+', ni '#'";
+        if (strcmp(niveaux[i], "cmd") == 0) return "site, salle, poste : \"cmd\" réservé";
+    }
+    if (!p->site[0] && (p->salle[0] || p->poste[0])) return "salle ou poste sans site";
+    return NULL;
+}
+
+// ======================= NVS =======================
+static void charger_defauts(parametres_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    for (size_t i = 0; i < NB_PARAMETRES; i++) {
+        const parametre_t *d = &registre[i];
+        if (d->type == TYPE_CHAINE) {
+            strlcpy(chaine(p, d), d->defaut_chaine, d->taille);
+        } else {
+            *entier(p, d) = d->defaut;
+        }
+    }
+}
+
+static void charger_nvs(parametres_t *p)
+{
+    nvs_handle_t h;
+    if (nvs_open(PARAM_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return;
+
+    for (size_t i = 0; i < NB_PARAMETRES; i++) {
+        const parametre_t *d = &registre[i];
+        char texte[CHAMP_TAILLE(mqtt_uri)];
+        esp_err_t err;
+        if (d->type == TYPE_CHAINE) {
+            size_t taille = sizeof(texte);
+            err = nvs_get_str(h, d->cle, texte, &taille);
+        } else {
+            int32_t v = 0;
+            err = nvs_get_i32(h, d->cle, &v);
+            snprintf(texte, sizeof(texte), "%ld", (long)v);
+        }
+        if (err == ESP_ERR_NVS_NOT_FOUND) continue;
+
+        // Valeur hors bornes (bornes resserrées depuis) : défaut conservé
+        const char *erreur = err == ESP_OK ? valider_valeur(d, p, texte) : esp_err_to_name(err);
+        if (erreur) ESP_LOGW(TAG, "%s ignoré en NVS: %s", d->cle, erreur);
+    }
+    nvs_close(h);
+}
+
+static esp_err_t ecrire_nvs(nvs_handle_t h, const parametre_t *d, parametres_t *p)
+{
+    if (d->type == TYPE_CHAINE) return nvs_set_str(h, d->cle, chaine(p, d));
+    return nvs_set_i32(h, d->cle, *entier(p, d));
+}
+
+static bool differe(const parametre_t *d, parametres_t *a, parametres_t *b)
+{
+    if (d->type == TYPE_CHAINE) return strcmp(chaine(a, d), chaine(b, d)) != 0;
+    return *entier(a, d) != *entier(b, d);
+}
+
+// ======================= JSON =======================
+static size_t ajouter(char *buf, size_t taille, size_t n, const char *fmt, const char *texte)
+{
+    if (n >= taille) return taille;
+    int r = snprintf(buf + n, taille - n, fmt, texte);
+    return r < 0 ? taille : n + (size_t)r;
+}
+
+// Chaîne JSON échappée (guillemets, antislash)
+static size_t ajouter_chaine(char *buf, size_t taille, size_t n, const char *s)
+{
+    n = ajouter(buf, taille, n, "%s", "\"");
+    for (; *s && n < taille; s++) {
+        if (*s == '"' || *s == '\\') n = ajouter(buf, taille, n, "%s", "\\");
+        char c[2] = { *s, 0 };
+        n = ajouter(buf, taille, n, "%s", c);
+    }
+    return ajouter(buf, taille, n, "%s", "\"");
+}
+
+size_t parametres_json(char *buf, size_t taille)
+{
+    size_t n = ajouter(buf, taille, 0, "%s", "{");
+    for (size_t i = 0; i < NB_PARAMETRES; i++) {
+        const parametre_t *d = &registre[i];
+        n = ajouter(buf, taille, n, "\"%s\":", d->cle);
+        if (d->type == TYPE_ENTIER) {
+            char v[12];
+            snprintf(v, sizeof(v), "%ld", (long)*entier(&enregistrees, d));
+            n = ajouter(buf, taille, n, "%s,", v);
+        } else {
+            n = ajouter_chaine(buf, taille, n, d->secret && chaine(&enregistrees, d)[0] ? "********" : chaine(&enregistrees, d));
+            n = ajouter(buf, taille, n, "%s", ",");
+        }
+    }
+    n = ajouter(buf, taille, n, "\"redemarrage_requis\":%s}", redemarrage_requis ? "true" : "false");
+    return n < taille ? n : 0;
+}
+
+static void repondre_erreur(char *reponse, size_t taille, const char *cle, const char *erreur)
+{
+    size_t n = ajouter(reponse, taille, 0, "%s", "{\"erreur\":");
+    n = ajouter_chaine(reponse, taille, n, erreur);
+    if (cle) {
+        n = ajouter(reponse, taille, n, "%s", ",\"cle\":");
+        n = ajouter_chaine(reponse, taille, n, cle);
+    }
+    ajouter(reponse, taille, n, "%s", "}");
+}
+
+// ======================= API =======================
+esp_err_t parametres_modifier(const char *requete, bool cycle_actif, char *reponse, size_t taille)
+{
+    if (strlen(requete) >= REQUETE_MAX) {
+        repondre_erreur(reponse, taille, NULL, "requête trop longue");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    char lignes[REQUETE_MAX];
+    strcpy(lignes, requete);
+
+    parametres_t candidat = enregistrees;
+    char *reste = NULL;
+    for (char *ligne = strtok_r(lignes, "\n", &reste); ligne; ligne = strtok_r(NULL, "\n", &reste)) {
+        ligne[strcspn(ligne, "\r")] = '\0';
+        if (!ligne[0]) continue;
+
+        char *egal = strchr(ligne, '=');
+        if (!egal) {
+            repondre_erreur(reponse, taille, ligne, "cle=valeur attendu");
+            return ESP_ERR_INVALID_ARG;
+        }
+        *egal = '\0';
+        const parametre_t *d = chercher(ligne);
+        // Le jeton de l'API protège les commandes locales : cmd/config n'est pas authentifié
+        const char *erreur = !d ? "paramètre inconnu" :
+                             d->protege ? "non modifiable par cmd/config" : valider_valeur(d, &candidat, egal + 1);
+        if (!erreur && cycle_actif && d->application == APPLICATION_HORS_CYCLE &&
+            differe(d, &candidat, &enregistrees)) {
+            erreur = "cycle en cours";
+        }
+        if (erreur) {
+            repondre_erreur(reponse, taille, ligne, erreur);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    const char *erreur = valider(&candidat);
+    if (erreur) {
+        repondre_erreur(reponse, taille, NULL, erreur);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Écriture de ce qui a changé, en un seul commit
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(PARAM_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err == ESP_OK) {
+        for (size_t i = 0; i < NB_PARAMETRES && err == ESP_OK; i++) {
+            if (differe(&registre[i], &candidat, &enregistrees)) err = ecrire_nvs(h, &registre[i], &candidat);
+        }
+        if (err == ESP_OK) err = nvs_commit(h);
+        nvs_close(h);
+    }
+    if (err != ESP_OK) {
+        repondre_erreur(reponse, taille, NULL, esp_err_to_name(err));
+        return err;
+    }
+
+    for (size_t i = 0; i < NB_PARAMETRES; i++) {
+        const parametre_t *d = &registre[i];
+        if (!differe(d, &candidat, &enregistrees)) continue;
+        ESP_LOGI(TAG, "%s modifié%s", d->cle, d->application == APPLICATION_REDEMARRAGE ? " (au redémarrage)" : "");
+        if (d->application == APPLICATION_HORS_CYCLE) {
+            *entier(&valeurs, d) = *entier(&candidat, d);
+        } else {
+            redemarrage_requis = true;
+        }
+    }
+    enregistrees = candidat;
+
+    if (!parametres_json(reponse, taille)) repondre_erreur(reponse, taille, NULL, "réponse trop longue");
+    return ESP_OK;
+}
+
+esp_err_t parametres_reinitialiser(void)
+{
+    // Les paramètres protégés gardent leur valeur provisionnée
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(PARAM_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    for (size_t i = 0; i < NB_PARAMETRES && err == ESP_OK; i++) {
+        if (registre[i].protege) continue;
+        err = nvs_erase_key(h, registre[i].cle);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    }
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) return err;
+
+    parametres_t defauts;
+    charger_defauts(&defauts);
+    for (size_t i = 0; i < NB_PARAMETRES; i++) {
+        const parametre_t *d = &registre[i];
+        if (d->protege) continue;
+        if (d->type == TYPE_CHAINE) {
+            strcpy(chaine(&enregistrees, d), chaine(&defauts, d));
+        } else {
+            *entier(&enregistrees, d) = *entier(&defauts, d);
+        }
+    }
+    redemarrage_requis = true;
+    ESP_LOGI(TAG, "Paramètres par défaut au prochain démarrage");
+    return ESP_OK;
+}
+
+esp_err_t parametres_init(void)
+{
+    charger_defauts(&valeurs);
+    charger_nvs(&valeurs);
+
+    const char *erreur = valider(&valeurs);
+    if (erreur) {
+        // Combinaison incohérente (broche reprise par Kconfig...) : démarrer
+        // sur une configuration connue plutôt que sur une broche en conflit
+        ESP_LOGE(TAG, "Configuration NVS rejetée (%s), valeurs par défaut", erreur);
+        charger_defauts(&valeurs);
+    }
+    enregistrees = valeurs;
+
+    ESP_LOGI(TAG, "WiFi \"%s\", broker %s, site \"%s\", salle \"%s\", poste \"%s\"",
+             valeurs.wifi_ssid, valeurs.mqtt_uri, valeurs.site, valeurs.salle, valeurs.poste);
+    return ESP_OK;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "passbox.h"
+
+// ======================= PARAMETRES D'EXPLOITATION =======================
+// Registre typé des réglages propres à chaque poste : réseau, broker,
+// espace de noms des topics, broches des boutons et du bus I2C, durées
+// d'étape.
+// Valeurs par défaut et bornes sont déclarées une fois dans parametres.c ;
+// les surcharges vivent en NVS (espace "config") et sont chargées au
+// démarrage dans une structure en RAM, lue directement ensuite (ni accès
+// NVS ni verrou). Modifiables par MQTT (cmd/config) : les durées d'étape
+// s'appliquent aussitôt hors cycle, le reste au redémarrage suivant.
+
+typedef struct {
+    char wifi_ssid[33];
+    char wifi_mdp[65];
+    char mqtt_uri[128];
+    char api_jeton[65];             // API HTTP locale : vide, commandes refusées
+    // Topics <site>/<salle>/<poste>/... ; site vide : topics sans préfixe
+    // (poste unique). poste vide : "passbox-" et la fin de l'adresse MAC.
+    char site[24];
+    char salle[24];                 // facultative
+    char poste[24];
+    int32_t gpio_depart;
+    int32_t gpio_arret;
+    int32_t gpio_sterile_ouvert;
+    int32_t gpio_contaminee_ouvert;
+    int32_t gpio_i2c_sda;
+    int32_t gpio_i2c_scl;
+    int32_t duree_etape_ms[ETAPE_NB];
+} parametres_t;
+
+// Valeurs en vigueur (lecture seule hors de parametres.c)
+extern const parametres_t *const parametres;
+
+esp_err_t parametres_init(void);
+
+// Requête "cle=valeur", une par ligne, appliquée en tout ou rien après
+// validation. cycle_actif : les paramètres appliqués aussitôt sont refusés.
+// Les paramètres protégés (api_jeton) le sont toujours.
+// reponse reçoit la configuration enregistrée en JSON, ou l'erreur.
+esp_err_t parametres_modifier(const char *requete, bool cycle_actif, char *reponse, size_t taille);
+
+// Efface les surcharges NVS, paramètres protégés exceptés : valeurs par
+// défaut au redémarrage suivant
+esp_err_t parametres_reinitialiser(void);
+
+// Configuration enregistrée (secrets masqués). Retourne la longueur écrite,
+// 0 si le buffer est trop petit.
+size_t parametres_json(char *buf, size_t taille);
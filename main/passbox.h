@@ -0,0 +1,81 @@
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+// Chemins chauds placés en IRAM dans le profil production (évite les défauts
+// de cache flash sur les fonctions appelées à chaque événement).
+#if CONFIG_PASSBOX_IRAM_CHEMINS_CRITIQUES
+#define PASSBOX_CHEMIN_CRITIQUE IRAM_ATTR
+#else
+#define PASSBOX_CHEMIN_CRITIQUE
+#endif
+
+// ======================= ORDONNANCEMENT =======================
+// Cœur de sécurité (APP_CPU) : ISR des portes et de l'arrêt d'urgence,
+// tâches sécurité, actionneurs, capteurs process, boutons et cycle.
+// Cœur réseau (PRO_CPU) : Wi-Fi, lwIP, esp-mqtt et esp_timer (épinglés par
+// sdkconfig), voyant, evlog, journal. Les priorités du cœur de sécurité
+// restent au-dessus de lwIP (18) pour garder l'ordre en mono-cœur.
+// Sans CONFIG_PASSBOX_ORDONNANCEMENT : tâches flottantes, priorités d'origine.
+#if CONFIG_PASSBOX_ORDONNANCEMENT && !CONFIG_FREERTOS_UNICORE
+#define PASSBOX_COEUR_SECURITE      1
+#define PASSBOX_COEUR_RESEAU        0
+#else
+#define PASSBOX_COEUR_SECURITE      tskNO_AFFINITY
+#define PASSBOX_COEUR_RESEAU        tskNO_AFFINITY
+#endif
+
+#if CONFIG_PASSBOX_ORDONNANCEMENT
+#define PASSBOX_PRIO_SECURITE       CONFIG_PASSBOX_PRIO_SECURITE
+#define PASSBOX_PRIO_ACTIONNEURS    CONFIG_PASSBOX_PRIO_ACTIONNEURS
+#define PASSBOX_PRIO_CAPTEURS       CONFIG_PASSBOX_PRIO_CAPTEURS
+#define PASSBOX_PRIO_BOUTONS        CONFIG_PASSBOX_PRIO_BOUTONS
+#define PASSBOX_PRIO_CYCLE          CONFIG_PASSBOX_PRIO_CYCLE
+#else
+#define PASSBOX_PRIO_SECURITE       6
+#define PASSBOX_PRIO_ACTIONNEURS    4
+#define PASSBOX_PRIO_CAPTEURS       4
+#define PASSBOX_PRIO_BOUTONS        5
+#define PASSBOX_PRIO_CYCLE          5
+#endif
+
+// ======================= ETAPES DU CYCLE =======================
+typedef enum {
+    ETAPE_IDLE = 0,
+    ETAPE_EXTRACTION_AIR,           // 1: 3s
+    ETAPE_ARRET_AIR,                // 2: 2s
+    ETAPE_INJECTION_PRODUIT,        // 3: 2s
+    ETAPE_PAUSE_STERILISATION,      // 4: 20s (20min en réel)
+    ETAPE_EXTRACTION_PRODUIT,       // 5: 3s
+    ETAPE_RENOUVELLEMENT_AIR,       // 6: 3s
+    ETAPE_AUTORISATION_STERILE,     // 7: Déverrouillage porte stérile
+    ETAPE_TERMINE,                  // 8: Fin
+    ETAPE_NB
+} etape_cycle_t;
+
+// ======================= REFUS DE COMMANDE =======================
+typedef enum {
+    REFUS_AUCUN = 0,
+    REFUS_URGENCE,                  // urgence active
+    REFUS_PORTES_OUVERTES,          // démarrage avec une porte ouverte
+    REFUS_INTERVERROUILLAGE,        // l'autre porte est ouverte
+    REFUS_CYCLE_EN_COURS,           // ouverture ou départ pendant le cycle
+    REFUS_AUCUN_CYCLE,              // arrêt sans cycle en cours
+    REFUS_COMMANDE_INVALIDE,        // valeur de commande non reconnue
+} refus_t;
+
+// Motif publié dans les nack MQTT (reponse) et les 409 de l'API HTTP
+static inline const char *refus_nom(refus_t refus)
+{
+    static const char *const noms[] = {
+        [REFUS_AUCUN]               = "",
+        [REFUS_URGENCE]             = "urgence",
+        [REFUS_PORTES_OUVERTES]     = "portes_ouvertes",
+        [REFUS_INTERVERROUILLAGE]   = "interverrouillage",
+        [REFUS_CYCLE_EN_COURS]      = "cycle_en_cours",
+        [REFUS_AUCUN_CYCLE]         = "aucun_cycle",
+        [REFUS_COMMANDE_INVALIDE]   = "commande_invalide",
+    };
+    return (unsigned)refus < sizeof(noms) / sizeof(noms[0]) ? noms[refus] : "";
+}
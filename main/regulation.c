@@ -0,0 +1,161 @@
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "actionneurs.h"
+#include "capteurs.h"
+#include "regulation.h"
+
+#if CONFIG_PASSBOX_CAPTEURS
+
+static const char *TAG = "Regulation";
+
+// ======================= PARAMETRES =======================
+#define PERIODE_US          10000                   // 100 Hz
+#define PERIODES_PAR_S      (1000000 / PERIODE_US)
+#define SORTIE_MAX          1000                    // ‰
+#define INTEGRALE_Q         16
+
+// Gains en ‰ de vitesse : par Pa d'erreur, par Pa·s, par Pa/s
+#define KP                  CONFIG_PASSBOX_PID_KP
+#define KI                  CONFIG_PASSBOX_PID_KI
+#define KD                  CONFIG_PASSBOX_PID_KD
+
+// ======================= ETAT =======================
+// Écrit par le callback esp_timer et par demarrer/arreter : le callback
+// travaille sur une copie et ne la publie que si la boucle n'a pas été
+// relancée ou arrêtée entre-temps (génération inchangée).
+static esp_timer_handle_t timer = NULL;
+static portMUX_TYPE regulation_mux = portMUX_INITIALIZER_UNLOCKED;
+static regulation_etat_t etat = { 0 };
+static uint32_t generation = 0;
+static int64_t integrale_q16 = 0;
+static int32_t mesure_precedente = 0;
+static bool premiere_mesure = true;
+
+// ======================= PID =======================
+static void regulation_tick(void *arg)
+{
+    portENTER_CRITICAL(&regulation_mux);
+    bool active = etat.active;
+    uint32_t gen = generation;
+    int32_t consigne = etat.consigne_pa;
+    int64_t integrale = integrale_q16;
+    int32_t precedente = mesure_precedente;
+    bool premiere = premiere_mesure;
+    portEXIT_CRITICAL(&regulation_mux);
+    if (!active) return;
+
+    mesures_t m;
+    if (!capteurs_lire_sans_attente(&m) || (m.defauts & MESURE_BIT(MESURE_PRESSION))) {
+        // Pas de mesure : sortie maintenue, l'étape sur mesure finit en délai dépassé
+        portENTER_CRITICAL(&regulation_mux);
+        if (gen == generation) etat.mesures_manquees++;
+        portEXIT_CRITICAL(&regulation_mux);
+        return;
+    }
+
+    // Extracteur : plus il tourne, plus la pression baisse. Erreur positive
+    // = pression au-dessus de la consigne = accélérer.
+    int32_t mesure = m.valeur[MESURE_PRESSION];
+    int32_t erreur = mesure - consigne;
+
+    // Dérivée sur la mesure (pas de coup de bélier au changement de consigne)
+    int32_t derivee = premiere ? 0 : (mesure - precedente) * PERIODES_PAR_S;
+
+    int64_t sortie = (int64_t)KP * erreur + (integrale >> INTEGRALE_Q) + (int64_t)KD * derivee;
+
+    // Intégration conditionnelle, intégrale bornée à la plage de sortie
+    bool sature_haut = sortie >= SORTIE_MAX && erreur > 0;
+    bool sature_bas = sortie <= 0 && erreur < 0;
+    if (!sature_haut && !sature_bas) {
+        integrale += (int64_t)KI * erreur * (1 << INTEGRALE_Q) / PERIODES_PAR_S;   // erreur signée : multiplier, pas décaler
+        if (integrale < 0) integrale = 0;
+        if (integrale > ((int64_t)SORTIE_MAX << INTEGRALE_Q)) integrale = (int64_t)SORTIE_MAX << INTEGRALE_Q;
+    }
+
+    if (sortie < 0) sortie = 0;
+    if (sortie > SORTIE_MAX) sortie = SORTIE_MAX;
+
+    portENTER_CRITICAL(&regulation_mux);
+    bool a_jour = gen == generation;
+    if (a_jour) {
+        integrale_q16 = integrale;
+        mesure_precedente = mesure;
+        premiere_mesure = false;
+        etat.mesure_pa = mesure;
+        etat.sortie_pm = (uint16_t)sortie;
+    }
+    portEXIT_CRITICAL(&regulation_mux);
+
+    // Une vitesse calculée juste avant un arrêt peut encore être écrite :
+    // sans effet si l'étape suivante coupe le relais de l'extracteur
+    if (a_jour) actionneurs_regler_vitesse((uint16_t)sortie);
+}
+
+// ======================= API =======================
+void regulation_demarrer(int32_t consigne_pa)
+{
+    portENTER_CRITICAL(&regulation_mux);
+    generation++;
+    integrale_q16 = 0;
+    premiere_mesure = true;
+    etat = (regulation_etat_t){ .active = true, .consigne_pa = consigne_pa, .sortie_pm = SORTIE_MAX };
+    portEXIT_CRITICAL(&regulation_mux);
+
+    if (!esp_timer_is_active(timer)) esp_timer_start_periodic(timer, PERIODE_US);
+    ESP_LOGI(TAG, "Consigne %ld Pa", (long)consigne_pa);
+}
+
+void regulation_arreter(void)
+{
+    portENTER_CRITICAL(&regulation_mux);
+    generation++;
+    etat.active = false;
+    portEXIT_CRITICAL(&regulation_mux);
+
+    if (esp_timer_is_active(timer)) esp_timer_stop(timer);
+}
+
+void regulation_lire(regulation_etat_t *e)
+{
+    portENTER_CRITICAL(&regulation_mux);
+    *e = etat;
+    portEXIT_CRITICAL(&regulation_mux);
+}
+
+esp_err_t regulation_init(void)
+{
+    esp_timer_create_args_t args = {
+        .callback = regulation_tick,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "regulation",
+        .skip_unhandled_events = true,
+    };
+    return esp_timer_create(&args, &timer);
+}
+
+#else
+
+esp_err_t regulation_init(void)
+{
+    return ESP_OK;
+}
+
+void regulation_demarrer(int32_t consigne_pa)
+{
+    (void)consigne_pa;
+}
+
+void regulation_arreter(void)
+{
+}
+
+void regulation_lire(regulation_etat_t *e)
+{
+    *e = (regulation_etat_t){ 0 };
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// ======================= REGULATION DE L'EXTRACTEUR =======================
+// Boucle PID à 100 Hz (esp_timer) sur la pression différentielle de
+// l'enceinte : la vitesse PWM de l'extracteur est recalculée toutes les
+// 10 ms pour tenir la consigne de l'étape. Calcul en virgule fixe (‰ de
+// vitesse, intégrale en Q16), anti-emballement par intégration
+// conditionnelle : l'intégrale ne croît pas quand la sortie est saturée
+// dans le sens de l'erreur.
+
+typedef struct {
+    bool active;
+    int32_t consigne_pa;
+    int32_t mesure_pa;
+    uint16_t sortie_pm;             // vitesse commandée, ‰
+    uint32_t mesures_manquees;      // périodes sans mesure récente (sortie maintenue)
+} regulation_etat_t;
+
+esp_err_t regulation_init(void);
+
+// Démarre (ou relance) la boucle sur une nouvelle consigne, intégrale remise à zéro
+void regulation_demarrer(int32_t consigne_pa);
+void regulation_arreter(void);
+
+void regulation_lire(regulation_etat_t *etat);
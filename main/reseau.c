@@ -0,0 +1,283 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#include "reseau.h"
+
+static const char *TAG = "Reseau";
+
+// ======================= PARAMETRES =======================
+#define RESEAU_NVS_NAMESPACE    "passbox"
+#define RESEAU_NVS_CLE          "wifi_cache"
+#define CACHE_VERSION           1
+
+#define BACKOFF_MIN_MS          100
+#define BACKOFF_MAX_MS          CONFIG_PASSBOX_WIFI_BACKOFF_MAX_MS
+// Tentatives sur le point d'accès en cache avant un balayage complet
+// (point d'accès remplacé, déplacé sur un autre canal)
+#define ECHECS_AVANT_BALAYAGE   2
+
+#define BIT_IP                  BIT0
+
+// ======================= CACHE NVS =======================
+// Adresses en ordre réseau (esp_ip4_addr_t.addr)
+typedef struct {
+    uint8_t version;
+    uint8_t canal;
+    uint8_t bssid[6];
+    char ssid[33];
+    uint32_t ip;
+    uint32_t masque;
+    uint32_t passerelle;
+    uint32_t dns;
+} cache_t;
+
+// ======================= ETAT =======================
+// Modifié uniquement par la tâche des événements ; le timer de backoff ne
+// fait qu'appeler esp_wifi_connect()
+static reseau_config_t config;
+static esp_netif_t *netif = NULL;
+static EventGroupHandle_t evenements = NULL;
+static esp_timer_handle_t timer_backoff = NULL;
+
+static cache_t cache;
+static bool cache_valide = false;
+static bool cache_vise = false;     // la configuration en place vise le point d'accès en cache
+static bool connecte = false;
+static uint32_t echecs = 0;         // tentatives échouées depuis la coupure
+static int64_t debut_us = 0;        // coupure ou démarrage
+
+static portMUX_TYPE diag_mux = portMUX_INITIALIZER_UNLOCKED;
+static reseau_diag_t diag = { 0 };
+
+static void cache_charger(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(RESEAU_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return;
+    size_t taille = sizeof(cache);
+    esp_err_t err = nvs_get_blob(h, RESEAU_NVS_CLE, &cache, &taille);
+    nvs_close(h);
+
+    // Cache d'un autre réseau (SSID changé) : ignoré, écrasé à la connexion
+    cache_valide = err == ESP_OK && taille == sizeof(cache) && cache.version == CACHE_VERSION &&
+                   strncmp(cache.ssid, config.ssid, sizeof(cache.ssid)) == 0;
+}
+
+// Écrit seulement si le point d'accès ou le bail ont changé (usure flash)
+static void cache_sauver(const esp_netif_ip_info_t *ip)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return;
+
+    // Octets de bourrage à zéro : le cache est comparé par memcmp
+    cache_t nouveau;
+    memset(&nouveau, 0, sizeof(nouveau));
+    nouveau.version = CACHE_VERSION;
+    nouveau.canal = ap.primary;
+    nouveau.ip = ip->ip.addr;
+    nouveau.masque = ip->netmask.addr;
+    nouveau.passerelle = ip->gw.addr;
+    memcpy(nouveau.bssid, ap.bssid, sizeof(nouveau.bssid));
+    strncpy(nouveau.ssid, config.ssid, sizeof(nouveau.ssid) - 1);
+    esp_netif_dns_info_t dns;
+    if (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) nouveau.dns = dns.ip.u_addr.ip4.addr;
+
+    if (cache_valide && memcmp(&nouveau, &cache, sizeof(cache)) == 0) return;
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(RESEAU_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(h, RESEAU_NVS_CLE, &nouveau, sizeof(nouveau));
+        if (err == ESP_OK) err = nvs_commit(h);
+        nvs_close(h);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Sauvegarde du cache: %s", esp_err_to_name(err));
+        return;
+    }
+    cache = nouveau;
+    cache_valide = true;
+}
+
+// ======================= CONFIGURATION STATION =======================
+// viser : point d'accès et canal du cache, sinon balayage de tous les canaux
+static void configurer(bool viser)
+{
+    wifi_config_t sta = { 0 };
+    strncpy((char *)sta.sta.ssid, config.ssid, sizeof(sta.sta.ssid));
+    strncpy((char *)sta.sta.password, config.mot_de_passe, sizeof(sta.sta.password));
+    sta.sta.scan_method = WIFI_FAST_SCAN;
+
+    viser = viser && cache_valide;
+    if (viser) {
+        sta.sta.bssid_set = true;
+        memcpy(sta.sta.bssid, cache.bssid, sizeof(sta.sta.bssid));
+        sta.sta.channel = cache.canal;
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &sta);
+
+#if CONFIG_PASSBOX_WIFI_IP_CACHE
+    // Bail en cache repris tel quel sur le même point d'accès, DHCP sinon
+    if (viser) {
+        esp_netif_dhcpc_stop(netif);
+        esp_netif_ip_info_t ip = {
+            .ip.addr = cache.ip,
+            .netmask.addr = cache.masque,
+            .gw.addr = cache.passerelle,
+        };
+        esp_netif_set_ip_info(netif, &ip);
+        if (cache.dns) {
+            esp_netif_dns_info_t dns = { .ip.type = ESP_IPADDR_TYPE_V4, .ip.u_addr.ip4.addr = cache.dns };
+            esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+        }
+    } else {
+        esp_netif_dhcpc_start(netif);
+    }
+#endif
+
+    cache_vise = viser;
+}
+
+// Délai avant la tentative n (n >= 1) : 100 ms, 200 ms... jusqu'au maximum,
+// tiré entre la moitié et la totalité pour désynchroniser les postes
+static uint32_t backoff_ms(uint32_t n)
+{
+    uint32_t d = BACKOFF_MAX_MS;
+    if (n - 1 < 16 && (BACKOFF_MIN_MS << (n - 1)) < BACKOFF_MAX_MS) d = BACKOFF_MIN_MS << (n - 1);
+    return d / 2 + esp_random() % (d / 2 + 1);
+}
+
+static void reconnecter(void *arg)
+{
+    esp_wifi_connect();
+}
+
+// ======================= EVENEMENTS =======================
+static void sur_deconnexion(const wifi_event_sta_disconnected_t *d)
+{
+    xEventGroupClearBits(evenements, BIT_IP);
+
+    if (connecte) {
+        // Coupure : nouvelle tentative immédiate sur le point d'accès connu
+        connecte = false;
+        echecs = 0;
+        debut_us = esp_timer_get_time();
+        portENTER_CRITICAL(&diag_mux);
+        diag.coupure_us = debut_us;
+        portEXIT_CRITICAL(&diag_mux);
+        ESP_LOGW(TAG, "WiFi déconnecté (raison %u), reconnexion...", d->reason);
+        if (!cache_vise) configurer(true);
+        esp_wifi_connect();
+        return;
+    }
+
+    echecs++;
+    if (cache_vise && echecs >= ECHECS_AVANT_BALAYAGE) {
+        ESP_LOGW(TAG, "Point d'accès en cache injoignable, balayage complet");
+        configurer(false);
+    }
+    uint32_t delai = backoff_ms(echecs);
+    ESP_LOGW(TAG, "Tentative %lu échouée (raison %u), suivante dans %lu ms",
+             (unsigned long)echecs, d->reason, (unsigned long)delai);
+    esp_timer_start_once(timer_backoff, (uint64_t)delai * 1000);
+}
+
+static void sur_ip(const ip_event_got_ip_t *e)
+{
+    uint32_t duree_ms = (uint32_t)((esp_timer_get_time() - debut_us) / 1000);
+    bool vise = cache_vise;
+    connecte = true;
+
+    portENTER_CRITICAL(&diag_mux);
+    diag.connexions++;
+    diag.derniere_ms = duree_ms;
+    if (duree_ms > diag.pire_ms) diag.pire_ms = duree_ms;
+    diag.tentatives = echecs + 1;
+    diag.cache = vise;
+    portEXIT_CRITICAL(&diag_mux);
+
+    ESP_LOGI(TAG, "IP obtenue: " IPSTR " en %lu ms (%lu tentative(s), %s)", IP2STR(&e->ip_info.ip),
+             (unsigned long)duree_ms, (unsigned long)echecs + 1, vise ? "point d'accès en cache" : "balayage");
+
+    cache_sauver(&e->ip_info);
+    xEventGroupSetBits(evenements, BIT_IP);
+    if (config.ip_obtenue) config.ip_obtenue();
+}
+
+static void reseau_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        debut_us = esp_timer_get_time();
+        esp_wifi_connect();
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        sur_deconnexion(data);
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        sur_ip(data);
+    }
+}
+
+// ======================= API =======================
+bool reseau_attendre(TickType_t delai)
+{
+    return xEventGroupWaitBits(evenements, BIT_IP, pdFALSE, pdTRUE, delai) & BIT_IP;
+}
+
+void reseau_diagnostic(reseau_diag_t *d)
+{
+    portENTER_CRITICAL(&diag_mux);
+    *d = diag;
+    portEXIT_CRITICAL(&diag_mux);
+}
+
+esp_err_t reseau_init(const reseau_config_t *cfg)
+{
+    config = *cfg;
+    evenements = xEventGroupCreate();
+    if (!evenements) return ESP_ERR_NO_MEM;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = reconnecter,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "wifi_backoff",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &timer_backoff);
+    if (err != ESP_OK) return err;
+
+    netif = esp_netif_create_default_wifi_sta();
+    wifi_init_config_t wifi_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    err = esp_wifi_init(&wifi_cfg);
+    if (err != ESP_OK) return err;
+
+    err = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, reseau_event_handler, NULL);
+    if (err == ESP_OK) err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, reseau_event_handler, NULL);
+    if (err != ESP_OK) return err;
+
+    // Le pilote n'a pas à réécrire sa configuration en flash : le cache s'en charge
+    esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    err = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (err != ESP_OK) return err;
+#if CONFIG_PASSBOX_VEILLE
+    // Veille modem : association gardée, radio réveillée à chaque balise DTIM
+    err = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    if (err != ESP_OK) return err;
+#endif
+
+    cache_charger();
+    configurer(true);
+    if (cache_valide) {
+        ESP_LOGI(TAG, "Point d'accès en cache: %02x:%02x:%02x:%02x:%02x:%02x, canal %u",
+                 cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4],
+                 cache.bssid[5], cache.canal);
+    }
+    return esp_wifi_start();
+}
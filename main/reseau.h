@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+// ======================= RESEAU WIFI =======================
+// Station Wi-Fi à reconnexion rapide. Le dernier point d'accès (BSSID,
+// canal) et le dernier bail IP sont gardés en NVS : la connexion suivante
+// vise directement ce point d'accès sur son canal au lieu de balayer tous
+// les canaux, et l'adresse est redemandée au serveur DHCP ou reprise telle
+// quelle (Kconfig). Les tentatives échouées s'espacent (backoff exponentiel
+// avec gigue) pour ne pas occuper le canal quand le point d'accès est absent.
+
+typedef struct {
+    const char *ssid;
+    const char *mot_de_passe;
+    void (*ip_obtenue)(void);       // tâche des événements, après chaque (re)connexion
+} reseau_config_t;
+
+typedef struct {
+    uint32_t connexions;
+    uint32_t derniere_ms;           // début de la coupure (ou démarrage) -> IP obtenue
+    uint32_t pire_ms;
+    uint32_t tentatives;            // de la dernière connexion
+    bool cache;                     // dernière connexion sur le point d'accès en cache
+    int64_t coupure_us;             // esp_timer, début de la dernière coupure (0 : aucune)
+} reseau_diag_t;
+
+// Crée l'interface station et lance la connexion (esp_netif et boucle
+// d'événements par défaut déjà initialisés)
+esp_err_t reseau_init(const reseau_config_t *cfg);
+
+bool reseau_attendre(TickType_t delai);
+
+void reseau_diagnostic(reseau_diag_t *diag);
@@ -0,0 +1,366 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "driver/gpio.h"
+#include "esp_clk_tree.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "hal/gpio_ll.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+
+#include "passbox.h"
+#include "actionneurs.h"
+#include "energie.h"
+#include "securite.h"
+
+static const char *TAG = "Securite";
+
+// ======================= BROCHES =======================
+#define GPIO_PORTE_STERILE      CONFIG_PASSBOX_GPIO_CAPTEUR_STERILE
+#define GPIO_PORTE_CONTAMINEE   CONFIG_PASSBOX_GPIO_CAPTEUR_CONTAMINEE
+
+#if CONFIG_PASSBOX_CAPTEUR_OUVERT_HAUT
+#define NIVEAU_OUVERT   1           // contact fermé à la masse porte fermée, pull-up
+#else
+#define NIVEAU_OUVERT   0
+#endif
+
+// Lecture directe du registre d'entrée : utilisable en ISR depuis l'IRAM
+#if SOC_GPIO_PIN_COUNT > 32
+#define NIVEAU(g)       ((REG_READ((g) < 32 ? GPIO_IN_REG : GPIO_IN1_REG) >> ((g) % 32)) & 1)
+#else
+#define NIVEAU(g)       ((REG_READ(GPIO_IN_REG) >> (g)) & 1)
+#endif
+
+#define PORTE_BIT(p)            (1u << (p))
+#define TOUTES_PORTES           (PORTE_BIT(PORTE_NB) - 1)
+
+#define ANTI_REBOND_MS          20
+#define ANTI_REBOND_ARRET_US    (300 * 1000)
+#define PERIODE_CONTROLE_MS     50
+#define PERIODE_REPOS_MS        1000    // aucune sortie commandée : pas de verrou à surveiller
+
+// Notifications ISR -> tâche
+#define NOTIF_PORTES            (1u << 0)
+#define NOTIF_COUPURE           (1u << 1)
+#define NOTIF_REARMEMENT        (1u << 2)
+#define NOTIF_CONTROLE          (1u << 3)
+
+// ======================= ETAT =======================
+// Tout ce que lit l'ISR est en DRAM (variables non constantes)
+static securite_config_t config;
+static gpio_num_t gpio_arret = GPIO_NUM_NC;
+static TaskHandle_t tache = NULL;
+static portMUX_TYPE securite_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile bool urgence = false;
+static volatile coupure_t cause_coupure = COUPURE_ARRET;
+static int64_t dernier_arret_us = 0;
+static uint8_t portes_stables = 0;                 // PORTE_BIT() après anti-rebond
+
+static uint32_t nb_coupures = 0;
+static uint32_t derniere_cycles = 0;
+static uint32_t pire_cycles = 0;
+static bool derniere_confirmee = true;
+
+static esp_err_t isr_err = ESP_OK;
+static int coeur_isr = 0;
+
+#if CONFIG_PASSBOX_BENCH
+// Coupure simulée : instants (cycles CPU du cœur de l'ISR) de la fin de la
+// coupure et du réveil de la tâche, sans diagnostic ni callbacks
+static volatile bool bench_actif = false;
+static volatile uint32_t bench_coupure = 0;
+static volatile uint32_t bench_tache = 0;
+#endif
+
+// ======================= REGLES D'INTER-VERROUILLAGE =======================
+static uint8_t IRAM_ATTR portes_ouvertes(void)
+{
+    uint8_t ouvertes = 0;
+    if (NIVEAU(GPIO_PORTE_STERILE) == NIVEAU_OUVERT) ouvertes |= PORTE_BIT(PORTE_STERILE);
+    if (NIVEAU(GPIO_PORTE_CONTAMINEE) == NIVEAU_OUVERT) ouvertes |= PORTE_BIT(PORTE_CONTAMINEE);
+    return ouvertes;
+}
+
+// Les verrous commandés reflètent déjà l'état du cycle (étapes, autorisation
+// de la porte stérile, porte opposée ouverte) : une porte qui s'ouvre sous
+// un verrou commandé a été forcée ou son verrou est défaillant.
+static bool IRAM_ATTR violation(uint8_t ouvertes, coupure_t *cause)
+{
+    if (ouvertes == TOUTES_PORTES) {
+        *cause = COUPURE_INTERVERROUILLAGE;
+        return true;
+    }
+    uint8_t verrous = actionneurs_sorties_commandees();
+    if (((ouvertes & PORTE_BIT(PORTE_STERILE)) && (verrous & SORTIE_BIT(SORTIE_VERROU_STERILE))) ||
+        ((ouvertes & PORTE_BIT(PORTE_CONTAMINEE)) && (verrous & SORTIE_BIT(SORTIE_VERROU_CONTAMINEE)))) {
+        *cause = COUPURE_PORTE_FORCEE;
+        return true;
+    }
+    return false;
+}
+
+// Coupe les sorties si l'urgence n'est pas déjà active. La durée est comptée
+// en cycles CPU depuis `debut` (entrée dans l'ISR) jusqu'à la relecture des
+// broches coupées ; NULL : depuis l'entrée en section critique (tâche).
+static bool IRAM_ATTR couper(coupure_t cause, const uint32_t *debut)
+{
+    bool coupe = false;
+
+    portENTER_CRITICAL_SAFE(&securite_mux);
+    uint32_t t0 = debut ? *debut : esp_cpu_get_cycle_count();
+    if (!urgence) {
+        bool confirmee = actionneurs_couper();
+        uint32_t fin = esp_cpu_get_cycle_count();
+        uint32_t cycles = fin - t0;
+
+        urgence = true;
+        cause_coupure = cause;
+        coupe = true;
+        bool compter = true;
+#if CONFIG_PASSBOX_BENCH
+        if (bench_actif) bench_coupure = fin;
+        compter = !bench_actif;
+#endif
+        if (compter) {
+            nb_coupures++;
+            derniere_cycles = cycles;
+            if (cycles > pire_cycles) pire_cycles = cycles;
+            derniere_confirmee = confirmee;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&securite_mux);
+
+    return coupe;
+}
+
+// ======================= ISR =======================
+// Interruptions sur niveau, réarmées sur le niveau inverse de celui lu : un
+// déclenchement par changement, comme sur front, mais un niveau réveille du
+// sommeil léger. Réarmement après la coupure ; un changement survenu entre
+// la lecture et le réarmement redéclenche aussitôt.
+static inline void IRAM_ATTR armer_inverse(gpio_num_t gpio, int niveau)
+{
+    gpio_ll_set_intr_type(&GPIO, gpio, niveau ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+}
+
+static void IRAM_ATTR securite_isr(void *arg)
+{
+    uint32_t debut = esp_cpu_get_cycle_count();
+    gpio_num_t gpio = (gpio_num_t)(intptr_t)arg;
+    int niveau = NIVEAU(gpio);
+    uint32_t notif;
+
+    if (gpio == gpio_arret) {
+        // Appui (niveau bas) : ignore les rebonds et le relâchement
+        int64_t maintenant = esp_timer_get_time();
+        if (niveau != 0 || maintenant - dernier_arret_us < ANTI_REBOND_ARRET_US) {
+            armer_inverse(gpio, niveau);
+            return;
+        }
+        dernier_arret_us = maintenant;
+        notif = couper(COUPURE_ARRET, &debut) ? NOTIF_COUPURE : NOTIF_REARMEMENT;
+    } else {
+        // Aucun anti-rebond ici : le premier front d'ouverture suffit à couper
+        coupure_t cause;
+        notif = NOTIF_PORTES;
+        if (violation(portes_ouvertes(), &cause) && couper(cause, &debut)) notif |= NOTIF_COUPURE;
+    }
+    armer_inverse(gpio, niveau);
+
+    BaseType_t reveil = pdFALSE;
+    xTaskNotifyFromISR(tache, notif, eSetBits, &reveil);
+    portYIELD_FROM_ISR(reveil);
+}
+
+// ======================= TACHE =======================
+static uint32_t cycles_vers_ns(uint32_t cycles)
+{
+    uint32_t hz = 0;
+    esp_clk_tree_src_get_freq_hz(SOC_MOD_CLK_CPU, ESP_CLK_TREE_SRC_FREQ_PRECISION_CACHED, &hz);
+    return hz ? (uint32_t)((uint64_t)cycles * 1000000000ULL / hz) : 0;
+}
+
+static void signaler_coupure(void)
+{
+    securite_diag_t diag;
+    securite_diagnostic(&diag);
+    ESP_LOGW(TAG, "Sorties coupées (cause %d) en %lu ns%s", (int)cause_coupure,
+             (unsigned long)diag.derniere_ns, diag.confirmee ? "" : ", relecture en défaut");
+    if (config.coupure) config.coupure(cause_coupure);
+}
+
+static void securite_task(void *arg)
+{
+    // Interruptions allouées sur le cœur qui installe le service : celui de
+    // cette tâche, à l'écart du Wi-Fi
+    coeur_isr = xPortGetCoreID();
+    isr_err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (isr_err == ESP_ERR_INVALID_STATE) isr_err = ESP_OK;
+    xTaskNotifyGive((TaskHandle_t)arg);
+
+    while (1) {
+        uint32_t notif = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &notif,
+                        pdMS_TO_TICKS(energie_au_repos() ? PERIODE_REPOS_MS : PERIODE_CONTROLE_MS));
+
+#if CONFIG_PASSBOX_BENCH
+        if (bench_actif && (notif & NOTIF_COUPURE)) {
+            bench_tache = esp_cpu_get_cycle_count();
+            notif &= ~NOTIF_COUPURE;
+        }
+#endif
+
+        if (notif & NOTIF_COUPURE) signaler_coupure();
+        if ((notif & NOTIF_REARMEMENT) && config.rearmement) config.rearmement();
+
+        // Changement de porte : état relu une fois les rebonds passés
+        if (notif & NOTIF_PORTES) vTaskDelay(pdMS_TO_TICKS(ANTI_REBOND_MS));
+        uint8_t ouvertes = portes_ouvertes();
+        uint8_t changees = ouvertes ^ portes_stables;
+        portes_stables = ouvertes;
+        for (int p = 0; p < PORTE_NB; p++) {
+            if ((changees & PORTE_BIT(p)) && config.porte) {
+                config.porte((porte_t)p, ouvertes & PORTE_BIT(p));
+            }
+        }
+
+        // Contrôle périodique ou sur nouvelles commandes : règle violée sans
+        // front sur un capteur (verrou commandé alors que la porte était
+        // déjà ouverte)
+        coupure_t cause;
+        if (violation(ouvertes, &cause) && couper(cause, NULL)) signaler_coupure();
+    }
+}
+
+// ======================= API =======================
+void securite_urgence(bool active)
+{
+    portENTER_CRITICAL(&securite_mux);
+    urgence = active;
+    portEXIT_CRITICAL(&securite_mux);
+
+    // Fin d'urgence : les sorties suivent de nouveau les commandes
+    if (!active) actionneurs_rearmer();
+}
+
+void securite_controler(void)
+{
+    if (tache) xTaskNotify(tache, NOTIF_CONTROLE, eSetBits);
+}
+
+bool securite_porte_ouverte(porte_t porte)
+{
+    return portes_stables & PORTE_BIT(porte);
+}
+
+void securite_diagnostic(securite_diag_t *diag)
+{
+    portENTER_CRITICAL(&securite_mux);
+    uint32_t derniere = derniere_cycles, pire = pire_cycles;
+    diag->nb = nb_coupures;
+    diag->confirmee = derniere_confirmee;
+    portEXIT_CRITICAL(&securite_mux);
+
+    diag->derniere_ns = cycles_vers_ns(derniere);
+    diag->pire_ns = cycles_vers_ns(pire);
+}
+
+// ======================= INIT =======================
+esp_err_t securite_init(const securite_config_t *cfg)
+{
+    config = *cfg;
+    gpio_arret = cfg->gpio_arret;
+
+    gpio_config_t portes_cfg = {
+        .pin_bit_mask = (1ULL << GPIO_PORTE_STERILE) | (1ULL << GPIO_PORTE_CONTAMINEE),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t err = gpio_config(&portes_cfg);
+    if (err != ESP_OK) return err;
+
+    gpio_config_t arret_cfg = {
+        .pin_bit_mask = 1ULL << gpio_arret,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    err = gpio_config(&arret_cfg);
+    if (err != ESP_OK) return err;
+
+    portes_stables = portes_ouvertes();
+    // ISR en IRAM (servie même pendant une écriture flash), installée par la
+    // tâche sur le cœur de sécurité
+    if (xTaskCreatePinnedToCore(securite_task, "securite_task", 3072, xTaskGetCurrentTaskHandle(),
+                                PASSBOX_PRIO_SECURITE, &tache, PASSBOX_COEUR_SECURITE) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (isr_err != ESP_OK) return isr_err;
+
+    // Premier niveau armé : l'inverse de l'état actuel (bouton d'arrêt tenu
+    // au démarrage : pas de coupure avant un nouvel appui)
+    const gpio_num_t entrees[] = { GPIO_PORTE_STERILE, GPIO_PORTE_CONTAMINEE, gpio_arret };
+    for (int i = 0; i < sizeof(entrees) / sizeof(entrees[0]); i++) {
+        gpio_int_type_t attendu = NIVEAU(entrees[i]) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+        err = gpio_isr_handler_add(entrees[i], securite_isr, (void *)(intptr_t)entrees[i]);
+        if (err == ESP_OK) err = gpio_set_intr_type(entrees[i], attendu);
+#if CONFIG_PASSBOX_VEILLE
+        if (err == ESP_OK) err = gpio_wakeup_enable(entrees[i], attendu);
+#endif
+        if (err == ESP_OK) err = gpio_intr_enable(entrees[i]);
+        if (err != ESP_OK) return err;
+    }
+
+    ESP_LOGI(TAG, "Portes sur GPIO %d/%d (stérile %s, contaminée %s), arrêt sur GPIO %d, ISR sur le cœur %d",
+             GPIO_PORTE_STERILE, GPIO_PORTE_CONTAMINEE,
+             securite_porte_ouverte(PORTE_STERILE) ? "ouverte" : "fermée",
+             securite_porte_ouverte(PORTE_CONTAMINEE) ? "ouverte" : "fermée", gpio_arret, coeur_isr);
+    return ESP_OK;
+}
+
+int securite_coeur_isr(void)
+{
+    return coeur_isr;
+}
+
+#if CONFIG_PASSBOX_BENCH
+// ======================= BANC DE MESURE =======================
+// Front descendant produit sur la broche d'arrêt elle-même (entrée-sortie le
+// temps de la mesure) : même chemin que l'appui, ISR et tâche comprises.
+esp_err_t securite_bench_arret(uint32_t *coupure_cycles, uint32_t *tache_cycles)
+{
+    if (urgence) return ESP_ERR_INVALID_STATE;
+    if (xPortGetCoreID() != coeur_isr) return ESP_ERR_INVALID_STATE;
+
+    bench_coupure = bench_tache = 0;
+    bench_actif = true;
+    dernier_arret_us = 0;
+    gpio_set_direction(gpio_arret, GPIO_MODE_INPUT_OUTPUT);
+    gpio_set_level(gpio_arret, 1);
+
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    gpio_set_level(gpio_arret, 0);
+    // ISR puis tâche (plus prioritaire que l'appelant) avant le retour ici ;
+    // attente bornée si l'appelant est plus prioritaire
+    for (int i = 0; i < 10 && !bench_tache; i++) vTaskDelay(1);
+
+    gpio_set_level(gpio_arret, 1);
+    gpio_set_direction(gpio_arret, GPIO_MODE_INPUT);
+    bench_actif = false;
+    securite_urgence(false);
+
+    if (!bench_coupure || !bench_tache) return ESP_ERR_TIMEOUT;
+    *coupure_cycles = bench_coupure - t0;
+    *tache_cycles = bench_tache - t0;
+    return ESP_OK;
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+
+// ======================= ENTREES DE SECURITE =======================
+// Capteurs de position des portes et bouton d'arrêt d'urgence, traités en
+// interruption (ISR en IRAM). Les règles d'inter-verrouillage sont évaluées
+// dans l'ISR elle-même : sur violation, les sorties sont coupées directement
+// par actionneurs_couper(), sans attendre l'ordonnanceur. Une tâche termine
+// ensuite le traitement (anti-rebond des portes, passage en urgence, LCD,
+// MQTT) via les callbacks.
+
+typedef enum {
+    PORTE_STERILE = 0,
+    PORTE_CONTAMINEE,
+    PORTE_NB
+} porte_t;
+
+typedef enum {
+    COUPURE_ARRET = 0,              // bouton d'arrêt d'urgence
+    COUPURE_INTERVERROUILLAGE,      // les deux portes ouvertes
+    COUPURE_PORTE_FORCEE,           // porte ouverte alors que son verrou est commandé
+} coupure_t;
+
+typedef struct {
+    uint32_t nb;                    // coupures depuis le démarrage
+    uint32_t derniere_ns;
+    uint32_t pire_ns;               // de l'entrée dans l'ISR à la relecture des broches coupées
+    bool confirmee;                 // dernière coupure relue sur toutes les broches
+} securite_diag_t;
+
+typedef struct {
+    gpio_num_t gpio_arret;          // bouton d'arrêt d'urgence (actif bas, pull-up)
+    // Callbacks appelés depuis la tâche de sécurité
+    void (*porte)(porte_t porte, bool ouverte);     // changement confirmé (anti-rebond)
+    void (*coupure)(coupure_t cause);               // sorties déjà coupées par l'ISR
+    void (*rearmement)(void);                       // appui sur l'arrêt pendant l'urgence
+} securite_config_t;
+
+esp_err_t securite_init(const securite_config_t *cfg);
+
+// État d'urgence tenu par l'application (urgence MQTT, défaut de sortie...) :
+// en urgence, aucune nouvelle coupure et l'arrêt devient un réarmement
+void securite_urgence(bool active);
+
+// Commandes des sorties modifiées : règles réévaluées sans attendre le
+// contrôle périodique (espacé au repos)
+void securite_controler(void);
+
+// État des portes après anti-rebond (pour l'initialisation de l'application)
+bool securite_porte_ouverte(porte_t porte);
+
+void securite_diagnostic(securite_diag_t *diag);
+
+// Cœur sur lequel l'ISR est servie
+int securite_coeur_isr(void);
+
+#if CONFIG_PASSBOX_BENCH
+// Banc : arrêt d'urgence simulé, appelé depuis le cœur de l'ISR par une
+// tâche moins prioritaire que la tâche de sécurité, hors urgence. Durées en
+// cycles CPU du front à la coupure des sorties et au réveil de la tâche.
+// Ni diagnostic, ni callbacks, ni journal.
+esp_err_t securite_bench_arret(uint32_t *coupure_cycles, uint32_t *tache_cycles);
+#endif
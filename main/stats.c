@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "stats.h"
+
+static const char *TAG = "Stats";
+
+#define STATS_NVS_NAMESPACE     "passbox"
+#define STATS_NVS_CLE           "stats"
+#define STATS_VERSION           2
+
+// ======================= BUCKETS HDR =======================
+// Valeurs < 8 ms : un bucket par ms. Au-delà : 8 sous-buckets par puissance
+// de 2 jusqu'à 2^24 ms (~4h40), les valeurs plus grandes saturent.
+#define STATS_SOUS_BUCKETS_BITS 3
+#define STATS_SOUS_BUCKETS      (1u << STATS_SOUS_BUCKETS_BITS)
+#define STATS_VALEUR_MAX_BITS   24
+#define STATS_NB_BUCKETS        (STATS_SOUS_BUCKETS * (STATS_VALEUR_MAX_BITS - STATS_SOUS_BUCKETS_BITS + 1))
+
+// Étapes mesurées : 1 (extraction air) à 7 (autorisation stérile)
+#define STATS_PREMIERE_ETAPE    ETAPE_EXTRACTION_AIR
+#define STATS_NB_ETAPES         (ETAPE_AUTORISATION_STERILE - ETAPE_EXTRACTION_AIR + 1)
+
+typedef struct {
+    uint32_t nb;
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint64_t somme_ms;
+    uint16_t buckets[STATS_NB_BUCKETS];     // compteurs saturants
+} stats_histo_t;
+
+typedef struct {
+    uint32_t version;
+    uint32_t cycles_termines;
+    uint32_t cycles_abandonnes;
+    uint32_t urgences;
+    uint32_t maintiens_conformes;
+    uint32_t maintiens_non_conformes;
+    uint32_t consigne_maintien_ms;      // durée, ou délai maximal de la dose
+    uint32_t maintien_dose;             // 1 : dernière conformité jugée sur la dose
+    stats_histo_t etapes[STATS_NB_ETAPES];
+    stats_histo_t cycle;
+} stats_t;
+
+static stats_t stats;
+static SemaphoreHandle_t stats_mutex = NULL;
+
+static uint32_t bucket_index(uint32_t v)
+{
+    if (v >= (1u << STATS_VALEUR_MAX_BITS)) {
+        v = (1u << STATS_VALEUR_MAX_BITS) - 1;
+    }
+    if (v < STATS_SOUS_BUCKETS) {
+        return v;
+    }
+    uint32_t decalage = (31 - __builtin_clz(v)) - STATS_SOUS_BUCKETS_BITS;
+    return STATS_SOUS_BUCKETS * (decalage + 1) + ((v >> decalage) - STATS_SOUS_BUCKETS);
+}
+
+static uint32_t bucket_borne_basse(uint32_t index)
+{
+    if (index < STATS_SOUS_BUCKETS) {
+        return index;
+    }
+    uint32_t decalage = index / STATS_SOUS_BUCKETS - 1;
+    return (STATS_SOUS_BUCKETS + index % STATS_SOUS_BUCKETS) << decalage;
+}
+
+static void histo_ajouter(stats_histo_t *h, uint32_t v)
+{
+    uint16_t *b = &h->buckets[bucket_index(v)];
+    if (*b != UINT16_MAX) (*b)++;
+
+    if (h->nb == 0 || v < h->min_ms) h->min_ms = v;
+    if (v > h->max_ms) h->max_ms = v;
+    h->somme_ms += v;
+    h->nb++;
+}
+
+// ======================= API =======================
+void stats_init(void)
+{
+    stats_mutex = xSemaphoreCreateMutex();
+    assert(stats_mutex != NULL);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.version = STATS_VERSION;
+
+    nvs_handle_t h;
+    if (nvs_open(STATS_NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        ESP_LOGI(TAG, "Aucune statistique en NVS");
+        return;
+    }
+    size_t taille = sizeof(stats);
+    esp_err_t err = nvs_get_blob(h, STATS_NVS_CLE, &stats, &taille);
+    nvs_close(h);
+
+    if (err != ESP_OK || taille != sizeof(stats) || stats.version != STATS_VERSION) {
+        ESP_LOGW(TAG, "Statistiques NVS absentes ou incompatibles, remise à zéro");
+        memset(&stats, 0, sizeof(stats));
+        stats.version = STATS_VERSION;
+        return;
+    }
+    ESP_LOGI(TAG, "Statistiques chargées: %lu cycles, %lu abandons, %lu urgences",
+             (unsigned long)stats.cycles_termines, (unsigned long)stats.cycles_abandonnes,
+             (unsigned long)stats.urgences);
+}
+
+void stats_etape_terminee(etape_cycle_t etape, uint32_t duree_ms, uint32_t consigne_ms)
+{
+    if (etape < STATS_PREMIERE_ETAPE || etape > ETAPE_AUTORISATION_STERILE) return;
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    histo_ajouter(&stats.etapes[etape - STATS_PREMIERE_ETAPE], duree_ms);
+    if (etape == ETAPE_PAUSE_STERILISATION && consigne_ms) {
+        stats.consigne_maintien_ms = consigne_ms;
+        stats.maintien_dose = 0;
+        if (duree_ms >= consigne_ms) {
+            stats.maintiens_conformes++;
+        } else {
+            stats.maintiens_non_conformes++;
+            ESP_LOGE(TAG, "Maintien NON CONFORME: %lu ms < %lu ms",
+                     (unsigned long)duree_ms, (unsigned long)consigne_ms);
+        }
+    }
+    xSemaphoreGive(stats_mutex);
+}
+
+void stats_maintien_dose(bool atteinte, uint32_t delai_max_ms)
+{
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.consigne_maintien_ms = delai_max_ms;
+    stats.maintien_dose = 1;
+    if (atteinte) {
+        stats.maintiens_conformes++;
+    } else {
+        stats.maintiens_non_conformes++;
+        ESP_LOGE(TAG, "Maintien NON CONFORME: dose non atteinte en %lu ms", (unsigned long)delai_max_ms);
+    }
+    xSemaphoreGive(stats_mutex);
+}
+
+void stats_cycle_termine(uint32_t duree_ms)
+{
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    histo_ajouter(&stats.cycle, duree_ms);
+    stats.cycles_termines++;
+    xSemaphoreGive(stats_mutex);
+}
+
+void stats_cycle_abandonne(void)
+{
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.cycles_abandonnes++;
+    xSemaphoreGive(stats_mutex);
+}
+
+void stats_urgence(void)
+{
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    stats.urgences++;
+    xSemaphoreGive(stats_mutex);
+}
+
+void stats_sauvegarder(void)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(STATS_NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open: %s", esp_err_to_name(err));
+        return;
+    }
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    err = nvs_set_blob(h, STATS_NVS_CLE, &stats, sizeof(stats));
+    xSemaphoreGive(stats_mutex);
+
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Sauvegarde NVS: %s", esp_err_to_name(err));
+    }
+}
+
+void stats_reinitialiser(void)
+{
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    memset(&stats, 0, sizeof(stats));
+    stats.version = STATS_VERSION;
+    xSemaphoreGive(stats_mutex);
+    stats_sauvegarder();
+}
+
+// ======================= JSON =======================
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+    bool deborde;
+} json_out_t;
+
+static void json_printf(json_out_t *o, const char *fmt, ...)
+{
+    if (o->deborde) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->pos, o->len - o->pos, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= o->len - o->pos) {
+        o->deborde = true;
+        return;
+    }
+    o->pos += n;
+}
+
+// {"n":..,"min":..,"max":..,"moy":..,"h":[[borne_ms,nb],...]}
+static void json_histo(json_out_t *o, const stats_histo_t *h)
+{
+    json_printf(o, "{\"n\":%lu,\"min\":%lu,\"max\":%lu,\"moy\":%lu,\"h\":[",
+                (unsigned long)h->nb, (unsigned long)h->min_ms, (unsigned long)h->max_ms,
+                (unsigned long)(h->nb ? h->somme_ms / h->nb : 0));
+    bool premier = true;
+    for (uint32_t i = 0; i < STATS_NB_BUCKETS; i++) {
+        if (h->buckets[i] == 0) continue;
+        json_printf(o, "%s[%lu,%u]", premier ? "" : ",",
+                    (unsigned long)bucket_borne_basse(i), h->buckets[i]);
+        premier = false;
+    }
+    json_printf(o, "]}");
+}
+
+size_t stats_json(char *buf, size_t len)
+{
+    json_out_t o = { .buf = buf, .len = len };
+
+    xSemaphoreTake(stats_mutex, portMAX_DELAY);
+    json_printf(&o, "{\"cycles\":{\"termines\":%lu,\"abandonnes\":%lu},\"urgences\":%lu,",
+                (unsigned long)stats.cycles_termines, (unsigned long)stats.cycles_abandonnes,
+                (unsigned long)stats.urgences);
+    json_printf(&o, "\"maintien\":{\"critere\":\"%s\",\"consigne_ms\":%lu,\"conformes\":%lu,\"non_conformes\":%lu},",
+                stats.maintien_dose ? "dose" : "duree", (unsigned long)stats.consigne_maintien_ms, (unsigned long)stats.maintiens_conformes,
+                (unsigned long)stats.maintiens_non_conformes);
+    json_printf(&o, "\"etapes\":{");
+    for (int i = 0; i < STATS_NB_ETAPES; i++) {
+        json_printf(&o, "%s\"%d\":", i ? "," : "", i + STATS_PREMIERE_ETAPE);
+        json_histo(&o, &stats.etapes[i]);
+    }
+    json_printf(&o, "},\"cycle\":");
+    json_histo(&o, &stats.cycle);
+    json_printf(&o, "}");
+    xSemaphoreGive(stats_mutex);
+
+    return o.deborde ? 0 : o.pos;
+}
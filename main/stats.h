@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "passbox.h"
+
+// ======================= STATISTIQUES DE CYCLE =======================
+// Histogrammes à mémoire fixe (buckets log-linéaires façon HDR : 8 sous-buckets
+// par puissance de 2, soit une précision relative de 12,5 %) des durées
+// d'étapes et des durées totales de cycle, plus les compteurs d'abandons et
+// d'urgences. L'ensemble est persisté en NVS et publié à la demande.
+
+void stats_init(void);
+
+// Étape terminée normalement (pas d'abandon). consigne_ms = durée configurée,
+// utilisée pour la conformité du maintien de stérilisation ; 0 pour une étape
+// terminée sur mesure, dont la durée n'a pas de consigne.
+void stats_etape_terminee(etape_cycle_t etape, uint32_t duree_ms, uint32_t consigne_ms);
+
+// Maintien de stérilisation terminé sur dose (capteurs) : conforme si la dose
+// est atteinte avant delai_max_ms, non conforme si le délai est dépassé.
+void stats_maintien_dose(bool atteinte, uint32_t delai_max_ms);
+void stats_cycle_termine(uint32_t duree_ms);
+void stats_cycle_abandonne(void);
+void stats_urgence(void);
+
+// Écriture NVS : à appeler hors des chemins critiques (fin de cycle, arrêt).
+void stats_sauvegarder(void);
+void stats_reinitialiser(void);
+
+// Sérialise en JSON (histogrammes creux). Retourne la longueur écrite,
+// 0 si le buffer est trop petit.
+size_t stats_json(char *buf, size_t len);
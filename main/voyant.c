@@ -0,0 +1,217 @@
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "passbox.h"
+#include "energie.h"
+#include "voyant.h"
+
+#if CONFIG_PASSBOX_VOYANT
+
+#include "led_strip.h"
+
+static const char *TAG = "Voyant";
+
+// ======================= DISPOSITION =======================
+#define NB_LEDS         CONFIG_PASSBOX_VOYANT_NB_LEDS
+#define LEDS_PORTE      2
+#define LEDS_BARRE      (NB_LEDS - 2 * LEDS_PORTE)
+#define NB_ETAPES       ETAPE_AUTORISATION_STERILE      // 7 étapes affichées
+#define PERIODE_MS      (1000 / CONFIG_PASSBOX_VOYANT_FPS)
+#define PERIODE_REPOS_MS 250                            // trame fixe, poste au repos
+#define NB_TRAMES       64                              // période des animations
+
+typedef struct {
+    uint8_t r, g, b;
+} rgb_t;
+
+// Intensités limitées : voyant en façade, alimenté par le 5 V de l'ESP32
+static const rgb_t NOIR      = { 0, 0, 0 };
+static const rgb_t ROUGE     = { 80, 0, 0 };
+static const rgb_t AMBRE     = { 80, 40, 0 };
+static const rgb_t VERT      = { 0, 60, 0 };
+static const rgb_t VERT_DOUX = { 0, 12, 0 };
+static const rgb_t BLEU_DOUX = { 0, 0, 12 };
+
+// ======================= ANIMATIONS PRECALCULEES =======================
+static rgb_t trame_urgence[NB_TRAMES];          // rouge pulsé
+static rgb_t trame_tete[NB_TRAMES];             // tête de progression ambre pulsée
+static rgb_t trame_autorisation[NB_TRAMES];     // vert clignotant
+
+static led_strip_handle_t strip = NULL;
+static voyant_etat_fn_t lire_etat = NULL;
+static bool refresh_async = false;              // backend RMT : envoi en arrière-plan
+
+static rgb_t echelle(rgb_t c, uint8_t k)
+{
+    return (rgb_t){ c.r * k / 255, c.g * k / 255, c.b * k / 255 };
+}
+
+static void precalculer(void)
+{
+    for (int i = 0; i < NB_TRAMES; i++) {
+        // Sinusoïde entre 1/8 et pleine intensité
+        uint8_t k = 32 + (uint8_t)(223.0f * (0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / NB_TRAMES)));
+        trame_urgence[i] = echelle(ROUGE, k);
+        trame_tete[i] = echelle(AMBRE, k);
+        trame_autorisation[i] = i < NB_TRAMES / 2 ? VERT : NOIR;
+    }
+}
+
+// ======================= ATTENUATION DE NUIT =======================
+static uint8_t luminosite_voulue(void)
+{
+#if CONFIG_PASSBOX_VOYANT_NUIT
+    time_t maintenant = time(NULL);
+    if (maintenant < 1700000000) return 255;    // pas encore d'heure SNTP
+    struct tm tm;
+    gmtime_r(&maintenant, &tm);
+    bool nuit = CONFIG_PASSBOX_VOYANT_NUIT_DEBUT > CONFIG_PASSBOX_VOYANT_NUIT_FIN
+              ? (tm.tm_hour >= CONFIG_PASSBOX_VOYANT_NUIT_DEBUT || tm.tm_hour < CONFIG_PASSBOX_VOYANT_NUIT_FIN)
+              : (tm.tm_hour >= CONFIG_PASSBOX_VOYANT_NUIT_DEBUT && tm.tm_hour < CONFIG_PASSBOX_VOYANT_NUIT_FIN);
+    if (nuit) return CONFIG_PASSBOX_VOYANT_LUMINOSITE_NUIT;
+#endif
+    return 255;
+}
+
+// ======================= RENDU =======================
+static void rendre(const voyant_etat_t *e, uint32_t t, rgb_t *px)
+{
+    if (e->urgence) {
+        for (int i = 0; i < NB_LEDS; i++) px[i] = trame_urgence[t];
+        return;
+    }
+
+    rgb_t contam = e->porte_contaminee_ouverte ? AMBRE : VERT_DOUX;
+    rgb_t sterile = e->porte_sterile_ouverte ? AMBRE
+                  : e->autorisation_sterile ? trame_autorisation[t] : VERT_DOUX;
+    for (int i = 0; i < LEDS_PORTE; i++) {
+        px[i] = contam;
+        px[NB_LEDS - 1 - i] = sterile;
+    }
+
+    rgb_t *barre = px + LEDS_PORTE;
+    if (!e->cycle_en_cours) {
+        for (int i = 0; i < LEDS_BARRE; i++) barre[i] = BLEU_DOUX;
+        return;
+    }
+
+    // LEDs entièrement parcourues : vert ; LED en cours : ambre pulsé
+    uint32_t faites = (e->etape >= 1 && e->etape <= NB_ETAPES) ? e->etape - 1 : NB_ETAPES;
+    uint32_t allumees = (faites * 1000 + e->progression) * LEDS_BARRE / (NB_ETAPES * 1000);
+    for (uint32_t i = 0; i < LEDS_BARRE; i++) {
+        barre[i] = i < allumees ? VERT : (i == allumees ? trame_tete[t] : NOIR);
+    }
+}
+
+static void voyant_task(void *arg)
+{
+    static rgb_t px[NB_LEDS], precedent[NB_LEDS];
+    TickType_t reveil = xTaskGetTickCount();
+    uint32_t t = 0;
+    bool premiere = true;
+    uint8_t luminosite = 255;
+    uint32_t periode_ms = PERIODE_MS;
+    bool canal_actif = true;                    // RMT : canal activé, verrou d'énergie du pilote tenu
+
+    while (1) {
+        vTaskDelayUntil(&reveil, pdMS_TO_TICKS(periode_ms));
+
+        voyant_etat_t e;
+        lire_etat(&e);
+        // Sans animation en cours, poste au repos : rafraîchissement espacé
+        bool anime = e.urgence || e.cycle_en_cours || e.autorisation_sterile;
+        periode_ms = anime || !energie_au_repos() ? PERIODE_MS : PERIODE_REPOS_MS;
+        rendre(&e, t, px);
+
+        // Une fois par période d'animation : luminosité jour/nuit, appliquée par le pilote
+        if (t == 0) {
+            uint8_t voulue = luminosite_voulue();
+            if (voulue != luminosite && led_strip_set_color_correction(strip, voulue, 1.0f) == ESP_OK) {
+                luminosite = voulue;
+                premiere = true;                        // retransmettre même une trame identique
+            }
+        }
+        t = (t + 1) % NB_TRAMES;
+
+        // Trame identique (états fixes) : pas de transmission
+        if (!premiere && memcmp(px, precedent, sizeof(px)) == 0) {
+            // Au repos, la dernière trame est partie : canal rendu, et avec
+            // lui le verrou qui interdisait sommeil et baisse de fréquence.
+            // Les LEDs gardent leurs couleurs sans signal.
+            if (canal_actif && periode_ms == PERIODE_REPOS_MS && led_strip_disable(strip) == ESP_OK) {
+                canal_actif = false;
+            }
+            continue;
+        }
+        if (!canal_actif) {
+            if (led_strip_enable(strip) != ESP_OK) continue;   // trame retentée à la période suivante
+            canal_actif = true;
+        }
+        premiere = false;
+        memcpy(precedent, px, sizeof(px));
+
+        // rgb_t est empaqueté sur 3 octets : toute la trame en un seul appel
+        led_strip_set_pixels(strip, 0, NB_LEDS, (const uint8_t *)px);
+        // RMT : la tâche ne bloque pas pendant l'envoi de la trame
+        if (refresh_async) {
+            led_strip_refresh_async(strip);
+        } else {
+            led_strip_refresh(strip);
+        }
+    }
+}
+
+// ======================= INIT =======================
+void voyant_init(voyant_etat_fn_t fn)
+{
+    led_strip_config_t strip_cfg = {
+        .strip_gpio_num = CONFIG_PASSBOX_VOYANT_GPIO,
+        .max_leds = NB_LEDS,
+        .led_model = LED_MODEL_WS2812,
+        .color_component_format = LED_STRIP_COLOR_COMPONENT_FMT_GRB,
+    };
+
+#if CONFIG_PASSBOX_VOYANT_BACKEND_RMT
+    led_strip_rmt_config_t rmt_cfg = {
+        .resolution_hz = 10 * 1000 * 1000,
+    };
+    esp_err_t err = led_strip_new_rmt_device(&strip_cfg, &rmt_cfg, &strip);
+    refresh_async = true;
+#else
+    led_strip_spi_config_t spi_cfg = {
+        .spi_bus = SPI2_HOST,
+        .flags.with_dma = true,
+#if CONFIG_PASSBOX_VOYANT_SPI_STREAMING
+        .flags.streaming = true,
+#endif
+    };
+    esp_err_t err = led_strip_new_spi_device(&strip_cfg, &spi_cfg, &strip);
+#endif
+    if (err != ESP_OK) {
+        // Voyant non essentiel : le pass-box fonctionne sans
+        ESP_LOGE(TAG, "Création de la barre de LEDs: %s", esp_err_to_name(err));
+        return;
+    }
+
+    lire_etat = fn;
+    precalculer();
+    led_strip_clear(strip);
+    xTaskCreatePinnedToCore(voyant_task, "voyant_task", 3072, NULL, 1, NULL, PASSBOX_COEUR_RESEAU);
+    ESP_LOGI(TAG, "%d LEDs sur GPIO %d, %d fps", NB_LEDS, CONFIG_PASSBOX_VOYANT_GPIO, CONFIG_PASSBOX_VOYANT_FPS);
+}
+
+#else
+
+void voyant_init(voyant_etat_fn_t fn)
+{
+    (void)fn;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "passbox.h"
+
+// ======================= VOYANT LUMINEUX =======================
+// Barre de LEDs adressables (WS2812) reflétant l'état du pass-box :
+//   [porte contaminée x2][progression du cycle][porte stérile x2]
+// En urgence toute la barre pulse en rouge. Rendue par une tâche de basse
+// priorité à fréquence fixe, à partir d'animations précalculées au démarrage :
+// elle ne retarde jamais les boutons ni l'inter-verrouillage.
+
+typedef struct {
+    bool urgence;
+    bool cycle_en_cours;
+    bool porte_sterile_ouverte;
+    bool porte_contaminee_ouverte;
+    bool autorisation_sterile;
+    etape_cycle_t etape;
+    uint16_t progression;           // avancement de l'étape courante, en millièmes
+} voyant_etat_t;
+
+// Appelée à chaque trame depuis la tâche du voyant : lecture seule de l'état
+typedef void (*voyant_etat_fn_t)(voyant_etat_t *etat);
+
+// Sans effet si CONFIG_PASSBOX_VOYANT n'est pas activé
+void voyant_init(voyant_etat_fn_t lire_etat);
@@ -0,0 +1,6 @@
+#pragma once
+
+// Configuration minimale pour compiler main/api_http.c sur l'hôte
+#define CONFIG_PASSBOX_API_HTTP         1
+#define CONFIG_PASSBOX_API_PORT         80
+#define CONFIG_PASSBOX_ORDONNANCEMENT   1
@@ -0,0 +1,405 @@
+// Tests de l'API HTTP locale (main/api_http.c) sur l'hôte : serveur, timer
+// et paramètres remplacés par des doublures (stubs/), handlers appelés
+// comme le ferait esp_http_server. Couvre /api/etat, le jeton (401, 403),
+// les commandes acceptées, invalides (400) et refusées (409), le flux SSE.
+//
+//   ctest --test-dir build-tools -R api_http
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "api_http.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "parametres.h"
+
+static int echecs = 0;
+
+#define VERIFIER(cond)                                                          \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: échec : %s\n", __FILE__, __LINE__, #cond);  \
+            echecs++;                                                           \
+        }                                                                       \
+    } while (0)
+
+// ======================= PARAMETRES =======================
+static parametres_t params;
+const parametres_t *const parametres = &params;
+
+#define JETON "0123456789abcdef"
+
+// ======================= POSTE SIMULE =======================
+static bool en_cours = false;
+static bool urgence = false;
+static refus_t refus_depart = REFUS_AUCUN;
+static int appels_cycle = 0;
+
+static size_t etat_json(char *buf, size_t taille)
+{
+    int n = snprintf(buf, taille, "{\"cycle\":{\"en_cours\":%s},\"urgence\":%s}", en_cours ? "true" : "false",
+                     urgence ? "true" : "false");
+    return n > 0 && (size_t)n < taille ? (size_t)n : 0;
+}
+
+static refus_t cycle(bool depart)
+{
+    appels_cycle++;
+    if (!depart) {
+        if (!en_cours) return REFUS_AUCUN_CYCLE;
+        en_cours = false;
+        return REFUS_AUCUN;
+    }
+    if (refus_depart != REFUS_AUCUN) return refus_depart;
+    en_cours = true;
+    return REFUS_AUCUN;
+}
+
+static refus_t commande_urgence(bool active)
+{
+    urgence = active;
+    return REFUS_AUCUN;
+}
+
+// ======================= TIMER =======================
+static esp_timer_cb_t timer_cb = NULL;
+static bool timer_actif = false;
+static int64_t horloge_us = 1000000;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    timer_cb = args->callback;
+    *handle = (esp_timer_handle_t)&timer_cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    (void)timer;
+    (void)period_us;
+    timer_actif = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    (void)timer;
+    timer_actif = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return horloge_us;
+}
+
+// ======================= SERVEUR =======================
+#define NB_URIS     8
+#define NB_SOCKETS  128         // descripteurs fictifs, au-delà de ceux du processus
+
+static httpd_uri_t uris[NB_URIS];
+static int nb_uris = 0;
+static httpd_close_func_t fermeture = NULL;
+
+// Octets reçus par chaque client, hors réponses des handlers
+static char recu[NB_SOCKETS][4096];
+static size_t recu_len[NB_SOCKETS];
+static bool socket_coupe[NB_SOCKETS];
+static bool socket_ferme[NB_SOCKETS];
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    fermeture = config->close_fn;
+    *handle = (httpd_handle_t)uris;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    (void)handle;
+    if (nb_uris == NB_URIS) return ESP_FAIL;
+    uris[nb_uris++] = *uri_handler;
+    return ESP_OK;
+}
+
+// Tâche du serveur : le travail s'exécute aussitôt
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    (void)handle;
+    work(arg);
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    socket_ferme[sockfd] = true;
+    fermeture(handle, sockfd);
+    return ESP_OK;
+}
+
+int httpd_socket_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    (void)hd;
+    (void)flags;
+    if (socket_coupe[sockfd]) return -1;
+    if (recu_len[sockfd] + buf_len > sizeof(recu[sockfd])) return -1;
+    memcpy(recu[sockfd] + recu_len[sockfd], buf, buf_len);
+    recu_len[sockfd] += buf_len;
+    return (int)buf_len;
+}
+
+// Requête en cours et réponse du handler
+typedef struct {
+    int fd;
+    const char *autorisation;       // NULL : pas d'en-tête
+    const char *corps;
+    size_t lu;
+    char statut[40];
+    char type[40];
+    char www_authenticate[16];
+    char reponse[1024];
+} requete_t;
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    requete_t *q = r->aux;
+    snprintf(q->statut, sizeof(q->statut), "%s", status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    requete_t *q = r->aux;
+    snprintf(q->type, sizeof(q->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    requete_t *q = r->aux;
+    if (strcmp(field, "WWW-Authenticate") == 0) snprintf(q->www_authenticate, sizeof(q->www_authenticate), "%s", value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    requete_t *q = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = (ssize_t)strlen(buf);
+    snprintf(q->reponse, sizeof(q->reponse), "%.*s", (int)buf_len, buf);
+    if (!q->statut[0]) snprintf(q->statut, sizeof(q->statut), "200 OK");
+    return ESP_OK;
+}
+
+// Comme esp_http_server : valeur tronquée à val_size - 1, signalé
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    requete_t *q = r->aux;
+    if (strcmp(field, "Authorization") != 0 || !q->autorisation) return ESP_ERR_NOT_FOUND;
+    snprintf(val, val_size, "%s", q->autorisation);
+    return strlen(q->autorisation) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    requete_t *q = r->aux;
+    size_t reste = strlen(q->corps) - q->lu;
+    size_t n = buf_len < reste ? buf_len : reste;
+    memcpy(buf, q->corps + q->lu, n);
+    q->lu += n;
+    return (int)n;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return ((requete_t *)r->aux)->fd;
+}
+
+int httpd_send(httpd_req_t *r, const char *buf, size_t buf_len)
+{
+    return httpd_socket_send(r->handle, httpd_req_to_sockfd(r), buf, buf_len, 0);
+}
+
+static requete_t appeler(httpd_method_t methode, const char *uri, const char *autorisation, const char *corps,
+                         int fd)
+{
+    requete_t q = { .fd = fd, .autorisation = autorisation, .corps = corps ? corps : "" };
+    httpd_req_t r = { .handle = uris, .content_len = strlen(q.corps), .aux = &q };
+    for (int i = 0; i < nb_uris; i++) {
+        if (uris[i].method == methode && strcmp(uris[i].uri, uri) == 0) {
+            VERIFIER(uris[i].handler(&r) == ESP_OK);
+            return q;
+        }
+    }
+    snprintf(q.statut, sizeof(q.statut), "404 Not Found");
+    return q;
+}
+
+static requete_t commander(const char *uri, const char *autorisation, const char *corps)
+{
+    return appeler(HTTP_POST, uri, autorisation, corps, 103);
+}
+
+// ======================= TESTS =======================
+static void test_etat(void)
+{
+    requete_t q = appeler(HTTP_GET, "/api/etat", NULL, NULL, 103);
+    VERIFIER(strcmp(q.statut, "200 OK") == 0);
+    VERIFIER(strcmp(q.type, "application/json") == 0);
+    VERIFIER(strcmp(q.reponse, "{\"cycle\":{\"en_cours\":false},\"urgence\":false}") == 0);
+}
+
+static void test_jeton(void)
+{
+    // api_jeton vide : lecture seule
+    params.api_jeton[0] = '\0';
+    requete_t q = commander("/api/cycle", "Bearer " JETON, "depart");
+    VERIFIER(strncmp(q.statut, "403", 3) == 0);
+    VERIFIER(appels_cycle == 0);
+
+    snprintf(params.api_jeton, sizeof(params.api_jeton), "%s", JETON);
+    const char *faux[] = {
+        NULL,                                   // pas d'en-tête
+        "Bearer 0123456789abcdeF",              // même longueur
+        "Bearer 0123456789abcde",               // préfixe
+        "Bearer " JETON "0",                    // prolongé
+        "Basic " JETON,
+        "Bearer " JETON JETON JETON JETON JETON, // tronqué par le serveur
+    };
+    for (size_t i = 0; i < sizeof(faux) / sizeof(faux[0]); i++) {
+        q = commander("/api/cycle", faux[i], "depart");
+        VERIFIER(strncmp(q.statut, "401", 3) == 0);
+        VERIFIER(strcmp(q.www_authenticate, "Bearer") == 0);
+    }
+    VERIFIER(appels_cycle == 0);
+    VERIFIER(!en_cours);
+}
+
+static void test_commandes(void)
+{
+    const char *jeton = "Bearer " JETON;
+
+    requete_t q = commander("/api/cycle", jeton, "depart\r\n");
+    VERIFIER(strcmp(q.statut, "200 OK") == 0);
+    VERIFIER(strstr(q.reponse, "\"en_cours\":true") != NULL);
+
+    q = commander("/api/cycle", jeton, "arret");
+    VERIFIER(strcmp(q.statut, "200 OK") == 0);
+    VERIFIER(!en_cours);
+
+    q = commander("/api/urgence", jeton, "activer");
+    VERIFIER(strcmp(q.statut, "200 OK") == 0);
+    VERIFIER(strstr(q.reponse, "\"urgence\":true") != NULL);
+    q = commander("/api/urgence", jeton, "desactiver");
+    VERIFIER(!urgence);
+
+    // Invalides : rien d'exécuté
+    int appels = appels_cycle;
+    q = commander("/api/cycle", jeton, "demarrer");
+    VERIFIER(strncmp(q.statut, "400", 3) == 0);
+    q = commander("/api/cycle", jeton, "depart-depart-depart");       // plus long que COMMANDE_MAX
+    VERIFIER(strncmp(q.statut, "400", 3) == 0);
+    q = commander("/api/urgence", jeton, "");
+    VERIFIER(strncmp(q.statut, "400", 3) == 0);
+    VERIFIER(appels_cycle == appels);
+
+    // Refusées : 409 et motif du nack MQTT
+    refus_depart = REFUS_PORTES_OUVERTES;
+    q = commander("/api/cycle", jeton, "depart");
+    VERIFIER(strcmp(q.statut, "409 Conflict") == 0);
+    VERIFIER(strcmp(q.reponse, "{\"erreur\":\"portes_ouvertes\",\"code\":2}") == 0);
+    refus_depart = REFUS_AUCUN;
+
+    q = commander("/api/cycle", jeton, "arret");
+    VERIFIER(strcmp(q.statut, "409 Conflict") == 0);
+    VERIFIER(strcmp(q.reponse, "{\"erreur\":\"aucun_cycle\",\"code\":5}") == 0);
+}
+
+static bool trame_recue(int fd, const char *trame)
+{
+    size_t n = strlen(trame);
+    return recu_len[fd] >= n && memcmp(recu[fd] + recu_len[fd] - n, trame, n) == 0;
+}
+
+static void test_sse(void)
+{
+    const char *repos = "data: {\"cycle\":{\"en_cours\":false},\"urgence\":false}\n\n";
+    const char *alerte = "data: {\"cycle\":{\"en_cours\":false},\"urgence\":true}\n\n";
+
+    // Ouverture : en-tête puis état courant aussitôt
+    VERIFIER(!timer_actif);
+    requete_t q = appeler(HTTP_GET, "/api/evenements", NULL, NULL, 105);
+    VERIFIER(!q.statut[0]);                                     // pas de réponse du handler
+    VERIFIER(strncmp(recu[105], "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n", 49) == 0);
+    VERIFIER(trame_recue(105, repos));
+    VERIFIER(timer_actif);
+
+    // Sans changement et avant le renvoi périodique : rien
+    size_t avant = recu_len[105];
+    horloge_us += 250000;
+    timer_cb(NULL);
+    VERIFIER(recu_len[105] == avant);
+
+    // Changement : même trame à chaque abonné
+    appeler(HTTP_GET, "/api/evenements", NULL, NULL, 106);
+    urgence = true;
+    horloge_us += 250000;
+    timer_cb(NULL);
+    VERIFIER(trame_recue(105, alerte));
+    VERIFIER(trame_recue(106, alerte));
+
+    // Renvoi au moins une fois par seconde
+    avant = recu_len[105];
+    horloge_us += 1000000;
+    timer_cb(NULL);
+    VERIFIER(recu_len[105] == avant + strlen(alerte));
+
+    // 4 abonnés au plus
+    appeler(HTTP_GET, "/api/evenements", NULL, NULL, 107);
+    appeler(HTTP_GET, "/api/evenements", NULL, NULL, 108);
+    q = appeler(HTTP_GET, "/api/evenements", NULL, NULL, 109);
+    VERIFIER(strncmp(q.statut, "503", 3) == 0);
+    VERIFIER(recu_len[109] == 0);
+
+    // Client parti : retiré à l'envoi suivant, session fermée
+    socket_coupe[106] = true;
+    urgence = false;
+    horloge_us += 250000;
+    timer_cb(NULL);
+    VERIFIER(socket_ferme[106]);
+    VERIFIER(trame_recue(105, repos));
+    q = appeler(HTTP_GET, "/api/evenements", NULL, NULL, 110);   // place libérée
+    VERIFIER(trame_recue(110, repos));
+
+    // Derniers abonnés fermés : plus de réveil périodique
+    fermeture(uris, 105);
+    fermeture(uris, 107);
+    fermeture(uris, 108);
+    VERIFIER(timer_actif);
+    fermeture(uris, 110);
+    VERIFIER(!timer_actif);
+}
+
+int main(void)
+{
+    api_http_config_t cfg = {
+        .etat_json = etat_json,
+        .cycle = cycle,
+        .urgence = commande_urgence,
+    };
+    VERIFIER(api_http_init(&cfg) == ESP_OK);
+    VERIFIER(nb_uris == 4);
+
+    test_etat();
+    test_jeton();
+    test_commandes();
+    test_sse();
+
+    if (echecs) {
+        fprintf(stderr, "%d échec(s)\n", echecs);
+        return 1;
+    }
+    printf("api_http : OK\n");
+    return 0;
+}
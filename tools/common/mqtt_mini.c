@@ -0,0 +1,428 @@
+#include "mqtt_mini.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef MQTT_MINI_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#define CONNECT     0x10
+#define CONNACK     0x20
+#define PUBLISH     0x30
+#define PUBACK      0x40
+#define SUBSCRIBE   0x82
+#define SUBACK      0x90
+#define PINGREQ     0xC0
+#define PINGRESP    0xD0
+#define DISCONNECT  0xE0
+
+#define RX_TAILLE_INITIALE  4096
+#define PAQUET_TAILLE_MAX   (16 * 1024 * 1024)
+
+// ======================= ENCODAGE =======================
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t taille;
+} tampon_t;
+
+static int tampon_ajouter(tampon_t *t, const void *d, size_t n)
+{
+    if (t->len + n > t->taille) {
+        size_t taille = t->taille ? t->taille : 256;
+        while (taille < t->len + n) taille *= 2;
+        uint8_t *b = realloc(t->buf, taille);
+        if (!b) return -1;
+        t->buf = b;
+        t->taille = taille;
+    }
+    memcpy(t->buf + t->len, d, n);
+    t->len += n;
+    return 0;
+}
+
+static int tampon_u8(tampon_t *t, uint8_t v)
+{
+    return tampon_ajouter(t, &v, 1);
+}
+
+static int tampon_u16(tampon_t *t, uint16_t v)
+{
+    uint8_t b[2] = { v >> 8, v & 0xFF };
+    return tampon_ajouter(t, b, 2);
+}
+
+static int tampon_chaine(tampon_t *t, const char *s)
+{
+    size_t n = strlen(s);
+    return tampon_u16(t, (uint16_t)n) || tampon_ajouter(t, s, n);
+}
+
+static int ecrire_tout(mqtt_mini_t *c, const uint8_t *d, size_t n)
+{
+    while (n) {
+#ifdef MQTT_MINI_TLS
+        if (c->ssl) {
+            int w = SSL_write(c->ssl, d, (int)n);
+            if (w <= 0) return -1;
+            d += w;
+            n -= (size_t)w;
+            continue;
+        }
+#endif
+        ssize_t w = send(c->fd, d, n, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        d += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+// En-tête fixe + longueur restante (varint) puis corps
+static int envoyer(mqtt_mini_t *c, uint8_t type, const tampon_t *corps)
+{
+    uint8_t entete[5];
+    size_t n = 0;
+    size_t reste = corps ? corps->len : 0;
+    entete[n++] = type;
+    do {
+        uint8_t o = reste % 128;
+        reste /= 128;
+        entete[n++] = reste ? (o | 0x80) : o;
+    } while (reste);
+
+    if (ecrire_tout(c, entete, n) < 0) return -1;
+    if (corps && corps->len && ecrire_tout(c, corps->buf, corps->len) < 0) return -1;
+    c->dernier_envoi = time(NULL);
+    return 0;
+}
+
+// ======================= RECEPTION =======================
+// Renvoie la taille du paquet complet en tête de c->rx, 0 s'il est incomplet,
+// -1 s'il est invalide. *corps = offset du corps.
+static long paquet_complet(const mqtt_mini_t *c, size_t *corps)
+{
+    size_t longueur = 0, mult = 1, i = 1;
+    for (;; i++) {
+        if (i >= c->rx_len) return 0;
+        if (i > 4) return -1;
+        longueur += (c->rx[i] & 0x7F) * mult;
+        mult *= 128;
+        if (!(c->rx[i] & 0x80)) break;
+    }
+    if (longueur > PAQUET_TAILLE_MAX) return -1;
+    *corps = i + 1;
+    if (c->rx_len < *corps + longueur) return 0;
+    return (long)(*corps + longueur);
+}
+
+static int lire_disponible(mqtt_mini_t *c)
+{
+    if (c->rx_len == c->rx_taille) {
+        size_t taille = c->rx_taille * 2;
+        uint8_t *b = realloc(c->rx, taille);
+        if (!b) return -1;
+        c->rx = b;
+        c->rx_taille = taille;
+    }
+#ifdef MQTT_MINI_TLS
+    if (c->ssl) {
+        int r = SSL_read(c->ssl, c->rx + c->rx_len, (int)(c->rx_taille - c->rx_len));
+        if (r > 0) {
+            c->rx_len += (size_t)r;
+            return 0;
+        }
+        // Ticket de session reçu après le handshake : rien pour l'application
+        int e = SSL_get_error(c->ssl, r);
+        return e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE ? 0 : -1;
+    }
+#endif
+    ssize_t r = recv(c->fd, c->rx + c->rx_len, c->rx_taille - c->rx_len, 0);
+    if (r == 0) return -1;
+    if (r < 0) return errno == EINTR || errno == EAGAIN ? 0 : -1;
+    c->rx_len += (size_t)r;
+    return 0;
+}
+
+static int traiter_publish(mqtt_mini_t *c, const uint8_t *p, size_t n, uint8_t flags,
+                           mqtt_mini_msg_cb cb, void *ctx)
+{
+    if (n < 2) return -1;
+    size_t lt = ((size_t)p[0] << 8) | p[1];
+    if (2 + lt > n) return -1;
+
+    char topic[512];
+    if (lt >= sizeof(topic)) lt = sizeof(topic) - 1;
+    memcpy(topic, p + 2, lt);
+    topic[lt] = '\0';
+
+    size_t pos = 2 + (((size_t)p[0] << 8) | p[1]);
+    int qos = (flags >> 1) & 0x03;
+    uint16_t id = 0;
+    if (qos > 0) {
+        if (pos + 2 > n) return -1;
+        id = (uint16_t)((p[pos] << 8) | p[pos + 1]);
+        pos += 2;
+    }
+
+    if (cb) cb(ctx, topic, p + pos, n - pos);
+
+    if (qos == 1) {
+        tampon_t t = { 0 };
+        int err = tampon_u16(&t, id) || envoyer(c, PUBACK, &t);
+        free(t.buf);
+        return err ? -1 : 0;
+    }
+    return 0;
+}
+
+// ======================= CONNEXION =======================
+static int ouvrir_socket(mqtt_mini_t *c, const char *hote, int port, int keepalive_s)
+{
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    c->keepalive_s = keepalive_s;
+    c->prochain_id = 1;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo indices = { .ai_socktype = SOCK_STREAM }, *res, *ai;
+    int err = getaddrinfo(hote, service, &indices, &res);
+    if (err) {
+        fprintf(stderr, "mqtt: %s: %s\n", hote, gai_strerror(err));
+        return -1;
+    }
+    for (ai = res; ai; ai = ai->ai_next) {
+        c->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (c->fd < 0) continue;
+        if (connect(c->fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            // Paquets courts (en-tête puis corps, messages TLS) : pas d'attente de Nagle
+            int un = 1;
+            setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &un, sizeof(un));
+            break;
+        }
+        close(c->fd);
+        c->fd = -1;
+    }
+    freeaddrinfo(res);
+    if (c->fd < 0) {
+        perror("mqtt: connexion");
+        return -1;
+    }
+
+    c->rx_taille = RX_TAILLE_INITIALE;
+    c->rx = malloc(c->rx_taille);
+    return c->rx ? 0 : -1;
+}
+
+// CONNECT puis attente du CONNACK
+static int ouvrir_session(mqtt_mini_t *c, const char *client_id)
+{
+    tampon_t t = { 0 };
+    int e = tampon_chaine(&t, "MQTT") || tampon_u8(&t, 4) || tampon_u8(&t, 0x02 /* clean session */)
+            || tampon_u16(&t, (uint16_t)c->keepalive_s) || tampon_chaine(&t, client_id)
+            || envoyer(c, CONNECT, &t);
+    free(t.buf);
+    if (e) return -1;
+
+    size_t corps;
+    long n;
+    while ((n = paquet_complet(c, &corps)) == 0) {
+        if (lire_disponible(c) < 0) return -1;
+    }
+    if (n < 0 || (c->rx[0] & 0xF0) != CONNACK || n < 4) return -1;
+    if (c->rx[corps + 1] != 0) {
+        fprintf(stderr, "mqtt: connexion refusée (code %u)\n", c->rx[corps + 1]);
+        return -1;
+    }
+    memmove(c->rx, c->rx + n, c->rx_len - (size_t)n);
+    c->rx_len -= (size_t)n;
+    return 0;
+}
+
+// ======================= API =======================
+int mqtt_mini_connect(mqtt_mini_t *c, const char *hote, int port, const char *client_id, int keepalive_s)
+{
+    if (ouvrir_socket(c, hote, port, keepalive_s) < 0) return -1;
+    return ouvrir_session(c, client_id);
+}
+
+int mqtt_mini_subscribe(mqtt_mini_t *c, const char *const *topics, int nb)
+{
+    tampon_t t = { 0 };
+    int e = tampon_u16(&t, c->prochain_id++);
+    for (int i = 0; i < nb && !e; i++) {
+        e = tampon_chaine(&t, topics[i]) || tampon_u8(&t, 0);
+    }
+    e = e || envoyer(c, SUBSCRIBE, &t);
+    free(t.buf);
+    return e ? -1 : 0;
+}
+
+int mqtt_mini_publish(mqtt_mini_t *c, const char *topic, const void *payload, size_t len, bool retain)
+{
+    tampon_t t = { 0 };
+    int e = tampon_chaine(&t, topic) || tampon_ajouter(&t, payload, len)
+            || envoyer(c, PUBLISH | (retain ? 0x01 : 0x00), &t);
+    free(t.buf);
+    return e ? -1 : 0;
+}
+
+int mqtt_mini_loop(mqtt_mini_t *c, int timeout_ms, mqtt_mini_msg_cb cb, void *ctx)
+{
+    struct pollfd pfd = { .fd = c->fd, .events = POLLIN };
+    bool deja_lu = false;
+#ifdef MQTT_MINI_TLS
+    // Octets déjà déchiffrés par OpenSSL : le socket peut rester muet
+    deja_lu = c->ssl && SSL_pending(c->ssl) > 0;
+#endif
+    int r = poll(&pfd, 1, deja_lu ? 0 : timeout_ms);
+    if (r < 0 && errno != EINTR) return -1;
+    if (r > 0 && (pfd.revents & (POLLERR | POLLHUP))) return -1;
+    if (r > 0 || deja_lu) {
+        if (lire_disponible(c) < 0) return -1;
+    }
+
+    size_t corps;
+    long n;
+    while ((n = paquet_complet(c, &corps)) > 0) {
+        uint8_t type = c->rx[0] & 0xF0;
+        if (type == PUBLISH) {
+            if (traiter_publish(c, c->rx + corps, (size_t)n - corps, c->rx[0] & 0x0F, cb, ctx) < 0) return -1;
+        }
+        // SUBACK, PINGRESP, PUBACK : rien à faire
+        memmove(c->rx, c->rx + n, c->rx_len - (size_t)n);
+        c->rx_len -= (size_t)n;
+    }
+    if (n < 0) return -1;
+
+    if (c->keepalive_s && time(NULL) - c->dernier_envoi >= c->keepalive_s / 2) {
+        if (envoyer(c, PINGREQ, NULL) < 0) return -1;
+    }
+    return 0;
+}
+
+void mqtt_mini_close(mqtt_mini_t *c)
+{
+    if (c->fd >= 0) {
+        envoyer(c, DISCONNECT, NULL);
+#ifdef MQTT_MINI_TLS
+        if (c->ssl) {
+            SSL_shutdown(c->ssl);
+            SSL_free(c->ssl);
+        }
+#endif
+        close(c->fd);
+    }
+    c->ssl = NULL;
+    free(c->rx);
+    c->fd = -1;
+    c->rx = NULL;
+}
+
+#ifdef MQTT_MINI_TLS
+// ======================= TLS =======================
+struct mqtt_mini_tls {
+    SSL_CTX *ctx;
+    SSL_SESSION *session;           // dernier ticket reçu, NULL : handshake complet
+};
+
+// Appelé par OpenSSL pour chaque ticket (en TLS 1.3, après le handshake,
+// pendant une lecture) : on garde le plus récent
+static int nouvelle_session(SSL *ssl, SSL_SESSION *session)
+{
+    mqtt_mini_tls_t *tls = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    if (tls->session) SSL_SESSION_free(tls->session);
+    tls->session = session;
+    return 1;                       // référence conservée
+}
+
+mqtt_mini_tls_t *mqtt_mini_tls_new(const char *ca_pem, bool ecdsa_seul, bool tls13)
+{
+    mqtt_mini_tls_t *tls = calloc(1, sizeof(*tls));
+    if (!tls) return NULL;
+    tls->ctx = SSL_CTX_new(TLS_client_method());
+    if (!tls->ctx) goto erreur;
+
+    SSL_CTX_set_app_data(tls->ctx, tls);
+    SSL_CTX_set_verify(tls->ctx, SSL_VERIFY_PEER, NULL);
+    // Un enregistrement sans données (ticket) rend la main au lieu de bloquer
+    SSL_CTX_clear_mode(tls->ctx, SSL_MODE_AUTO_RETRY);
+    SSL_CTX_set_min_proto_version(tls->ctx, TLS1_2_VERSION);
+    if (!tls13) SSL_CTX_set_max_proto_version(tls->ctx, TLS1_2_VERSION);
+
+    int ok = ca_pem ? SSL_CTX_load_verify_locations(tls->ctx, ca_pem, NULL)
+                    : SSL_CTX_set_default_verify_paths(tls->ctx);
+    if (ok != 1) goto erreur;
+
+    if (ecdsa_seul) {
+        if (SSL_CTX_set_cipher_list(tls->ctx, "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384") != 1 ||
+            SSL_CTX_set1_sigalgs_list(tls->ctx, "ECDSA+SHA256:ECDSA+SHA384") != 1) goto erreur;
+    }
+
+    // Cache côté client sans stockage interne : les tickets passent par le callback
+    SSL_CTX_set_session_cache_mode(tls->ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(tls->ctx, nouvelle_session);
+    return tls;
+
+erreur:
+    ERR_print_errors_fp(stderr);
+    mqtt_mini_tls_free(tls);
+    return NULL;
+}
+
+void mqtt_mini_tls_oublier_session(mqtt_mini_tls_t *tls)
+{
+    if (tls->session) SSL_SESSION_free(tls->session);
+    tls->session = NULL;
+}
+
+void mqtt_mini_tls_free(mqtt_mini_tls_t *tls)
+{
+    if (!tls) return;
+    mqtt_mini_tls_oublier_session(tls);
+    SSL_CTX_free(tls->ctx);
+    free(tls);
+}
+
+int mqtt_mini_connect_tls(mqtt_mini_t *c, const char *hote, int port, const char *client_id,
+                          int keepalive_s, mqtt_mini_tls_t *tls)
+{
+    if (ouvrir_socket(c, hote, port, keepalive_s) < 0) return -1;
+
+    SSL *ssl = SSL_new(tls->ctx);
+    if (!ssl) return -1;
+    c->ssl = ssl;
+    SSL_set_fd(ssl, c->fd);
+    SSL_set_tlsext_host_name(ssl, hote);
+    SSL_set1_host(ssl, hote);
+    if (tls->session) SSL_set_session(ssl, tls->session);
+
+    if (SSL_connect(ssl) != 1) {
+        fprintf(stderr, "mqtt: handshake TLS refusé\n");
+        ERR_print_errors_fp(stderr);
+        // Ticket peut-être en cause : la tentative suivante repart de zéro
+        mqtt_mini_tls_oublier_session(tls);
+        return -1;
+    }
+    return ouvrir_session(c, client_id);
+}
+
+bool mqtt_mini_session_reprise(const mqtt_mini_t *c)
+{
+    return c->ssl && SSL_session_reused(c->ssl);
+}
+#endif
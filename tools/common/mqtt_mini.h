@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// ======================= CLIENT MQTT 3.1.1 MINIMAL =======================
+// Client bloquant sans dépendance pour les outils hôte (QoS 0/1 en réception,
+// QoS 0 en émission, keepalive). Suffisant pour un broker local ou HiveMQ.
+// TLS (OpenSSL) quand MQTT_MINI_TLS est défini.
+
+typedef void (*mqtt_mini_msg_cb)(void *ctx, const char *topic, const uint8_t *payload, size_t len);
+
+typedef struct {
+    int fd;
+    void *ssl;                      // SSL *, NULL en TCP simple
+    int keepalive_s;
+    time_t dernier_envoi;
+    uint16_t prochain_id;
+    uint8_t *rx;
+    size_t rx_taille;
+    size_t rx_len;
+} mqtt_mini_t;
+
+// 0 si connecté (CONNACK accepté), -1 sinon (errno ou code de retour loggé)
+int mqtt_mini_connect(mqtt_mini_t *c, const char *hote, int port, const char *client_id, int keepalive_s);
+int mqtt_mini_subscribe(mqtt_mini_t *c, const char *const *topics, int nb);
+int mqtt_mini_publish(mqtt_mini_t *c, const char *topic, const void *payload, size_t len, bool retain);
+
+// Attend au plus timeout_ms, traite les paquets reçus et envoie les PINGREQ.
+// -1 si la connexion est perdue.
+int mqtt_mini_loop(mqtt_mini_t *c, int timeout_ms, mqtt_mini_msg_cb cb, void *ctx);
+
+void mqtt_mini_close(mqtt_mini_t *c);
+
+#ifdef MQTT_MINI_TLS
+// Contexte partagé par les connexions successives : vérification du broker
+// (fichier CA PEM, magasin système si NULL) et dernier ticket de session
+// reçu, présenté à la connexion suivante pour un handshake abrégé.
+typedef struct mqtt_mini_tls mqtt_mini_tls_t;
+
+// ecdsa_seul : suites ECDHE-ECDSA uniquement ; tls13 : sinon TLS 1.2 seul,
+// comme l'ESP32 (mbedTLS sans TLS 1.3)
+mqtt_mini_tls_t *mqtt_mini_tls_new(const char *ca_pem, bool ecdsa_seul, bool tls13);
+void mqtt_mini_tls_oublier_session(mqtt_mini_tls_t *tls);
+void mqtt_mini_tls_free(mqtt_mini_tls_t *tls);
+
+int mqtt_mini_connect_tls(mqtt_mini_t *c, const char *hote, int port, const char *client_id,
+                          int keepalive_s, mqtt_mini_tls_t *tls);
+
+// true si le handshake de la connexion a repris la session précédente
+bool mqtt_mini_session_reprise(const mqtt_mini_t *c);
+#endif
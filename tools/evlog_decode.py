@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Décodeur hôte des logs binaires evlog du Pass-Box.
+
+Lit la sortie console de l'ESP32 (fichier ou stdin, par ex. la sortie de
+`idf.py monitor`), décode les lignes "EVL:<base64>" à l'aide de la table
+main/evlog_ids.h et laisse passer les autres lignes telles quelles.
+
+    idf.py -p /dev/ttyUSB0 monitor | python3 tools/evlog_decode.py
+    python3 tools/evlog_decode.py capture.log
+"""
+
+import argparse
+import base64
+import os
+import re
+import struct
+import sys
+
+ENTETE = struct.Struct('<IHBB')     # ts_us, id, longueur, réservé
+IDS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'main', 'evlog_ids.h')
+MESSAGE_RE = re.compile(r'X\(\s*(\w+)\s*,\s*"([sud]*)"\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+CONVERSION_RE = re.compile(r'%[sudx]')
+
+
+def charger_table(chemin):
+    with open(chemin, encoding='utf-8') as f:
+        return [(nom, sig, fmt.replace('\\"', '"')) for nom, sig, fmt in MESSAGE_RE.findall(f.read())]
+
+
+def decoder_args(sig, donnees):
+    args = []
+    pos = 0
+    for t in sig:
+        if t == 's':
+            n = donnees[pos]
+            args.append(donnees[pos + 1:pos + 1 + n].decode('utf-8', 'replace'))
+            pos += 1 + n
+        else:
+            args.append(struct.unpack_from('<i' if t == 'd' else '<I', donnees, pos)[0])
+            pos += 4
+    return args
+
+
+class Decodeur:
+    def __init__(self, table):
+        self.table = table
+        self.dernier_ts = None
+        self.base_us = 0
+        noms = [nom for nom, _, _ in table]
+        self.id_horloge = noms.index('EVL_HORLOGE') if 'EVL_HORLOGE' in noms else None
+
+    def horodater(self, ts):
+        # Le compteur 32 bits en µs reboucle toutes les ~71 min. Les
+        # enregistrements sont dans l'ordre de leurs horodatages : seule une
+        # baisse de plus d'une demi-période est un rebouclage ; EVL_HORLOGE
+        # (au moins toutes les 10 min) garde les écarts sous ce seuil.
+        if self.dernier_ts is not None and self.dernier_ts - ts > 1 << 31:
+            self.base_us += 1 << 32
+        self.dernier_ts = ts
+        return (self.base_us + ts) / 1e6
+
+    def recaler(self, haut, ts):
+        # Poids fort de l'horloge 64 bits, lu juste avant l'horodatage ts
+        self.base_us = haut << 32
+        self.dernier_ts = ts
+
+    def ligne(self, b64):
+        try:
+            brut = base64.b64decode(b64, validate=True)
+        except ValueError:
+            yield '<evlog: ligne illisible>'
+            return
+        pos = 0
+        while pos + ENTETE.size <= len(brut):
+            ts, ident, longueur, _ = ENTETE.unpack_from(brut, pos)
+            donnees = brut[pos + ENTETE.size:pos + ENTETE.size + longueur]
+            pos += ENTETE.size + longueur
+            if ident == self.id_horloge and len(donnees) == 4:
+                self.recaler(struct.unpack('<I', donnees)[0], ts)
+            t = self.horodater(ts)
+            if ident >= len(self.table):
+                yield f'E ({t:.6f}) evlog: identifiant inconnu {ident}'
+                continue
+            nom, sig, fmt = self.table[ident]
+            try:
+                texte = CONVERSION_RE.sub(lambda m: {'%u': '%d'}.get(m.group(0), m.group(0)), fmt) % tuple(decoder_args(sig, donnees))
+            except (IndexError, struct.error, TypeError):
+                texte = f'<{nom}: arguments invalides>'
+            yield f'I ({t:.6f}) {texte}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('fichier', nargs='?', help='capture console (stdin par défaut)')
+    parser.add_argument('--ids', default=IDS_H, help='table des messages (main/evlog_ids.h)')
+    args = parser.parse_args()
+
+    decodeur = Decodeur(charger_table(args.ids))
+    entree = open(args.fichier, encoding='utf-8', errors='replace') if args.fichier else sys.stdin
+    with entree:
+        for ligne in entree:
+            i = ligne.find('EVL:')
+            if i < 0:
+                sys.stdout.write(ligne)
+                continue
+            for texte in decodeur.ligne(ligne[i + 4:].strip()):
+                print(texte)
+            sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
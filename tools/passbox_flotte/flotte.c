@@ -0,0 +1,300 @@
+#include "flotte.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const flotte_champs[CHAMP_NB] = {
+    [CHAMP_CYCLE]               = "cycle",
+    [CHAMP_ETAPE]               = "etape",
+    [CHAMP_ERREUR]              = "erreur",
+    [CHAMP_URGENCE]             = "urgence",
+    [CHAMP_PORTE_STERILE]       = "porte_sterile",
+    [CHAMP_PORTE_CONTAMINEE]    = "porte_contaminee",
+    [CHAMP_PRESSION]            = "pression_pa",
+    [CHAMP_H2O2]                = "h2o2_ppm",
+    [CHAMP_HUMIDITE]            = "humidite",
+    [CHAMP_TEMPERATURE]         = "temperature",
+    [CHAMP_REFUS]               = "refus",
+    [CHAMP_OTA]                 = "ota",
+    [CHAMP_VU]                  = "vu",
+};
+
+// Topics d'état publiés par un poste, décodés chacun par sa fonction
+typedef enum {
+    TOPIC_CYCLE_DEPART = 0,
+    TOPIC_CYCLE_ETAPE,
+    TOPIC_URGENCE,
+    TOPIC_PORTE_STERILE,
+    TOPIC_PORTE_CONTAMINEE,
+    TOPIC_MESURES,
+    TOPIC_REPONSE,
+    TOPIC_OTA,
+    TOPIC_NB
+} topic_t;
+
+static const char *const topics[TOPIC_NB] = {
+    [TOPIC_CYCLE_DEPART]        = "cycle/depart",
+    [TOPIC_CYCLE_ETAPE]         = "cycle/etape",
+    [TOPIC_URGENCE]             = "urgence",
+    [TOPIC_PORTE_STERILE]       = "porte/sterile",
+    [TOPIC_PORTE_CONTAMINEE]    = "porte/contaminee",
+    [TOPIC_MESURES]             = "mesures",
+    [TOPIC_REPONSE]             = "reponse",
+    [TOPIC_OTA]                 = "ota",
+};
+
+// Topic complet -> topic suivi et longueur du préfixe du poste ('/' exclu),
+// -1 sinon ; mêmes règles que passbox_store (commandes exclues)
+static int topic_id(const char *topic, size_t *prefixe)
+{
+    size_t n = strlen(topic);
+    for (int i = 0; i < TOPIC_NB; i++) {
+        size_t m = strlen(topics[i]);
+        if (n < m || strcmp(topic + n - m, topics[i]) != 0) continue;
+        if (n == m) {
+            *prefixe = 0;
+            return i;
+        }
+        size_t p = n - m - 1;
+        if (topic[p] != '/') continue;
+        if (p >= 3 && strncmp(topic + p - 3, "cmd", 3) == 0 && (p == 3 || topic[p - 4] == '/')) continue;
+        *prefixe = p;
+        return i;
+    }
+    return -1;
+}
+
+// ======================= POSTES =======================
+void flotte_init(flotte_t *f)
+{
+    memset(f, 0, sizeof(*f));
+}
+
+static uint32_t hacher(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;           // FNV-1a
+    for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+static flotte_poste_t *poste_trouver(flotte_t *f, const char *prefixe, size_t len)
+{
+    if (len >= FLOTTE_POSTE_MAX) return NULL;
+    for (uint32_t i = hacher(prefixe, len) & (FLOTTE_TABLE - 1);; i = (i + 1) & (FLOTTE_TABLE - 1)) {
+        if (f->table[i] == 0) {
+            if (f->nb_postes == FLOTTE_NB_POSTES) return NULL;
+            flotte_poste_t *p = &f->postes[f->nb_postes];
+            memcpy(p->nom, prefixe, len);
+            p->nom[len] = '\0';
+            f->table[i] = (int16_t)++f->nb_postes;
+            return p;
+        }
+        flotte_poste_t *p = &f->postes[f->table[i] - 1];
+        if (strncmp(p->nom, prefixe, len) == 0 && p->nom[len] == '\0') return p;
+    }
+}
+
+static void champ_ecrire(flotte_poste_t *p, champ_t c, const char *valeur)
+{
+    if (strcmp(p->valeurs[c], valeur) == 0) return;
+    snprintf(p->valeurs[c], FLOTTE_VALEUR_MAX, "%s", valeur);
+    p->modifies |= 1u << c;
+}
+
+// ======================= DECODAGE =======================
+// Chaîne JSON, tronquée à taille octets
+static void json_chaine(const char *s, size_t len, char *buf, size_t taille)
+{
+    size_t n = 0;
+    buf[n++] = '"';
+    for (size_t i = 0; i < len && n < taille - 3; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c < 0x20) continue;
+        if (c == '"' || c == '\\') buf[n++] = '\\';
+        buf[n++] = (char)c;
+    }
+    buf[n++] = '"';
+    buf[n] = '\0';
+}
+
+static bool booleen(const char *v, const char **json)
+{
+    if (strcmp(v, "true") == 0) *json = "true";
+    else if (strcmp(v, "false") == 0) *json = "false";
+    else return false;
+    return true;
+}
+
+// Nombre JSON de la clé, recopié tel quel
+static bool json_nombre(const char *json, const char *cle, char *buf)
+{
+    char motif[40];
+    snprintf(motif, sizeof(motif), "\"%s\":", cle);
+    const char *p = strstr(json, motif);
+    if (!p) return false;
+    p += strlen(motif);
+    size_t n = strspn(p, "-+.0123456789eE");
+    if (n == 0 || n >= FLOTTE_VALEUR_MAX) return false;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    return true;
+}
+
+// Chaîne JSON de la clé, sans échappement (valeurs du firmware)
+static bool json_texte(const char *json, const char *cle, char *buf)
+{
+    char motif[40];
+    snprintf(motif, sizeof(motif), "\"%s\":\"", cle);
+    const char *p = strstr(json, motif);
+    if (!p) return false;
+    p += strlen(motif);
+    json_chaine(p, strcspn(p, "\""), buf, FLOTTE_VALEUR_MAX);
+    return true;
+}
+
+static bool decoder(flotte_poste_t *p, topic_t t, const char *v)
+{
+    char buf[FLOTTE_VALEUR_MAX];
+    const char *b;
+
+    switch (t) {
+    case TOPIC_CYCLE_DEPART:
+        if (!booleen(v, &b)) return false;
+        champ_ecrire(p, CHAMP_CYCLE, b);
+        return true;
+
+    case TOPIC_URGENCE:
+        if (!booleen(v, &b)) return false;
+        champ_ecrire(p, CHAMP_URGENCE, b);
+        return true;
+
+    case TOPIC_PORTE_STERILE:
+    case TOPIC_PORTE_CONTAMINEE:
+        if (!booleen(v, &b)) return false;
+        champ_ecrire(p, t == TOPIC_PORTE_STERILE ? CHAMP_PORTE_STERILE : CHAMP_PORTE_CONTAMINEE, b);
+        return true;
+
+    // "3: Injection produit", "Erreur: portes ouvertes", ou "URGENCE",
+    // "Arrete", "Systeme pret" (hors cycle)
+    case TOPIC_CYCLE_ETAPE:
+        if (strncmp(v, "Erreur: ", 8) == 0) {
+            json_chaine(v + 8, strlen(v + 8), buf, sizeof(buf));
+            champ_ecrire(p, CHAMP_ERREUR, buf);
+        } else {
+            snprintf(buf, sizeof(buf), "%d", isdigit((unsigned char)v[0]) ? atoi(v) : 0);
+            champ_ecrire(p, CHAMP_ETAPE, buf);
+            champ_ecrire(p, CHAMP_ERREUR, "null");
+        }
+        return true;
+
+    case TOPIC_MESURES: {
+        static const struct {
+            const char *cle;
+            champ_t champ;
+        } cles[] = {
+            { "pression_pa", CHAMP_PRESSION },
+            { "h2o2_ppm", CHAMP_H2O2 },
+            { "humidite", CHAMP_HUMIDITE },
+            { "temperature", CHAMP_TEMPERATURE },
+        };
+        bool lu = false;
+        for (size_t i = 0; i < sizeof(cles) / sizeof(cles[0]); i++) {
+            if (json_nombre(v, cles[i].cle, buf)) {
+                champ_ecrire(p, cles[i].champ, buf);
+                lu = true;
+            }
+        }
+        return lu;
+    }
+
+    case TOPIC_REPONSE:
+        if (strstr(v, "\"resultat\":\"ack\"")) {
+            champ_ecrire(p, CHAMP_REFUS, "null");
+        } else if (json_texte(v, "raison", buf)) {
+            champ_ecrire(p, CHAMP_REFUS, buf);
+        } else {
+            return false;
+        }
+        return true;
+
+    case TOPIC_OTA:
+        if (!json_texte(v, "etat", buf)) return false;
+        champ_ecrire(p, CHAMP_OTA, buf);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool flotte_message(flotte_t *f, const char *topic, const uint8_t *payload, size_t len, int64_t ts_ms)
+{
+    size_t prefixe;
+    int t = topic_id(topic, &prefixe);
+    flotte_poste_t *p = t >= 0 ? poste_trouver(f, topic, prefixe) : NULL;
+    if (!p) {
+        f->ignores++;
+        return false;
+    }
+
+    char v[512];
+    if (len >= sizeof(v)) len = sizeof(v) - 1;
+    memcpy(v, payload, len);
+    v[len] = '\0';
+    if (!decoder(p, (topic_t)t, v)) {
+        f->ignores++;
+        return false;
+    }
+
+    char vu[24];
+    snprintf(vu, sizeof(vu), "%lld", (long long)(ts_ms / 1000));
+    champ_ecrire(p, CHAMP_VU, vu);
+    f->messages++;
+    return true;
+}
+
+// ======================= TRAMES =======================
+bool flotte_modifiee(const flotte_t *f)
+{
+    for (int i = 0; i < f->nb_postes; i++) {
+        if (f->postes[i].modifies) return true;
+    }
+    return false;
+}
+
+size_t flotte_trame(flotte_t *f, bool complet, int64_t ts_ms, char *buf, size_t taille)
+{
+    if (!complet && !flotte_modifiee(f)) return 0;
+
+    size_t n = (size_t)snprintf(buf, taille, "{\"seq\":%llu,\"t\":%lld,%s\"postes\":{",
+                                (unsigned long long)(f->seq + 1), (long long)ts_ms, complet ? "\"complet\":true," : "");
+    bool premier_poste = true;
+    for (int i = 0; i < f->nb_postes && n < taille; i++) {
+        const flotte_poste_t *p = &f->postes[i];
+        uint32_t champs = complet ? ~0u : p->modifies;
+        if (!champs) continue;
+
+        // Nom tiré du topic : échappé comme les valeurs
+        char nom[2 * FLOTTE_POSTE_MAX + 2];
+        json_chaine(p->nom, strlen(p->nom), nom, sizeof(nom));
+        n += (size_t)snprintf(buf + n, n < taille ? taille - n : 0, "%s%s:{", premier_poste ? "" : ",", nom);
+        premier_poste = false;
+        bool premier_champ = true;
+        for (int c = 0; c < CHAMP_NB && n < taille; c++) {
+            if (!(champs & (1u << c)) || !p->valeurs[c][0]) continue;
+            n += (size_t)snprintf(buf + n, taille - n, "%s\"%s\":%s", premier_champ ? "" : ",", flotte_champs[c],
+                                  p->valeurs[c]);
+            premier_champ = false;
+        }
+        if (n < taille) n += (size_t)snprintf(buf + n, taille - n, "}");
+    }
+    if (n < taille) n += (size_t)snprintf(buf + n, taille - n, "}}");
+    if (n >= taille) return 0;
+
+    // Rendue en entier : changements publiés
+    for (int i = 0; i < f->nb_postes; i++) f->postes[i].modifies = 0;
+    f->seq++;
+    return n;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ======================= ETAT DE LA FLOTTE =======================
+// Dernier état connu de chaque poste, décodé des topics texte et JSON qu'il
+// publie. Chaque champ est gardé déjà rendu en JSON : une trame se construit
+// par simple concaténation. Un bit par champ note ce qui a changé depuis la
+// trame précédente ; une trame différentielle ne porte que ces champs, une
+// trame complète tous les champs connus.
+//
+//   {"seq":42,"t":1766100392084,"postes":{"usine/salle1/passbox-07":{"etape":3,"vu":1766100392}}}
+//
+// Un poste publiant sans préfixe (poste unique) apparaît sous "".
+
+#define FLOTTE_NB_POSTES    256
+#define FLOTTE_POSTE_MAX    72
+#define FLOTTE_VALEUR_MAX   48
+#define FLOTTE_TABLE        512         // hachage des préfixes, puissance de 2
+
+typedef enum {
+    CHAMP_CYCLE = 0,                    // cycle/depart
+    CHAMP_ETAPE,                        // cycle/etape : numéro, 0 hors cycle
+    CHAMP_ERREUR,                       // cycle/etape "Erreur: ..."
+    CHAMP_URGENCE,
+    CHAMP_PORTE_STERILE,
+    CHAMP_PORTE_CONTAMINEE,
+    CHAMP_PRESSION,                     // mesures
+    CHAMP_H2O2,
+    CHAMP_HUMIDITE,
+    CHAMP_TEMPERATURE,
+    CHAMP_REFUS,                        // reponse : raison du dernier nack, null après un ack
+    CHAMP_OTA,                          // ota : dernier état
+    CHAMP_VU,                           // heure Unix (s) du dernier message
+    CHAMP_NB
+} champ_t;
+
+typedef struct {
+    char nom[FLOTTE_POSTE_MAX];
+    char valeurs[CHAMP_NB][FLOTTE_VALEUR_MAX];  // "" : jamais reçu
+    uint32_t modifies;                          // bits (1 << champ_t) depuis la dernière trame
+} flotte_poste_t;
+
+typedef struct {
+    flotte_poste_t postes[FLOTTE_NB_POSTES];
+    int nb_postes;
+    int16_t table[FLOTTE_TABLE];        // index + 1 dans postes, 0 : libre
+    uint64_t seq;                       // numéro de la dernière trame rendue
+    uint64_t messages;                  // messages décodés
+    uint64_t ignores;                   // topics non suivis, valeurs invalides, table pleine
+} flotte_t;
+
+// Noms des champs dans les trames
+extern const char *const flotte_champs[CHAMP_NB];
+
+void flotte_init(flotte_t *f);
+
+// Message publié par un poste ; false s'il est ignoré
+bool flotte_message(flotte_t *f, const char *topic, const uint8_t *payload, size_t len, int64_t ts_ms);
+
+// Des changements attendent une trame différentielle
+bool flotte_modifiee(const flotte_t *f);
+
+// Rend la trame suivante dans buf : différentielle, ou complète si complet.
+// Les changements rendus sont effacés, seq avance. Longueur écrite ; 0 si
+// rien n'a changé (différentielle) ou si buf est trop petit, les changements
+// étant alors gardés.
+size_t flotte_trame(flotte_t *f, bool complet, int64_t ts_ms, char *buf, size_t taille);
@@ -0,0 +1,276 @@
+// Passerelle de flotte du Pass-Box : s'abonne aux topics de tous les postes,
+// garde leur dernier état et publie à cadence fixe une seule trame
+// différentielle pour toute la flotte (voir flotte.h). La charge du tableau
+// de bord ne dépend plus du rythme de publication des postes.
+//
+//   passbox_flotte passerelle [-h localhost] [-p 1883] [-f '+/+/+'] [-s flotte/] [-i 1000] [-k 60]
+//   passbox_flotte rejouer    [-i 1000] [-k 60] mqtt_log.csv
+//
+// passerelle publie sur <s>etat les changements de la période écoulée (rien
+// si aucun poste n'a changé) et sur <s>complet, retenue, une trame complète
+// toutes les k secondes ou à la demande (<s>cmd/complet) : un abonné arrivant
+// la reçoit du broker puis applique les différentielles (seq consécutifs).
+// rejouer passe un CSV Node-RED dans le même agrégateur, horloge simulée, et
+// écrit les trames qui auraient été publiées.
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flotte.h"
+#include "mqtt_mini.h"
+
+#define TRAME_TAILLE (1024 * 1024)
+
+static const char *const suivis[] = {
+    "cycle/depart", "cycle/etape", "urgence", "porte/sterile", "porte/contaminee", "mesures", "reponse", "ota",
+};
+#define NB_SUIVIS ((int)(sizeof(suivis) / sizeof(suivis[0])))
+
+static volatile sig_atomic_t arret = 0;
+static flotte_t flotte;
+static char trame[TRAME_TAILLE];
+
+static void sur_signal(int sig)
+{
+    (void)sig;
+    arret = 1;
+}
+
+// ======================= HORODATAGE =======================
+static int64_t maintenant_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// "2025-12-18T23:26:32.084Z" (millisecondes facultatives, UTC)
+static int iso_lire(const char *s, int64_t *ms)
+{
+    struct tm tm = { 0 };
+    const char *fin = strptime(s, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (!fin) return -1;
+    int64_t frac = 0;
+    if (*fin == '.') {
+        int chiffres = 0;
+        for (fin++; *fin >= '0' && *fin <= '9'; fin++) {
+            if (chiffres++ < 3) frac = frac * 10 + (*fin - '0');
+        }
+        while (chiffres++ < 3) frac *= 10;
+    }
+    *ms = (int64_t)timegm(&tm) * 1000 + frac;
+    return 0;
+}
+
+// ======================= BILAN =======================
+typedef struct {
+    uint64_t octets_recus;
+    uint64_t trames;
+    uint64_t octets_publies;
+} bilan_t;
+
+static void bilan_afficher(const bilan_t *b)
+{
+    fprintf(stderr, "%d poste(s) ; %llu message(s) décodé(s), %llu ignoré(s), %llu octet(s) reçu(s) ; "
+            "%llu trame(s), %llu octet(s) publié(s)\n",
+            flotte.nb_postes, (unsigned long long)flotte.messages, (unsigned long long)flotte.ignores,
+            (unsigned long long)b->octets_recus, (unsigned long long)b->trames,
+            (unsigned long long)b->octets_publies);
+}
+
+// ======================= PASSERELLE =======================
+typedef struct {
+    const char *topic_complet_cmd;
+    bool complet_demande;
+    bilan_t bilan;
+} passerelle_t;
+
+static void sur_message(void *ctx, const char *topic, const uint8_t *payload, size_t len)
+{
+    passerelle_t *p = ctx;
+    if (strcmp(topic, p->topic_complet_cmd) == 0) {
+        p->complet_demande = true;
+        return;
+    }
+    p->bilan.octets_recus += len;
+    flotte_message(&flotte, topic, payload, len, maintenant_ms());
+}
+
+static int publier(mqtt_mini_t *c, passerelle_t *p, const char *topic, bool complet)
+{
+    size_t n = flotte_trame(&flotte, complet, maintenant_ms(), trame, sizeof(trame));
+    if (!n) {
+        if (complet || flotte_modifiee(&flotte)) fprintf(stderr, "Trame trop longue, non publiée\n");
+        return 0;
+    }
+    if (mqtt_mini_publish(c, topic, trame, n, complet) < 0) return -1;
+    p->bilan.trames++;
+    p->bilan.octets_publies += n;
+    return 0;
+}
+
+static int cmd_passerelle(const char *hote, int port, const char *filtre, const char *sortie,
+                          int periode_ms, int complet_s)
+{
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "passbox_flotte_%d", (int)getpid());
+
+    char topic_etat[128], topic_complet[128], topic_cmd[128];
+    snprintf(topic_etat, sizeof(topic_etat), "%setat", sortie);
+    snprintf(topic_complet, sizeof(topic_complet), "%scomplet", sortie);
+    snprintf(topic_cmd, sizeof(topic_cmd), "%scmd/complet", sortie);
+
+    // "<filtre>/cycle/etape"... ou les topics seuls (poste unique)
+    char abonnements[NB_SUIVIS][128];
+    const char *topics[NB_SUIVIS + 1];
+    for (int i = 0; i < NB_SUIVIS; i++) {
+        snprintf(abonnements[i], sizeof(abonnements[i]), "%s%s%s", filtre, filtre[0] ? "/" : "", suivis[i]);
+        topics[i] = abonnements[i];
+    }
+    topics[NB_SUIVIS] = topic_cmd;
+
+    passerelle_t p = { .topic_complet_cmd = topic_cmd };
+    while (!arret) {
+        mqtt_mini_t c;
+        if (mqtt_mini_connect(&c, hote, port, client_id, 30) == 0 &&
+            mqtt_mini_subscribe(&c, topics, NB_SUIVIS + 1) == 0) {
+            fprintf(stderr, "Connecté à %s:%d, trames sur %s toutes les %d ms\n", hote, port, topic_etat, periode_ms);
+            // Après une reconnexion, l'état complet repart d'abord
+            p.complet_demande = true;
+            int64_t prochaine = maintenant_ms();
+            int64_t prochain_complet = prochaine + (int64_t)complet_s * 1000;
+            int ret = 0;
+            while (!arret && ret == 0) {
+                int64_t attente = prochaine - maintenant_ms();
+                if (attente > 0) {
+                    ret = mqtt_mini_loop(&c, (int)attente, sur_message, &p);
+                    continue;
+                }
+                // Période manquée (broker lent) : pas de rattrapage en rafale
+                prochaine += periode_ms;
+                if (prochaine <= maintenant_ms()) prochaine = maintenant_ms() + periode_ms;
+                if (p.complet_demande || (complet_s > 0 && maintenant_ms() >= prochain_complet)) {
+                    // Différentielle d'abord : les abonnés restent à jour,
+                    // la complète porte le seq suivant
+                    ret = publier(&c, &p, topic_etat, false);
+                    if (ret == 0) ret = publier(&c, &p, topic_complet, true);
+                    p.complet_demande = false;
+                    prochain_complet = maintenant_ms() + (int64_t)complet_s * 1000;
+                } else {
+                    ret = publier(&c, &p, topic_etat, false);
+                }
+            }
+        }
+        mqtt_mini_close(&c);
+        if (!arret) {
+            fprintf(stderr, "Connexion perdue, nouvelle tentative dans 5 s\n");
+            sleep(5);
+        }
+    }
+    bilan_afficher(&p.bilan);
+    return 0;
+}
+
+// ======================= REJEU =======================
+static void rejouer_trame(bilan_t *b, const char *sortie, bool complet, int64_t ts)
+{
+    size_t n = flotte_trame(&flotte, complet, ts, trame, sizeof(trame));
+    if (!n) return;
+    printf("%s%s %.*s\n", sortie, complet ? "complet" : "etat", (int)n, trame);
+    b->trames++;
+    b->octets_publies += n;
+}
+
+// Format Node-RED : timestamp,topic,valeur (la valeur peut contenir des virgules)
+static int cmd_rejouer(const char *chemin, const char *sortie, int periode_ms, int complet_s)
+{
+    FILE *f = fopen(chemin, "r");
+    if (!f) {
+        perror(chemin);
+        return 1;
+    }
+
+    bilan_t b = { 0 };
+    char ligne[1024];
+    int64_t prochaine = -1, prochain_complet = 0;
+    while (!arret && fgets(ligne, sizeof(ligne), f)) {
+        ligne[strcspn(ligne, "\r\n")] = '\0';
+        char *topic = strchr(ligne, ',');
+        char *valeur = topic ? strchr(topic + 1, ',') : NULL;
+        int64_t ts;
+        if (!valeur || iso_lire(ligne, &ts) < 0) continue;     // en-tête ou ligne invalide
+        *topic++ = '\0';
+        *valeur++ = '\0';
+
+        if (prochaine < 0) {
+            prochaine = ts - ts % periode_ms + periode_ms;
+            prochain_complet = ts + (int64_t)complet_s * 1000;
+        }
+        // Périodes écoulées avant ce message ; sans changement, aucune trame
+        while (ts >= prochaine) {
+            rejouer_trame(&b, sortie, false, prochaine);
+            if (complet_s > 0 && prochaine >= prochain_complet) {
+                rejouer_trame(&b, sortie, true, prochaine);
+                prochain_complet = prochaine + (int64_t)complet_s * 1000;
+            }
+            prochaine += periode_ms;
+            if (ts >= prochaine) prochaine += (ts - prochaine) / periode_ms * periode_ms;
+        }
+        b.octets_recus += strlen(valeur);
+        flotte_message(&flotte, topic, (const uint8_t *)valeur, strlen(valeur), ts);
+    }
+    fclose(f);
+    if (prochaine >= 0) rejouer_trame(&b, sortie, false, prochaine);
+    bilan_afficher(&b);
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: passbox_flotte passerelle [-h hote] [-p port] [-f filtre] [-s sortie] [-i periode_ms] [-k complet_s]\n"
+            "       passbox_flotte rejouer    [-s sortie] [-i periode_ms] [-k complet_s] fichier.csv\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) usage();
+    const char *cmd = argv[1];
+    const char *hote = "localhost";
+    int port = 1883;
+    const char *filtre = "+/+/+";
+    const char *sortie = "flotte/";
+    int periode_ms = 1000;
+    int complet_s = 60;
+
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "h:p:f:s:i:k:")) != -1) {
+        switch (opt) {
+        case 'h': hote = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'f': filtre = optarg; break;
+        case 's': sortie = optarg; break;
+        case 'i': periode_ms = atoi(optarg); break;
+        case 'k': complet_s = atoi(optarg); break;
+        default: usage();
+        }
+    }
+    if (periode_ms <= 0) usage();
+
+    flotte_init(&flotte);
+    signal(SIGINT, sur_signal);
+    signal(SIGTERM, sur_signal);
+
+    if (strcmp(cmd, "passerelle") == 0) return cmd_passerelle(hote, port, filtre, sortie, periode_ms, complet_s);
+    if (strcmp(cmd, "rejouer") == 0 && optind < argc) return cmd_rejouer(argv[optind], sortie, periode_ms, complet_s);
+    usage();
+    return 2;
+}
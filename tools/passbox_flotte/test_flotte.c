@@ -0,0 +1,192 @@
+// Tests de l'agrégateur de flotte : décodage des topics d'un poste, trames
+// différentielles et complètes, numéros de séquence, buffer trop petit, nom
+// de poste à échapper.
+//
+//   ctest --test-dir build-tools -R flotte
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flotte.h"
+
+static int echecs = 0;
+
+#define VERIFIER(cond)                                                          \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: échec : %s\n", __FILE__, __LINE__, #cond);  \
+            echecs++;                                                           \
+        }                                                                       \
+    } while (0)
+
+#define P07 "usine/salle1/passbox-07/"
+#define P08 "usine/salle1/passbox-08/"
+#define T0  1766100392000LL
+
+static flotte_t f;
+static char trame[65536];
+
+static bool message(const char *topic, const char *valeur, int64_t ts_ms)
+{
+    return flotte_message(&f, topic, (const uint8_t *)valeur, strlen(valeur), ts_ms);
+}
+
+static size_t rendre(bool complet, int64_t ts_ms)
+{
+    size_t n = flotte_trame(&f, complet, ts_ms, trame, sizeof(trame));
+    trame[n] = '\0';
+    return n;
+}
+
+static void test_decodage(void)
+{
+    flotte_init(&f);
+    VERIFIER(message(P07 "cycle/depart", "true", T0));
+    VERIFIER(message(P07 "cycle/etape", "3: Injection produit", T0));
+    VERIFIER(message(P07 "porte/sterile", "false", T0));
+    VERIFIER(message(P07 "mesures", "{\"pression_pa\":-48,\"h2o2_ppm\":310,\"humidite\":41.5,\"temperature\":22.3}", T0));
+    VERIFIER(message(P07 "reponse", "{\"id\":null,\"commande\":\"cmd/cycle/depart\",\"resultat\":\"nack\",\"code\":2,"
+                                    "\"raison\":\"portes_ouvertes\",\"latence_us\":120}", T0));
+    VERIFIER(message(P07 "ota", "{\"etat\":\"reception\",\"recu\":4096,\"taille\":48213}", T0));
+    VERIFIER(message(P08 "cycle/etape", "Erreur: porte \"sterile\" ouverte", T0 + 1500));
+    VERIFIER(message("urgence", "true", T0));                                     // poste unique
+
+    // Valeurs invalides, commandes et topics non suivis : ignorés
+    VERIFIER(!message(P07 "urgence", "peut-etre", T0));
+    VERIFIER(!message(P07 "mesures", "{}", T0));
+    VERIFIER(!message(P07 "cmd/urgence", "true", T0));
+    VERIFIER(!message("cmd/urgence", "true", T0));
+    VERIFIER(!message(P07 "cmd/cycle/depart", "ON", T0));
+    VERIFIER(!message(P07 "stats", "{}", T0));
+    VERIFIER(f.messages == 8 && f.ignores == 6);
+    VERIFIER(f.nb_postes == 3);
+
+    const flotte_poste_t *p = &f.postes[0];
+    VERIFIER(strcmp(p->nom, "usine/salle1/passbox-07") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_CYCLE], "true") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_ETAPE], "3") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_ERREUR], "null") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_PORTE_STERILE], "false") == 0);
+    VERIFIER(p->valeurs[CHAMP_PORTE_CONTAMINEE][0] == '\0');
+    VERIFIER(strcmp(p->valeurs[CHAMP_PRESSION], "-48") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_HUMIDITE], "41.5") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_REFUS], "\"portes_ouvertes\"") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_OTA], "\"reception\"") == 0);
+    VERIFIER(strcmp(p->valeurs[CHAMP_VU], "1766100392") == 0);
+
+    p = &f.postes[1];
+    VERIFIER(strcmp(p->valeurs[CHAMP_ERREUR], "\"porte \\\"sterile\\\" ouverte\"") == 0);
+    VERIFIER(p->valeurs[CHAMP_ETAPE][0] == '\0');
+    VERIFIER(strcmp(p->valeurs[CHAMP_VU], "1766100393") == 0);
+    VERIFIER(strcmp(f.postes[2].nom, "") == 0);
+
+    // Ack : le refus précédent s'efface
+    VERIFIER(message(P07 "reponse", "{\"id\":\"42\",\"commande\":\"cmd/cycle/depart\",\"resultat\":\"ack\"}", T0));
+    VERIFIER(strcmp(f.postes[0].valeurs[CHAMP_REFUS], "null") == 0);
+}
+
+static void test_trames(void)
+{
+    flotte_init(&f);
+    VERIFIER(!flotte_modifiee(&f));
+    VERIFIER(rendre(false, T0) == 0);
+
+    message(P07 "cycle/etape", "1: Extraction air", T0);
+    message(P08 "urgence", "false", T0);
+    VERIFIER(rendre(false, T0 + 1000) > 0);
+    VERIFIER(strcmp(trame, "{\"seq\":1,\"t\":1766100393000,\"postes\":{"
+                           "\"usine/salle1/passbox-07\":{\"etape\":1,\"erreur\":null,\"vu\":1766100392},"
+                           "\"usine/salle1/passbox-08\":{\"urgence\":false,\"vu\":1766100392}}}") == 0);
+
+    // Rien de changé : pas de trame, seq inchangé ; même valeur reçue : idem
+    VERIFIER(rendre(false, T0 + 2000) == 0);
+    message(P08 "urgence", "false", T0);
+    VERIFIER(!flotte_modifiee(&f));
+    VERIFIER(f.seq == 1);
+
+    // Seuls les champs modifiés
+    message(P07 "cycle/etape", "2: Arret air", T0 + 2500);
+    VERIFIER(rendre(false, T0 + 3000) > 0);
+    VERIFIER(strcmp(trame, "{\"seq\":2,\"t\":1766100395000,\"postes\":{"
+                           "\"usine/salle1/passbox-07\":{\"etape\":2,\"vu\":1766100394}}}") == 0);
+
+    // Complète : tous les champs connus, seq suivant
+    VERIFIER(rendre(true, T0 + 4000) > 0);
+    VERIFIER(strcmp(trame, "{\"seq\":3,\"t\":1766100396000,\"complet\":true,\"postes\":{"
+                           "\"usine/salle1/passbox-07\":{\"etape\":2,\"erreur\":null,\"vu\":1766100394},"
+                           "\"usine/salle1/passbox-08\":{\"urgence\":false,\"vu\":1766100392}}}") == 0);
+    VERIFIER(!flotte_modifiee(&f));
+}
+
+// Buffer trop petit : rien de rendu, changements et seq gardés
+static void test_buffer_petit(void)
+{
+    flotte_init(&f);
+    message(P07 "cycle/etape", "4: Pause sterilisation", T0);
+    message(P07 "mesures", "{\"pression_pa\":-52,\"h2o2_ppm\":420}", T0);
+    uint32_t modifies = f.postes[0].modifies;
+
+    char petit[40];
+    VERIFIER(flotte_trame(&f, false, T0, petit, sizeof(petit)) == 0);
+    VERIFIER(flotte_trame(&f, true, T0, petit, sizeof(petit)) == 0);
+    VERIFIER(f.postes[0].modifies == modifies);
+    VERIFIER(f.seq == 0);
+    VERIFIER(flotte_modifiee(&f));
+
+    size_t n = rendre(false, T0);
+    VERIFIER(n > sizeof(petit));
+    VERIFIER(strstr(trame, "\"seq\":1,") != NULL);
+    VERIFIER(strstr(trame, "\"pression_pa\":-52,\"h2o2_ppm\":420") != NULL);
+
+    // Taille exacte : n + 1 suffit (terminateur compris), n non
+    message(P07 "cycle/etape", "5: Extraction produit", T0);
+    char exact[256];
+    size_t attendu = strlen("{\"seq\":2,\"t\":1766100392000,\"postes\":{\"usine/salle1/passbox-07\":{\"etape\":5}}}");
+    VERIFIER(flotte_trame(&f, false, T0, exact, attendu) == 0);
+    VERIFIER(flotte_trame(&f, false, T0, exact, attendu + 1) == attendu);
+    VERIFIER(f.seq == 2);
+}
+
+// Guillemet et antislash dans le topic : nom de poste échappé dans la trame
+static void test_nom_echappe(void)
+{
+    flotte_init(&f);
+    VERIFIER(message("usine/salle\"1\\/passbox-09/urgence", "true", T0));
+    VERIFIER(strcmp(f.postes[0].nom, "usine/salle\"1\\/passbox-09") == 0);
+    VERIFIER(rendre(false, T0) > 0);
+    VERIFIER(strcmp(trame, "{\"seq\":1,\"t\":1766100392000,\"postes\":{"
+                           "\"usine/salle\\\"1\\\\/passbox-09\":{\"urgence\":true,\"vu\":1766100392}}}") == 0);
+}
+
+// Table pleine : postes suivants ignorés, les connus toujours suivis
+static void test_table_pleine(void)
+{
+    flotte_init(&f);
+    char topic[64];
+    for (int i = 0; i < FLOTTE_NB_POSTES; i++) {
+        snprintf(topic, sizeof(topic), "usine/salle%d/passbox-%02d/urgence", i / 16, i % 16);
+        VERIFIER(message(topic, "false", T0));
+    }
+    VERIFIER(f.nb_postes == FLOTTE_NB_POSTES);
+    VERIFIER(!message("usine/salle99/passbox-00/urgence", "true", T0));
+    VERIFIER(f.ignores == 1);
+    VERIFIER(message("usine/salle3/passbox-05/urgence", "true", T0));
+    VERIFIER(strcmp(f.postes[3 * 16 + 5].valeurs[CHAMP_URGENCE], "true") == 0);
+}
+
+int main(void)
+{
+    test_decodage();
+    test_trames();
+    test_buffer_petit();
+    test_nom_echappe();
+    test_table_pleine();
+
+    if (echecs) {
+        fprintf(stderr, "%d échec(s)\n", echecs);
+        return 1;
+    }
+    printf("flotte : OK\n");
+    return 0;
+}
@@ -0,0 +1,365 @@
+#include "delta.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "ota_delta.h"
+
+// ======================= TAMPON =======================
+int tampon_ajouter(tampon_t *t, const void *p, size_t n)
+{
+    if (t->len + n > t->taille) {
+        size_t taille = t->taille ? t->taille : 65536;
+        while (taille < t->len + n) taille *= 2;
+        uint8_t *buf = realloc(t->buf, taille);
+        if (!buf) return -1;
+        t->buf = buf;
+        t->taille = taille;
+    }
+    memcpy(t->buf + t->len, p, n);
+    t->len += n;
+    return 0;
+}
+
+static void u32_ecrire(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// ======================= TRI DES SUFFIXES =======================
+// qsufsort (Larsson & Sadakane), comme bsdiff : I tableau des suffixes de
+// l'ancienne image, V rangs de travail
+static void split(int64_t *I, int64_t *V, int64_t debut, int64_t len, int64_t h)
+{
+    int64_t i, j, k, x, tmp, jj, kk;
+
+    if (len < 16) {
+        for (k = debut; k < debut + len; k += j) {
+            j = 1;
+            x = V[I[k] + h];
+            for (i = 1; k + i < debut + len; i++) {
+                if (V[I[k + i] + h] < x) {
+                    x = V[I[k + i] + h];
+                    j = 0;
+                }
+                if (V[I[k + i] + h] == x) {
+                    tmp = I[k + j];
+                    I[k + j] = I[k + i];
+                    I[k + i] = tmp;
+                    j++;
+                }
+            }
+            for (i = 0; i < j; i++) V[I[k + i]] = k + j - 1;
+            if (j == 1) I[k] = -1;
+        }
+        return;
+    }
+
+    x = V[I[debut + len / 2] + h];
+    jj = 0;
+    kk = 0;
+    for (i = debut; i < debut + len; i++) {
+        if (V[I[i] + h] < x) jj++;
+        if (V[I[i] + h] == x) kk++;
+    }
+    jj += debut;
+    kk += jj;
+
+    i = debut;
+    j = 0;
+    k = 0;
+    while (i < jj) {
+        if (V[I[i] + h] < x) {
+            i++;
+        } else if (V[I[i] + h] == x) {
+            tmp = I[i];
+            I[i] = I[jj + j];
+            I[jj + j] = tmp;
+            j++;
+        } else {
+            tmp = I[i];
+            I[i] = I[kk + k];
+            I[kk + k] = tmp;
+            k++;
+        }
+    }
+    while (jj + j < kk) {
+        if (V[I[jj + j] + h] == x) {
+            j++;
+        } else {
+            tmp = I[jj + j];
+            I[jj + j] = I[kk + k];
+            I[kk + k] = tmp;
+            k++;
+        }
+    }
+
+    if (jj > debut) split(I, V, debut, jj - debut, h);
+    for (i = 0; i < kk - jj; i++) V[I[jj + i]] = kk - 1;
+    if (jj == kk - 1) I[jj] = -1;
+    if (debut + len > kk) split(I, V, kk, debut + len - kk, h);
+}
+
+static void qsufsort(int64_t *I, int64_t *V, const uint8_t *old, int64_t n)
+{
+    int64_t buckets[256] = { 0 };
+    int64_t i, h, len;
+
+    for (i = 0; i < n; i++) buckets[old[i]]++;
+    for (i = 1; i < 256; i++) buckets[i] += buckets[i - 1];
+    for (i = 255; i > 0; i--) buckets[i] = buckets[i - 1];
+    buckets[0] = 0;
+
+    for (i = 0; i < n; i++) I[++buckets[old[i]]] = i;
+    I[0] = n;
+    for (i = 0; i < n; i++) V[i] = buckets[old[i]];
+    V[n] = 0;
+    for (i = 1; i < 256; i++) {
+        if (buckets[i] == buckets[i - 1] + 1) I[buckets[i]] = -1;
+    }
+    I[0] = -1;
+
+    for (h = 1; I[0] != -(n + 1); h += h) {
+        len = 0;
+        for (i = 0; i < n + 1;) {
+            if (I[i] < 0) {
+                len -= I[i];
+                i -= I[i];
+            } else {
+                if (len) I[i - len] = -len;
+                len = V[I[i]] + 1 - i;
+                split(I, V, i, len, h);
+                i += len;
+                len = 0;
+            }
+        }
+        if (len) I[i - len] = -len;
+    }
+
+    for (i = 0; i < n + 1; i++) I[V[i]] = i;
+}
+
+static int64_t longueur_commune(const uint8_t *a, int64_t na, const uint8_t *b, int64_t nb)
+{
+    int64_t i;
+    for (i = 0; i < na && i < nb; i++) {
+        if (a[i] != b[i]) break;
+    }
+    return i;
+}
+
+// Plus longue correspondance de new dans old, par dichotomie sur I
+static int64_t chercher(const int64_t *I, const uint8_t *old, int64_t n_old, const uint8_t *new, int64_t n_new,
+                        int64_t debut, int64_t fin, int64_t *pos)
+{
+    while (fin - debut >= 2) {
+        int64_t m = debut + (fin - debut) / 2;
+        int64_t n = n_old - I[m] < n_new ? n_old - I[m] : n_new;
+        if (memcmp(old + I[m], new, (size_t)n) < 0) {
+            debut = m;
+        } else {
+            fin = m;
+        }
+    }
+    int64_t x = longueur_commune(old + I[debut], n_old - I[debut], new, n_new);
+    int64_t y = longueur_commune(old + I[fin], n_old - I[fin], new, n_new);
+    *pos = x > y ? I[debut] : I[fin];
+    return x > y ? x : y;
+}
+
+// ======================= PATCH =======================
+static int enregistrer(tampon_t *corps, const uint8_t *old, const uint8_t *new, int64_t ancien, int64_t nouveau,
+                       int64_t diff, int64_t extra, int64_t saut)
+{
+    uint8_t enreg[OTA_DELTA_ENREG];
+    u32_ecrire(enreg, (uint32_t)diff);
+    u32_ecrire(enreg + 4, (uint32_t)extra);
+    u32_ecrire(enreg + 8, (uint32_t)(int32_t)saut);
+    if (tampon_ajouter(corps, enreg, sizeof(enreg)) < 0) return -1;
+    for (int64_t i = 0; i < diff; i++) {
+        uint8_t d = (uint8_t)(new[nouveau + i] - old[ancien + i]);
+        if (tampon_ajouter(corps, &d, 1) < 0) return -1;
+    }
+    return tampon_ajouter(corps, new + nouveau + diff, (size_t)extra);
+}
+
+// Enregistrements non compressés : boucle principale de bsdiff
+static int calculer(const uint8_t *old, int64_t n_old, const uint8_t *new, int64_t n_new, tampon_t *corps)
+{
+    int64_t *I = malloc((size_t)(n_old + 1) * sizeof(int64_t));
+    int64_t *V = malloc((size_t)(n_old + 1) * sizeof(int64_t));
+    if (!I || !V) {
+        free(I);
+        free(V);
+        return -1;
+    }
+    qsufsort(I, V, old, n_old);
+    free(V);
+
+    int64_t scan = 0, len = 0, pos = 0;
+    int64_t lastscan = 0, lastpos = 0, lastoffset = 0;
+    int erreur = 0;
+
+    while (scan < n_new && !erreur) {
+        int64_t oldscore = 0;
+        int64_t scsc;
+        for (scsc = scan += len; scan < n_new; scan++) {
+            len = chercher(I, old, n_old, new + scan, n_new - scan, 0, n_old, &pos);
+            for (; scsc < scan + len; scsc++) {
+                if (scsc + lastoffset < n_old && old[scsc + lastoffset] == new[scsc]) oldscore++;
+            }
+            if ((len == oldscore && len != 0) || len > oldscore + 8) break;
+            if (scan + lastoffset < n_old && old[scan + lastoffset] == new[scan]) oldscore--;
+        }
+
+        if (len == oldscore && scan != n_new) continue;
+
+        // Extension de la correspondance précédente vers l'avant...
+        int64_t s = 0, sf = 0, lenf = 0;
+        for (int64_t i = 0; lastscan + i < scan && lastpos + i < n_old;) {
+            if (old[lastpos + i] == new[lastscan + i]) s++;
+            i++;
+            if (s * 2 - i > sf * 2 - lenf) {
+                sf = s;
+                lenf = i;
+            }
+        }
+
+        // ...de la suivante vers l'arrière
+        int64_t lenb = 0;
+        if (scan < n_new) {
+            int64_t sb = 0;
+            s = 0;
+            for (int64_t i = 1; scan >= lastscan + i && pos >= i; i++) {
+                if (old[pos - i] == new[scan - i]) s++;
+                if (s * 2 - i > sb * 2 - lenb) {
+                    sb = s;
+                    lenb = i;
+                }
+            }
+        }
+
+        // Chevauchement : partagé au mieux
+        if (lastscan + lenf > scan - lenb) {
+            int64_t overlap = (lastscan + lenf) - (scan - lenb);
+            int64_t ss = 0, lens = 0;
+            s = 0;
+            for (int64_t i = 0; i < overlap; i++) {
+                if (new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]) s++;
+                if (new[scan - lenb + i] == old[pos - lenb + i]) s--;
+                if (s > ss) {
+                    ss = s;
+                    lens = i + 1;
+                }
+            }
+            lenf += lens - overlap;
+            lenb -= lens;
+        }
+
+        erreur = enregistrer(corps, old, new, lastpos, lastscan, lenf, (scan - lenb) - (lastscan + lenf),
+                             (pos - lenb) - (lastpos + lenf));
+
+        lastscan = scan - lenb;
+        lastpos = pos - lenb;
+        lastoffset = pos - scan;
+    }
+
+    free(I);
+    return erreur;
+}
+
+int delta_calculer(const uint8_t *old, size_t n_old, const uint8_t *new, size_t n_new, tampon_t *patch)
+{
+    tampon_t corps = { 0 };
+    if (calculer(old, (int64_t)n_old, new, (int64_t)n_new, &corps) < 0) {
+        free(corps.buf);
+        return -1;
+    }
+
+    uint8_t entete[OTA_DELTA_ENTETE];
+    ota_delta_entete_t e = {
+        .taille_base = (uint32_t)n_old,
+        .crc_base = (uint32_t)crc32(0, old, (uInt)n_old),
+        .taille_image = (uint32_t)n_new,
+    };
+    ota_delta_ecrire_entete(&e, entete);
+
+    uLongf n_z = compressBound((uLong)corps.len);
+    uint8_t *z = malloc(n_z);
+    int ret = -1;
+    if (z && compress2(z, &n_z, corps.buf, (uLong)corps.len, Z_BEST_COMPRESSION) == Z_OK &&
+        tampon_ajouter(patch, entete, sizeof(entete)) == 0 && tampon_ajouter(patch, z, n_z) == 0) {
+        ret = 0;
+    }
+    free(z);
+    free(corps.buf);
+    return ret;
+}
+
+// ======================= APPLICATION =======================
+// Application d'un patch en mémoire avec le code du poste (main/ota_delta.c)
+typedef struct {
+    const uint8_t *base;
+    tampon_t sortie;
+} application_t;
+
+static int lire_base(void *ctx, uint32_t position, uint8_t *buf, size_t len)
+{
+    application_t *a = ctx;
+    memcpy(buf, a->base + position, len);
+    return 0;
+}
+
+static int ecrire_sortie(void *ctx, const uint8_t *buf, size_t len)
+{
+    application_t *a = ctx;
+    return tampon_ajouter(&a->sortie, buf, len);
+}
+
+int delta_appliquer(const uint8_t *old, size_t n_old, const uint8_t *patch, size_t n_patch, size_t morceau,
+                    tampon_t *sortie)
+{
+    ota_delta_entete_t e;
+    if (n_patch < OTA_DELTA_ENTETE || !ota_delta_lire_entete(patch, &e)) {
+        fprintf(stderr, "pas un patch Pass-Box\n");
+        return -1;
+    }
+    if (e.taille_base != n_old || crc32(0, old, (uInt)n_old) != e.crc_base) {
+        fprintf(stderr, "patch calculé pour une autre image de base\n");
+        return -1;
+    }
+
+    application_t a = { .base = old };
+    ota_delta_t d;
+    ota_delta_init(&d, &e, lire_base, ecrire_sortie, &a);
+
+    // Par petits morceaux, comme sur le poste
+    z_stream z = { 0 };
+    inflateInit(&z);
+    z.next_in = (Bytef *)patch + OTA_DELTA_ENTETE;
+    z.avail_in = (uInt)(n_patch - OTA_DELTA_ENTETE);
+    uint8_t buf[4096];
+    if (morceau == 0 || morceau > sizeof(buf)) morceau = sizeof(buf);
+    int ret = Z_OK, err = 0;
+    while (ret == Z_OK && !err) {
+        z.next_out = buf;
+        z.avail_out = (uInt)morceau;
+        ret = inflate(&z, Z_NO_FLUSH);
+        if (ret == Z_OK || ret == Z_STREAM_END) err = ota_delta_appliquer(&d, buf, morceau - z.avail_out);
+    }
+    inflateEnd(&z);
+
+    if (ret != Z_STREAM_END || err || z.avail_in || !ota_delta_termine(&d)) {
+        fprintf(stderr, "patch invalide\n");
+        free(a.sortie.buf);
+        return -1;
+    }
+    *sortie = a.sortie;
+    return 0;
+}
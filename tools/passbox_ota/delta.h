@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ======================= PATCH DIFFERENTIEL =======================
+// Calcul d'un patch (format dans main/ota_delta.h) par l'algorithme de
+// bsdiff : tri des suffixes de l'ancienne image, correspondances approchées,
+// corps compressé en zlib. Application en mémoire avec le code du poste
+// (main/ota_delta.c), pour vérifier un patch avant de l'envoyer.
+
+// Tampon extensible
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t taille;
+} tampon_t;
+
+int tampon_ajouter(tampon_t *t, const void *p, size_t n);
+
+// Patch complet (en-tête et corps compressé) de old vers new, dans patch
+// (vide au départ) ; -1 si mémoire insuffisante ou compression impossible
+int delta_calculer(const uint8_t *old, size_t n_old, const uint8_t *new, size_t n_new, tampon_t *patch);
+
+// Nouvelle image reconstituée dans sortie (vide au départ). Le corps est
+// décompressé et passé à ota_delta_appliquer par morceaux de morceau
+// octets au plus, comme le poste le reçoit. -1 (message sur stderr) si le
+// patch n'est pas pour cette base ou est invalide.
+int delta_appliquer(const uint8_t *old, size_t n_old, const uint8_t *patch, size_t n_patch, size_t morceau,
+                    tampon_t *sortie);
@@ -0,0 +1,317 @@
+// Mise à jour du Pass-Box par MQTT : patch différentiel entre deux images,
+// vérification d'un patch, envoi d'une image ou d'un patch à un poste.
+//
+//   passbox_ota delta     ancienne.bin nouvelle.bin patch.pbd
+//   passbox_ota appliquer ancienne.bin patch.pbd sortie.bin
+//   passbox_ota envoyer   [-h hote] [-p port] [-t prefixe] [-b bloc] fichier
+//
+// Le patch (format dans main/ota_delta.h, calcul dans delta.c) suit
+// l'algorithme de bsdiff (tri des suffixes de l'ancienne image,
+// correspondances approchées) et est compressé en zlib, que le poste
+// décompresse avec l'inflateur de la ROM.
+// envoyer reconnaît un patch à son en-tête, une image à son octet magique ;
+// les blocs partent un par un, chacun acquitté par le poste sur <prefixe>ota.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "delta.h"
+#include "mqtt_mini.h"
+#include "ota_delta.h"
+
+#define IMAGE_MAGIC         0xE9        // en-tête d'image ESP-IDF
+#define ESSAIS_BLOC         5
+#define ATTENTE_BLOC_MS     5000
+#define ATTENTE_FIN_MS      60000       // vérification de la signature comprise
+
+// ======================= FICHIERS =======================
+static uint8_t *lire_fichier(const char *chemin, size_t *taille)
+{
+    FILE *f = fopen(chemin, "rb");
+    if (!f) {
+        perror(chemin);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(n > 0 ? (size_t)n : 1);
+    if (!buf || fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        fprintf(stderr, "%s : lecture impossible\n", chemin);
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *taille = (size_t)n;
+    return buf;
+}
+
+static int ecrire_fichier(const char *chemin, const uint8_t *buf, size_t taille)
+{
+    FILE *f = fopen(chemin, "wb");
+    if (!f || fwrite(buf, 1, taille, f) != taille || fclose(f) != 0) {
+        perror(chemin);
+        return -1;
+    }
+    return 0;
+}
+
+static void u32_ecrire(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// ======================= PATCH =======================
+static int cmd_delta(const char *chemin_old, const char *chemin_new, const char *chemin_patch)
+{
+    size_t n_old, n_new;
+    uint8_t *old = lire_fichier(chemin_old, &n_old);
+    uint8_t *new = old ? lire_fichier(chemin_new, &n_new) : NULL;
+    if (!new) {
+        free(old);
+        return 1;
+    }
+
+    tampon_t patch = { 0 }, verif = { 0 };
+    int ret = 1;
+    if (delta_calculer(old, n_old, new, n_new, &patch) < 0) {
+        fprintf(stderr, "mémoire insuffisante ou compression impossible\n");
+        goto fin;
+    }
+
+    // Relu comme le poste le ferait avant d'être écrit
+    if (delta_appliquer(old, n_old, patch.buf, patch.len, 0, &verif) == 0 && verif.len == n_new &&
+        memcmp(verif.buf, new, n_new) == 0 && ecrire_fichier(chemin_patch, patch.buf, patch.len) == 0) {
+        printf("%s : %zu octets (image %zu octets, %.1f %%)\n", chemin_patch, patch.len, n_new,
+               n_new ? 100.0 * patch.len / n_new : 0.0);
+        ret = 0;
+    } else {
+        fprintf(stderr, "vérification du patch échouée\n");
+    }
+fin:
+    free(verif.buf);
+    free(patch.buf);
+    free(old);
+    free(new);
+    return ret;
+}
+
+static int cmd_appliquer(const char *chemin_old, const char *chemin_patch, const char *chemin_sortie)
+{
+    size_t n_old, n_patch;
+    uint8_t *old = lire_fichier(chemin_old, &n_old);
+    uint8_t *patch = old ? lire_fichier(chemin_patch, &n_patch) : NULL;
+    tampon_t sortie = { 0 };
+    int ret = 1;
+    if (patch && delta_appliquer(old, n_old, patch, n_patch, 0, &sortie) == 0 &&
+        ecrire_fichier(chemin_sortie, sortie.buf, sortie.len) == 0) {
+        printf("%s : %zu octets\n", chemin_sortie, sortie.len);
+        ret = 0;
+    }
+    free(sortie.buf);
+    free(patch);
+    free(old);
+    return ret;
+}
+
+// ======================= ENVOI =======================
+typedef struct {
+    const char *topic;
+    char etat[24];
+    long recu;
+    char raison[64];
+    bool nouveau;
+} reponse_t;
+
+static void json_chaine(const char *json, const char *cle, char *buf, size_t len)
+{
+    char motif[32];
+    snprintf(motif, sizeof(motif), "\"%s\":\"", cle);
+    const char *p = strstr(json, motif);
+    buf[0] = '\0';
+    if (!p) return;
+    p += strlen(motif);
+    size_t n = strcspn(p, "\"");
+    if (n >= len) n = len - 1;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+}
+
+static void sur_reponse(void *ctx, const char *topic, const uint8_t *payload, size_t len)
+{
+    reponse_t *r = ctx;
+    if (strcmp(topic, r->topic) != 0) return;
+
+    char json[512];
+    if (len >= sizeof(json)) len = sizeof(json) - 1;
+    memcpy(json, payload, len);
+    json[len] = '\0';
+
+    json_chaine(json, "etat", r->etat, sizeof(r->etat));
+    json_chaine(json, "raison", r->raison, sizeof(r->raison));
+    const char *recu = strstr(json, "\"recu\":");
+    r->recu = recu ? atol(recu + 7) : -1;
+    r->nouveau = true;
+    if (strcmp(r->etat, "reception") != 0) fprintf(stderr, "  %s\n", json);
+}
+
+static int64_t horloge_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Prochaine réponse du poste ; false au délai dépassé ou connexion perdue
+static bool attendre(mqtt_mini_t *c, reponse_t *r, int delai_ms)
+{
+    int64_t fin = horloge_ms() + delai_ms;
+    r->nouveau = false;
+    while (!r->nouveau) {
+        int64_t reste = fin - horloge_ms();
+        if (reste <= 0) return false;
+        if (mqtt_mini_loop(c, (int)(reste < 200 ? reste : 200), sur_reponse, r) < 0) return false;
+        // "active" : état publié à la reconnexion du poste, sans rapport
+        if (r->nouveau && strcmp(r->etat, "active") == 0) r->nouveau = false;
+    }
+    return true;
+}
+
+static int cmd_envoyer(const char *hote, int port, const char *prefixe, size_t bloc, const char *chemin)
+{
+    size_t taille;
+    uint8_t *image = lire_fichier(chemin, &taille);
+    if (!image) return 1;
+
+    const char *format;
+    if (taille >= OTA_DELTA_ENTETE && memcmp(image, OTA_DELTA_MAGIC, 4) == 0) {
+        format = "delta";
+    } else if (taille > 0 && image[0] == IMAGE_MAGIC) {
+        format = "image";
+    } else {
+        fprintf(stderr, "%s : ni image ESP-IDF ni patch\n", chemin);
+        free(image);
+        return 1;
+    }
+
+    char topic_etat[128], topic_cmd[128], topic_bloc[128];
+    snprintf(topic_etat, sizeof(topic_etat), "%sota", prefixe);
+    snprintf(topic_cmd, sizeof(topic_cmd), "%scmd/ota", prefixe);
+    snprintf(topic_bloc, sizeof(topic_bloc), "%scmd/ota/bloc", prefixe);
+
+    mqtt_mini_t c;
+    char id[32];
+    snprintf(id, sizeof(id), "passbox_ota_%d", (int)getpid());
+    if (mqtt_mini_connect(&c, hote, port, id, 30) < 0) {
+        free(image);
+        return 1;
+    }
+    const char *abonnement[] = { topic_etat };
+    mqtt_mini_subscribe(&c, abonnement, 1);
+
+    reponse_t r = { .topic = topic_etat };
+    uint8_t *message = malloc(4 + bloc);
+    int ret = 1;
+    int64_t debut = horloge_ms();
+
+    char requete[64];
+    snprintf(requete, sizeof(requete), "taille=%zu\nformat=%s", taille, format);
+    mqtt_mini_publish(&c, topic_cmd, requete, strlen(requete), false);
+    if (!attendre(&c, &r, ATTENTE_BLOC_MS) || strcmp(r.etat, "pret") != 0) {
+        fprintf(stderr, "poste muet ou refus\n");
+        goto fin;
+    }
+    printf("Envoi %s de %zu octets vers %s, blocs de %zu\n", format, taille, prefixe[0] ? prefixe : "(sans préfixe)",
+           bloc);
+
+    // Un bloc à la fois : l'accusé donne la prochaine position attendue,
+    // bloc renvoyé à défaut d'accusé
+    size_t position = 0;
+    int essais = 0;
+    while (position < taille) {
+        size_t n = taille - position < bloc ? taille - position : bloc;
+        u32_ecrire(message, (uint32_t)position);
+        memcpy(message + 4, image + position, n);
+        if (mqtt_mini_publish(&c, topic_bloc, message, 4 + n, false) < 0) goto fin;
+
+        if (!attendre(&c, &r, ATTENTE_BLOC_MS)) {
+            if (++essais >= ESSAIS_BLOC) {
+                fprintf(stderr, "\nplus d'accusé à la position %zu\n", position);
+                goto fin;
+            }
+            continue;
+        }
+        if (strcmp(r.etat, "reception") != 0 || r.recu < 0 || (size_t)r.recu > taille) goto fin;
+        essais = 0;
+        position = (size_t)r.recu;
+        fprintf(stderr, "\r  %zu / %zu", position, taille);
+    }
+    fprintf(stderr, "\n");
+
+    mqtt_mini_publish(&c, topic_cmd, "fin", 3, false);
+    if (attendre(&c, &r, ATTENTE_FIN_MS) && strcmp(r.etat, "termine") == 0) {
+        printf("Terminé en %.1f s ; validation au redémarrage (état publié sur %s)\n",
+               (horloge_ms() - debut) / 1000.0, topic_etat);
+        ret = 0;
+    } else {
+        fprintf(stderr, "échec de la fin de transfert\n");
+    }
+
+fin:
+    if (ret != 0 && r.raison[0]) fprintf(stderr, "raison : %s\n", r.raison);
+    free(message);
+    free(image);
+    mqtt_mini_close(&c);
+    return ret;
+}
+
+// ======================= MAIN =======================
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: passbox_ota delta     ancienne.bin nouvelle.bin patch.pbd\n"
+            "       passbox_ota appliquer ancienne.bin patch.pbd sortie.bin\n"
+            "       passbox_ota envoyer   [-h hote] [-p port] [-t prefixe] [-b bloc] fichier\n"
+            "  prefixe : topics du poste, ex. usine/salle1/passbox-07/ (vide sans site)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) usage();
+    const char *cmd = argv[1];
+    const char *hote = "broker.hivemq.com";
+    int port = 1883;
+    const char *prefixe = "";
+    size_t bloc = 4096;
+
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "h:p:t:b:")) != -1) {
+        switch (opt) {
+        case 'h': hote = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 't': prefixe = optarg; break;
+        case 'b': bloc = (size_t)atol(optarg); break;
+        default: usage();
+        }
+    }
+    if (bloc < 256 || bloc > 65536) usage();
+
+    int nb = argc - optind;
+    if (strcmp(cmd, "delta") == 0 && nb == 3) {
+        return cmd_delta(argv[optind], argv[optind + 1], argv[optind + 2]);
+    } else if (strcmp(cmd, "appliquer") == 0 && nb == 3) {
+        return cmd_appliquer(argv[optind], argv[optind + 1], argv[optind + 2]);
+    } else if (strcmp(cmd, "envoyer") == 0 && nb == 1) {
+        return cmd_envoyer(hote, port, prefixe, bloc, argv[optind]);
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,211 @@
+// Tests du patch différentiel : calcul puis application avec le code du
+// poste (main/ota_delta.c), corps découpé en morceaux de toutes tailles
+// comme les blocs reçus, refus d'une autre base ou d'un patch abîmé.
+//
+//   ctest --test-dir build-tools -R ota_delta
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "delta.h"
+#include "ota_delta.h"
+
+static int echecs = 0;
+
+#define VERIFIER(cond)                                                          \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: échec : %s\n", __FILE__, __LINE__, #cond);  \
+            echecs++;                                                           \
+        }                                                                       \
+    } while (0)
+
+#define TAILLE_BASE     (192 * 1024)
+
+static uint32_t graine = 12345;
+
+static uint8_t aleatoire(void)
+{
+    graine = graine * 1103515245u + 12345u;
+    return (uint8_t)(graine >> 16);
+}
+
+// Base : code répétitif (motifs de 16 octets) et données aléatoires
+static uint8_t *base_creer(size_t n)
+{
+    uint8_t *b = malloc(n);
+    for (size_t i = 0; i < n; i++) b[i] = i % 4096 < 3072 ? (uint8_t)(i % 16 * 7 + i / 4096) : aleatoire();
+    return b;
+}
+
+// Nouvelle version : octets modifiés, adresses décalées d'une constante
+// (relocation), insertion, suppression, ajout en fin
+static uint8_t *nouvelle_creer(const uint8_t *base, size_t n_base, size_t *n)
+{
+    uint8_t *b = malloc(n_base + 8192);
+    size_t k = 0;
+    memcpy(b + k, base, 20000);
+    k += 20000;
+    for (size_t i = 0; i < 100; i++) b[i * 97] ^= 0x5A;
+    for (size_t i = 20000; i < 60000; i++) b[k++] = (uint8_t)(base[i] + (i % 4 == 0 ? 0x10 : 0));
+    for (size_t i = 0; i < 3000; i++) b[k++] = aleatoire();                         // insertion
+    memcpy(b + k, base + 70000, n_base - 70000);                                    // 10000 supprimés
+    k += n_base - 70000;
+    for (size_t i = 0; i < 4000; i++) b[k++] = aleatoire();                         // ajout
+    *n = k;
+    return b;
+}
+
+static bool identique(const tampon_t *t, const uint8_t *b, size_t n)
+{
+    return t->len == n && memcmp(t->buf, b, n) == 0;
+}
+
+static void test_aller_retour(const uint8_t *base, size_t n_base, const uint8_t *nouv, size_t n_nouv)
+{
+    tampon_t patch = { 0 };
+    VERIFIER(delta_calculer(base, n_base, nouv, n_nouv, &patch) == 0);
+    VERIFIER(patch.len < n_nouv / 4);
+
+    ota_delta_entete_t e;
+    VERIFIER(ota_delta_lire_entete(patch.buf, &e));
+    VERIFIER(e.taille_base == n_base && e.taille_image == n_nouv);
+    VERIFIER(e.crc_base == (uint32_t)crc32(0, base, (uInt)n_base));
+
+    // 1 et 13 : en-têtes d'enregistrement à cheval sur deux morceaux
+    const size_t morceaux[] = { 4096, 1, 5, OTA_DELTA_ENREG + 1, 1000 };
+    for (size_t i = 0; i < sizeof(morceaux) / sizeof(morceaux[0]); i++) {
+        tampon_t sortie = { 0 };
+        VERIFIER(delta_appliquer(base, n_base, patch.buf, patch.len, morceaux[i], &sortie) == 0);
+        VERIFIER(identique(&sortie, nouv, n_nouv));
+        free(sortie.buf);
+    }
+    free(patch.buf);
+}
+
+// Images sans rapport : patch fait d'ajouts, toujours exact
+static void test_sans_rapport(void)
+{
+    uint8_t a[3000], b[5000];
+    for (size_t i = 0; i < sizeof(a); i++) a[i] = aleatoire();
+    for (size_t i = 0; i < sizeof(b); i++) b[i] = aleatoire();
+
+    tampon_t patch = { 0 }, sortie = { 0 };
+    VERIFIER(delta_calculer(a, sizeof(a), b, sizeof(b), &patch) == 0);
+    VERIFIER(delta_appliquer(a, sizeof(a), patch.buf, patch.len, 7, &sortie) == 0);
+    VERIFIER(identique(&sortie, b, sizeof(b)));
+    free(sortie.buf);
+    free(patch.buf);
+}
+
+// Application interrompue puis reprise : l'état garde l'enregistrement
+// entamé, la nouvelle image n'est complète qu'au dernier octet du corps
+typedef struct {
+    tampon_t sortie;
+    const uint8_t *base;
+} contexte_t;
+
+static int lire(void *ctx, uint32_t position, uint8_t *buf, size_t len)
+{
+    contexte_t *c = ctx;
+    memcpy(buf, c->base + position, len);
+    return 0;
+}
+
+static int ecrire(void *ctx, const uint8_t *buf, size_t len)
+{
+    contexte_t *c = ctx;
+    return tampon_ajouter(&c->sortie, buf, len);
+}
+
+static void test_reprise(const uint8_t *base, size_t n_base, const uint8_t *nouv, size_t n_nouv)
+{
+    tampon_t patch = { 0 };
+    VERIFIER(delta_calculer(base, n_base, nouv, n_nouv, &patch) == 0);
+
+    // Corps décompressé d'un coup
+    uLongf n_corps = 4 * n_nouv;
+    uint8_t *corps = malloc(n_corps);
+    VERIFIER(uncompress(corps, &n_corps, patch.buf + OTA_DELTA_ENTETE, (uLong)(patch.len - OTA_DELTA_ENTETE)) == Z_OK);
+
+    ota_delta_entete_t e;
+    ota_delta_lire_entete(patch.buf, &e);
+    contexte_t c = { .base = base };
+    ota_delta_t d;
+    ota_delta_init(&d, &e, lire, ecrire, &c);
+
+    // Coupures irrégulières, dont une au milieu du premier en-tête
+    size_t position = 0, pas = 5;
+    while (position < n_corps) {
+        size_t k = n_corps - position < pas ? n_corps - position : pas;
+        VERIFIER(!ota_delta_termine(&d));
+        VERIFIER(ota_delta_appliquer(&d, corps + position, k) == 0);
+        position += k;
+        pas = pas * 3 % 2039 + 1;
+    }
+    VERIFIER(ota_delta_termine(&d));
+    VERIFIER(identique(&c.sortie, nouv, n_nouv));
+
+    // Corps tronqué : jamais terminé
+    ota_delta_init(&d, &e, lire, ecrire, &c);
+    c.sortie.len = 0;
+    VERIFIER(ota_delta_appliquer(&d, corps, n_corps - 1) == 0);
+    VERIFIER(!ota_delta_termine(&d));
+
+    free(c.sortie.buf);
+    free(corps);
+    free(patch.buf);
+}
+
+static void test_refus(const uint8_t *base, size_t n_base, const uint8_t *nouv, size_t n_nouv)
+{
+    tampon_t patch = { 0 }, sortie = { 0 };
+    VERIFIER(delta_calculer(base, n_base, nouv, n_nouv, &patch) == 0);
+
+    // Autre base de même taille : CRC différent
+    uint8_t *autre = malloc(n_base);
+    memcpy(autre, base, n_base);
+    autre[n_base / 2] ^= 1;
+    VERIFIER(delta_appliquer(autre, n_base, patch.buf, patch.len, 0, &sortie) < 0);
+    free(autre);
+
+    // Flux zlib tronqué
+    VERIFIER(delta_appliquer(base, n_base, patch.buf, patch.len - 16, 0, &sortie) < 0);
+
+    // Nouvelle image annoncée plus courte : un enregistrement déborde
+    ota_delta_entete_t e;
+    ota_delta_lire_entete(patch.buf, &e);
+    e.taille_image--;
+    ota_delta_ecrire_entete(&e, patch.buf);
+    VERIFIER(delta_appliquer(base, n_base, patch.buf, patch.len, 0, &sortie) < 0);
+
+    // Pas un patch
+    patch.buf[0] = 0xE9;
+    VERIFIER(delta_appliquer(base, n_base, patch.buf, patch.len, 0, &sortie) < 0);
+
+    free(patch.buf);
+}
+
+int main(void)
+{
+    size_t n_nouv;
+    uint8_t *base = base_creer(TAILLE_BASE);
+    uint8_t *nouv = nouvelle_creer(base, TAILLE_BASE, &n_nouv);
+
+    test_aller_retour(base, TAILLE_BASE, nouv, n_nouv);
+    test_sans_rapport();
+    test_reprise(base, TAILLE_BASE, nouv, n_nouv);
+    test_refus(base, TAILLE_BASE, nouv, n_nouv);
+
+    free(nouv);
+    free(base);
+    if (echecs) {
+        fprintf(stderr, "%d échec(s)\n", echecs);
+        return 1;
+    }
+    printf("ota_delta : OK\n");
+    return 0;
+}
@@ -0,0 +1,304 @@
+// Magasin d'événements du Pass-Box : ingestion MQTT, import du CSV Node-RED,
+// rapport et extraction par période en temps constant (voir store.h).
+//
+//   passbox_store ingest  -d data [-h broker.hivemq.com] [-p 1883] [-f 'usine/+/+']
+//   passbox_store import  -d data mqtt_log.csv
+//   passbox_store rapport -d data [-n 15]
+//   passbox_store plage   -d data [-u usine/salle1/passbox-07] 2025-12-18T00:00:00Z [2025-12-19T00:00:00Z]
+//
+// Les postes d'une flotte publient sous <site>/<salle>/<poste>/ : -f donne le
+// filtre des préfixes à suivre, chaque poste est enregistré sous le sien.
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqtt_mini.h"
+#include "store.h"
+
+#define SEPARATEUR "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+
+static volatile sig_atomic_t arret = 0;
+
+static void sur_signal(int sig)
+{
+    (void)sig;
+    arret = 1;
+}
+
+// ======================= HORODATAGE =======================
+static int64_t maintenant_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// "2025-12-18T23:26:32.084Z" (millisecondes facultatives, UTC)
+static int iso_lire(const char *s, int64_t *ms)
+{
+    struct tm tm = { 0 };
+    const char *fin = strptime(s, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (!fin) return -1;
+    int64_t frac = 0;
+    if (*fin == '.') {
+        int chiffres = 0;
+        for (fin++; *fin >= '0' && *fin <= '9'; fin++) {
+            if (chiffres++ < 3) frac = frac * 10 + (*fin - '0');
+        }
+        while (chiffres++ < 3) frac *= 10;
+    }
+    *ms = (int64_t)timegm(&tm) * 1000 + frac;
+    return 0;
+}
+
+static void iso_ecrire(int64_t ms, char *buf, size_t len)
+{
+    time_t t = (time_t)(ms / 1000);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    size_t n = strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + n, len - n, ".%03dZ", (int)(ms % 1000));
+}
+
+// ======================= INGESTION =======================
+// Topic complet -> identifiants du topic et du poste ; -1 si non suivi
+static int identifier(store_t *s, const char *topic, int *poste)
+{
+    size_t prefixe;
+    int id = store_topic_id(topic, &prefixe);
+    if (id < 0) return -1;
+    *poste = store_poste_id(s, topic, prefixe);
+    return *poste < 0 ? -1 : id;
+}
+
+static void sur_message(void *ctx, const char *topic, const uint8_t *payload, size_t len)
+{
+    store_t *s = ctx;
+    int poste;
+    int id = identifier(s, topic, &poste);
+    if (id < 0) return;
+    if (store_ajouter(s, maintenant_ms(), id, poste, (const char *)payload, len) < 0) {
+        perror("store: ajout");
+    }
+}
+
+static int cmd_ingest(store_t *s, const char *hote, int port, const char *filtre)
+{
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "passbox_store_%d", (int)getpid());
+
+    // "<filtre>/cycle/etape"... ou les topics seuls (poste unique)
+    char abonnements[STORE_NB_TOPICS][128];
+    const char *topics[STORE_NB_TOPICS];
+    for (int i = 0; i < store_nb_topics; i++) {
+        snprintf(abonnements[i], sizeof(abonnements[i]), "%s%s%s", filtre, filtre[0] ? "/" : "", store_topics[i]);
+        topics[i] = abonnements[i];
+    }
+
+    while (!arret) {
+        mqtt_mini_t c;
+        if (mqtt_mini_connect(&c, hote, port, client_id, 30) == 0 &&
+            mqtt_mini_subscribe(&c, topics, store_nb_topics) == 0) {
+            fprintf(stderr, "Connecté à %s:%d, %llu événement(s) en base\n", hote, port,
+                    (unsigned long long)s->e.total);
+            while (!arret && mqtt_mini_loop(&c, 1000, sur_message, s) == 0) {
+            }
+        }
+        mqtt_mini_close(&c);
+        if (!arret) {
+            fprintf(stderr, "Connexion perdue, nouvelle tentative dans 5 s\n");
+            sleep(5);
+        }
+    }
+    return 0;
+}
+
+// ======================= IMPORT CSV =======================
+// Format Node-RED : timestamp,topic,valeur (la valeur peut contenir des virgules)
+static int cmd_import(store_t *s, const char *chemin)
+{
+    FILE *f = fopen(chemin, "r");
+    if (!f) {
+        perror(chemin);
+        return 1;
+    }
+
+    char ligne[512];
+    unsigned long importes = 0, ignores = 0;
+    while (fgets(ligne, sizeof(ligne), f)) {
+        ligne[strcspn(ligne, "\r\n")] = '\0';
+        char *topic = strchr(ligne, ',');
+        char *valeur = topic ? strchr(topic + 1, ',') : NULL;
+        int64_t ts;
+        if (!valeur || iso_lire(ligne, &ts) < 0) {
+            ignores++;              // en-tête ou ligne invalide
+            continue;
+        }
+        *topic++ = '\0';
+        *valeur++ = '\0';
+        int poste;
+        int id = identifier(s, topic, &poste);
+        if (id < 0 || store_ajouter(s, ts, id, poste, valeur, strlen(valeur)) < 0) {
+            ignores++;
+            continue;
+        }
+        importes++;
+    }
+    fclose(f);
+    printf("%lu événement(s) importé(s), %lu ligne(s) ignorée(s)\n", importes, ignores);
+    return 0;
+}
+
+// ======================= RAPPORT =======================
+// Même contenu que l'email de rapport Node-RED, sans relire l'historique :
+// compteurs lus dans l'en-tête, N derniers lus par offset.
+static int cmd_rapport(store_t *s, unsigned n)
+{
+    char debut[32], fin[32], genere[64];
+    time_t t = time(NULL);
+    strftime(genere, sizeof(genere), "%Y-%m-%d %H:%M:%S %Z", localtime(&t));
+
+    printf("RAPPORT AUTOMATIQUE - MAGASIN D'ÉVÉNEMENTS\n\n");
+    printf("Date de génération : %s\n", genere);
+    printf("Total d'événements : %llu\n", (unsigned long long)s->e.total);
+    if (s->nb_postes > 1) printf("Postes : %d\n", s->nb_postes - 1);
+    if (s->e.total == 0) return 0;
+    iso_ecrire(s->e.premier_ts, debut, sizeof(debut));
+    iso_ecrire(s->e.dernier_ts, fin, sizeof(fin));
+    printf("Période couverte : %s → %s\n\n%s\n\nRÉPARTITION PAR TOPIC\n\n", debut, fin, SEPARATEUR);
+
+    int ordre[STORE_NB_TOPICS];
+    int nb = 0;
+    for (int i = 0; i < store_nb_topics; i++) {
+        if (!s->e.compteurs[i]) continue;
+        int j = nb++;
+        while (j > 0 && s->e.compteurs[ordre[j - 1]] < s->e.compteurs[i]) {
+            ordre[j] = ordre[j - 1];
+            j--;
+        }
+        ordre[j] = i;
+    }
+    for (int k = 0; k < nb; k++) {
+        printf("📌 %s : %llu occurrences\n", store_topics[ordre[k]],
+               (unsigned long long)s->e.compteurs[ordre[k]]);
+    }
+
+    uint64_t premier = s->e.total > n ? s->e.total - n : 0;
+    printf("\n%s\n\nDERNIERS %u ÉVÉNEMENTS\n\n", SEPARATEUR, (unsigned)(s->e.total - premier));
+    for (uint64_t i = premier; i < s->e.total; i++) {
+        store_evt_t evt;
+        if (store_lire(s, i, &evt) < 0) break;
+        char ts[32], topic[128];
+        iso_ecrire(evt.ts_ms, ts, sizeof(ts));
+        store_nom_topic(s, &evt, topic, sizeof(topic));
+        printf("[%llu] %s\n📌 Topic : %s\n💡 Valeur: %.*s\n\n", (unsigned long long)(i + 1), ts,
+               topic, evt.len, evt.valeur);
+    }
+
+    printf("%s\n\nRÉSUMÉ RAPIDE :\n\n", SEPARATEUR);
+    printf("• Événements analysés : %llu\n", (unsigned long long)s->e.total);
+    printf("• Topics différents : %d\n", nb);
+    printf("• Topic le plus fréquent : %s (%llu occurrences)\n", store_topics[ordre[0]],
+           (unsigned long long)s->e.compteurs[ordre[0]]);
+    return 0;
+}
+
+// ======================= PLAGE =======================
+// Sortie au format CSV Node-RED, pour les outils existants. poste : préfixe
+// d'un seul poste, NULL pour tous.
+static int cmd_plage(store_t *s, const char *de, const char *a, const char *poste)
+{
+    int64_t debut, fin = INT64_MAX;
+    if (iso_lire(de, &debut) < 0 || (a && iso_lire(a, &fin) < 0)) {
+        fprintf(stderr, "horodatage attendu : AAAA-MM-JJTHH:MM:SS[.mmm]Z\n");
+        return 1;
+    }
+
+    int filtre = -1;
+    if (poste) {
+        for (int p = 0; p < s->nb_postes; p++) {
+            if (strcmp(s->noms_postes[p], poste) == 0) filtre = p;
+        }
+        if (filtre < 0) {
+            fprintf(stderr, "poste inconnu : %s\n", poste);
+            return 1;
+        }
+    }
+
+    printf("timestamp,topic,valeur\n");
+    store_evt_t evt;
+    for (uint64_t i = store_chercher(s, debut); i < s->e.total && store_lire(s, i, &evt) == 0; i++) {
+        if (evt.ts_ms >= fin) break;
+        if (filtre >= 0 && evt.poste != filtre) continue;
+        char ts[32], topic[128];
+        iso_ecrire(evt.ts_ms, ts, sizeof(ts));
+        store_nom_topic(s, &evt, topic, sizeof(topic));
+        printf("%s,%s,%.*s\n", ts, topic, evt.len, evt.valeur);
+    }
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: passbox_store ingest  -d dir [-h hote] [-p port] [-f filtre]\n"
+            "       passbox_store import  -d dir fichier.csv\n"
+            "       passbox_store rapport -d dir [-n derniers]\n"
+            "       passbox_store plage   -d dir [-u poste] debut [fin]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) usage();
+    const char *cmd = argv[1];
+    const char *dir = "data";
+    const char *hote = "broker.hivemq.com";
+    int port = 1883;
+    const char *filtre = "";
+    const char *poste = NULL;
+    unsigned n = 15;
+
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "d:h:p:n:f:u:")) != -1) {
+        switch (opt) {
+        case 'd': dir = optarg; break;
+        case 'h': hote = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'n': n = (unsigned)atoi(optarg); break;
+        case 'f': filtre = optarg; break;
+        case 'u': poste = optarg; break;
+        default: usage();
+        }
+    }
+
+    store_t s;
+    if (store_ouvrir(&s, dir) < 0) return 1;
+
+    signal(SIGINT, sur_signal);
+    signal(SIGTERM, sur_signal);
+
+    int ret;
+    if (strcmp(cmd, "ingest") == 0) {
+        ret = cmd_ingest(&s, hote, port, filtre);
+    } else if (strcmp(cmd, "import") == 0 && optind < argc) {
+        ret = cmd_import(&s, argv[optind]);
+    } else if (strcmp(cmd, "rapport") == 0) {
+        ret = cmd_rapport(&s, n);
+    } else if (strcmp(cmd, "plage") == 0 && optind < argc) {
+        ret = cmd_plage(&s, argv[optind], optind + 1 < argc ? argv[optind + 1] : NULL, poste);
+    } else {
+        store_fermer(&s);
+        usage();
+        return 2;
+    }
+    store_fermer(&s);
+    return ret;
+}
@@ -0,0 +1,319 @@
+#include "store.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STORE_MAGIC     0x31535042      // "PBS1"
+#define STORE_VERSION   2               // 2 : octet poste en fin d'enregistrement, valeur à 53 octets
+#define HEURE_MS        3600000LL
+
+_Static_assert(sizeof(store_evt_t) == 64, "enregistrement events.bin");
+
+const char *const store_topics[] = {
+    "cycle/depart",
+    "cycle/etape",
+    "urgence",
+    "porte/sterile",
+    "porte/contaminee",
+};
+const int store_nb_topics = sizeof(store_topics) / sizeof(store_topics[0]);
+
+_Static_assert(sizeof(store_topics) / sizeof(store_topics[0]) <= STORE_NB_TOPICS, "trop de topics");
+
+int store_topic_id(const char *topic, size_t *prefixe)
+{
+    size_t n = strlen(topic);
+    for (int i = 0; i < store_nb_topics; i++) {
+        size_t m = strlen(store_topics[i]);
+        if (n < m || strcmp(topic + n - m, store_topics[i]) != 0) continue;
+        if (n == m) {
+            *prefixe = 0;
+            return i;
+        }
+        size_t p = n - m - 1;
+        if (topic[p] != '/') continue;
+        // ".../cmd/cycle/depart", "<site>/cmd/urgence" : commandes, pas des états
+        if (p >= 3 && strncmp(topic + p - 3, "cmd", 3) == 0 && (p == 3 || topic[p - 4] == '/')) continue;
+        *prefixe = p;
+        return i;
+    }
+    return -1;
+}
+
+// ======================= E/S =======================
+static int lire_a(int fd, void *d, size_t n, off_t off)
+{
+    return pread(fd, d, n, off) == (ssize_t)n ? 0 : -1;
+}
+
+static int ecrire_a(int fd, const void *d, size_t n, off_t off)
+{
+    return pwrite(fd, d, n, off) == (ssize_t)n ? 0 : -1;
+}
+
+static off_t bucket_offset(uint64_t b)
+{
+    return (off_t)(sizeof(store_entete_t) + b * sizeof(store_bucket_t));
+}
+
+static int index_ecrire(store_t *s)
+{
+    if (s->e.nb_buckets &&
+        ecrire_a(s->index, &s->courant, sizeof(s->courant), bucket_offset(s->e.nb_buckets - 1)) < 0) {
+        return -1;
+    }
+    return ecrire_a(s->index, &s->e, sizeof(s->e), 0);
+}
+
+// ======================= POSTES =======================
+// Une ligne par poste, ajoutée avant le premier événement qui la référence.
+// Une ligne partielle (coupure pendant l'ajout) est tronquée.
+static int postes_charger(store_t *s)
+{
+    static char buf[STORE_NB_POSTES * STORE_POSTE_MAX];
+    ssize_t n = pread(s->postes, buf, sizeof(buf), 0);
+    if (n < 0) return -1;
+
+    s->nb_postes = 1;
+    s->noms_postes[0][0] = '\0';
+    size_t debut = 0;
+    for (size_t i = 0; i < (size_t)n && s->nb_postes < STORE_NB_POSTES; i++) {
+        if (buf[i] != '\n') continue;
+        size_t len = i - debut;
+        if (len >= STORE_POSTE_MAX) len = STORE_POSTE_MAX - 1;
+        memcpy(s->noms_postes[s->nb_postes], buf + debut, len);
+        s->noms_postes[s->nb_postes++][len] = '\0';
+        debut = i + 1;
+    }
+    if (debut != (size_t)n) {
+        fprintf(stderr, "store: poste partiel tronqué\n");
+        if (ftruncate(s->postes, (off_t)debut) < 0) return -1;
+    }
+    return 0;
+}
+
+int store_poste_id(store_t *s, const char *prefixe, size_t len)
+{
+    if (len == 0) return 0;
+    if (len >= STORE_POSTE_MAX || memchr(prefixe, '\n', len)) return -1;
+    for (int i = 1; i < s->nb_postes; i++) {
+        if (strncmp(s->noms_postes[i], prefixe, len) == 0 && s->noms_postes[i][len] == '\0') return i;
+    }
+    if (s->nb_postes >= STORE_NB_POSTES) return -1;
+
+    char ligne[STORE_POSTE_MAX + 1];
+    memcpy(ligne, prefixe, len);
+    ligne[len] = '\n';
+    if (write(s->postes, ligne, len + 1) != (ssize_t)(len + 1)) return -1;
+    memcpy(s->noms_postes[s->nb_postes], prefixe, len);
+    s->noms_postes[s->nb_postes][len] = '\0';
+    return s->nb_postes++;
+}
+
+void store_nom_topic(const store_t *s, const store_evt_t *evt, char *buf, size_t len)
+{
+    if (evt->poste) {
+        snprintf(buf, len, "%s/%s", s->noms_postes[evt->poste], store_topics[evt->topic]);
+    } else {
+        snprintf(buf, len, "%s", store_topics[evt->topic]);
+    }
+}
+
+// ======================= INDEXATION =======================
+// Met à jour compteurs et bucket pour l'événement i ; le bucket précédent est
+// écrit quand l'heure change.
+static void indexer(store_t *s, uint64_t i, const store_evt_t *evt)
+{
+    int64_t heure = evt->ts_ms - evt->ts_ms % HEURE_MS;
+
+    if (s->e.nb_buckets == 0 || heure > s->courant.heure_ms) {
+        if (s->e.nb_buckets) {
+            ecrire_a(s->index, &s->courant, sizeof(s->courant), bucket_offset(s->e.nb_buckets - 1));
+        }
+        memset(&s->courant, 0, sizeof(s->courant));
+        s->courant.heure_ms = heure;
+        s->courant.premier = i;
+        s->e.nb_buckets++;
+    }
+
+    s->courant.compteurs[evt->topic]++;
+    s->e.compteurs[evt->topic]++;
+    s->e.total = i + 1;
+    if (i == 0 || evt->ts_ms < s->e.premier_ts) s->e.premier_ts = evt->ts_ms;
+    if (i == 0 || evt->ts_ms > s->e.dernier_ts) s->e.dernier_ts = evt->ts_ms;
+}
+
+static void entete_raz(store_t *s)
+{
+    memset(&s->e, 0, sizeof(s->e));
+    memset(&s->courant, 0, sizeof(s->courant));
+    s->e.magic = STORE_MAGIC;
+    s->e.version = STORE_VERSION;
+}
+
+// Rejoue dans l'index les événements [depuis, n) d'events.bin
+static int reconcilier(store_t *s, uint64_t depuis, uint64_t n)
+{
+    if (depuis == n) return 0;
+    fprintf(stderr, "store: réindexation de %llu événement(s)\n", (unsigned long long)(n - depuis));
+    for (uint64_t i = depuis; i < n; i++) {
+        store_evt_t evt;
+        if (store_lire(s, i, &evt) < 0) return -1;
+        if (evt.topic >= STORE_NB_TOPICS) evt.topic = 0;
+        indexer(s, i, &evt);
+    }
+    if (ftruncate(s->index, bucket_offset(s->e.nb_buckets)) < 0) return -1;
+    return index_ecrire(s);
+}
+
+// Version 1 : valeur sur 54 octets, sans poste. Réécrite sur place en
+// version 2 (même taille d'enregistrement) : valeur coupée à 53 octets, poste
+// 0. Idempotente, elle reprend après une coupure ; l'index, resté en version
+// 1 jusqu'au bout, est ensuite reconstruit.
+static int migrer_v1(store_t *s, uint64_t n)
+{
+    fprintf(stderr, "store: migration v1 -> v2 de %llu événement(s)\n", (unsigned long long)n);
+    for (uint64_t i = 0; i < n; i++) {
+        store_evt_t evt;
+        if (lire_a(s->events, &evt, sizeof(evt), (off_t)(i * sizeof(evt))) < 0) return -1;
+        if (evt.len > STORE_VALEUR_MAX) evt.len = STORE_VALEUR_MAX;
+        evt.poste = 0;
+        if (ecrire_a(s->events, &evt, sizeof(evt), (off_t)(i * sizeof(evt))) < 0) return -1;
+    }
+    return 0;
+}
+
+// ======================= API =======================
+int store_ouvrir(store_t *s, const char *dir)
+{
+    char chemin[PATH_MAX];
+    memset(s, 0, sizeof(*s));
+    s->index = -1;
+    s->postes = -1;
+    mkdir(dir, 0755);
+
+    snprintf(chemin, sizeof(chemin), "%s/events.bin", dir);
+    s->events = open(chemin, O_RDWR | O_CREAT, 0644);
+    if (s->events < 0) {
+        perror(chemin);
+        return -1;
+    }
+    snprintf(chemin, sizeof(chemin), "%s/index.bin", dir);
+    s->index = open(chemin, O_RDWR | O_CREAT, 0644);
+    if (s->index < 0) {
+        perror(chemin);
+        store_fermer(s);
+        return -1;
+    }
+    snprintf(chemin, sizeof(chemin), "%s/postes.txt", dir);
+    s->postes = open(chemin, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (s->postes < 0 || postes_charger(s) < 0) {
+        perror(chemin);
+        store_fermer(s);
+        return -1;
+    }
+
+    // Un ajout interrompu laisse au plus un enregistrement partiel en fin
+    struct stat st;
+    if (fstat(s->events, &st) < 0) {
+        perror("store: events.bin");
+        store_fermer(s);
+        return -1;
+    }
+    uint64_t n = (uint64_t)st.st_size / sizeof(store_evt_t);
+    if ((uint64_t)st.st_size != n * sizeof(store_evt_t)) {
+        fprintf(stderr, "store: enregistrement partiel tronqué\n");
+        if (ftruncate(s->events, (off_t)(n * sizeof(store_evt_t))) < 0) {
+            perror("store: events.bin");
+            store_fermer(s);
+            return -1;
+        }
+    }
+
+    // La version du format est celle de l'en-tête de l'index
+    bool entete = lire_a(s->index, &s->e, sizeof(s->e), 0) == 0 && s->e.magic == STORE_MAGIC;
+    if (entete && s->e.version > STORE_VERSION) {
+        fprintf(stderr, "store: format version %u, cet outil ne lit que la version %d\n",
+                (unsigned)s->e.version, STORE_VERSION);
+        store_fermer(s);
+        return -1;
+    }
+    if (entete && s->e.version == 1 && migrer_v1(s, n) < 0) {
+        perror("store: migration");
+        store_fermer(s);
+        return -1;
+    }
+
+    // L'index est écrit après l'événement : il peut être en retard, jamais en
+    // avance. Tout autre écart (fichier absent, corrompu, migré) le reconstruit.
+    bool valide = entete && s->e.version == STORE_VERSION && s->e.total <= n;
+    if (valide && s->e.nb_buckets) {
+        valide = lire_a(s->index, &s->courant, sizeof(s->courant), bucket_offset(s->e.nb_buckets - 1)) == 0;
+    }
+    if (!valide) entete_raz(s);
+
+    if (reconcilier(s, s->e.total, n) < 0) {
+        perror("store: réconciliation");
+        store_fermer(s);
+        return -1;
+    }
+    return 0;
+}
+
+int store_ajouter(store_t *s, int64_t ts_ms, int topic, int poste, const char *valeur, size_t len)
+{
+    if (topic < 0 || topic >= store_nb_topics || poste < 0 || poste >= s->nb_postes) return -1;
+
+    store_evt_t evt = { .ts_ms = ts_ms, .topic = (uint8_t)topic, .poste = (uint8_t)poste };
+    if (len > STORE_VALEUR_MAX) len = STORE_VALEUR_MAX;
+    evt.len = (uint8_t)len;
+    memcpy(evt.valeur, valeur, len);
+
+    uint64_t i = s->e.total;
+    if (ecrire_a(s->events, &evt, sizeof(evt), (off_t)(i * sizeof(evt))) < 0) return -1;
+    indexer(s, i, &evt);
+    return index_ecrire(s);
+}
+
+void store_fermer(store_t *s)
+{
+    if (s->events >= 0) close(s->events);
+    if (s->index >= 0) close(s->index);
+    if (s->postes >= 0) close(s->postes);
+    s->events = s->index = s->postes = -1;
+}
+
+int store_lire(store_t *s, uint64_t i, store_evt_t *evt)
+{
+    if (lire_a(s->events, evt, sizeof(*evt), (off_t)(i * sizeof(*evt))) < 0) return -1;
+    if (evt->len > STORE_VALEUR_MAX) evt->len = STORE_VALEUR_MAX;
+    // postes.txt tronqué ou perdu : le poste n'est plus connu
+    if (evt->poste >= s->nb_postes) evt->poste = 0;
+    return 0;
+}
+
+uint64_t store_chercher(store_t *s, int64_t ts_ms)
+{
+    if (s->e.nb_buckets == 0) return 0;
+
+    // Dernier bucket dont l'heure est <= ts_ms
+    uint64_t bas = 0, haut = s->e.nb_buckets;
+    while (haut - bas > 1) {
+        uint64_t milieu = bas + (haut - bas) / 2;
+        store_bucket_t b;
+        if (lire_a(s->index, &b, sizeof(b), bucket_offset(milieu)) < 0) break;
+        if (b.heure_ms <= ts_ms) bas = milieu;
+        else haut = milieu;
+    }
+
+    store_bucket_t b;
+    if (lire_a(s->index, &b, sizeof(b), bucket_offset(bas)) < 0) return 0;
+    uint64_t i = b.premier;
+    store_evt_t evt;
+    while (i < s->e.total && store_lire(s, i, &evt) == 0 && evt.ts_ms < ts_ms) i++;
+    return i;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ======================= MAGASIN D'EVENEMENTS =======================
+// events.bin : enregistrements de taille fixe, ajout seul. Le i-ème événement
+//              est à l'offset i * 64 : les N derniers se lisent sans parcours.
+// index.bin  : en-tête (compteurs par topic, période couverte) suivi d'un
+//              bucket par heure (premier enregistrement + compteurs par topic).
+// postes.txt : préfixes des postes (<site>/<salle>/<poste>), un par ligne,
+//              dans l'ordre de leurs identifiants à partir de 1.
+// Les deux premiers fichiers sont mis à jour à chaque ajout ; un rapport ne
+// relit jamais l'historique.
+
+#define STORE_NB_TOPICS     8
+#define STORE_VALEUR_MAX    53
+#define STORE_NB_POSTES     256
+#define STORE_POSTE_MAX     72
+
+typedef struct {
+    int64_t ts_ms;                      // heure Unix en millisecondes
+    uint8_t topic;                      // index dans store_topics[]
+    uint8_t len;
+    char valeur[STORE_VALEUR_MAX];
+    uint8_t poste;                      // index dans postes.txt, 0 : topics sans préfixe
+} store_evt_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t total;
+    uint64_t compteurs[STORE_NB_TOPICS];
+    int64_t premier_ts;
+    int64_t dernier_ts;
+    uint64_t nb_buckets;
+} store_entete_t;
+
+typedef struct {
+    int64_t heure_ms;                   // début de l'heure
+    uint64_t premier;                   // index du premier événement de l'heure
+    uint32_t compteurs[STORE_NB_TOPICS];
+} store_bucket_t;
+
+typedef struct {
+    int events;                         // descripteurs events.bin / index.bin
+    int index;
+    store_entete_t e;
+    store_bucket_t courant;             // dernier bucket (copie de la fin d'index.bin)
+    int postes;                         // descripteur postes.txt
+    int nb_postes;                      // poste 0 ("") compris
+    char noms_postes[STORE_NB_POSTES][STORE_POSTE_MAX];
+} store_t;
+
+// Topics du pass-box, dans l'ordre de leurs identifiants
+extern const char *const store_topics[];
+extern const int store_nb_topics;
+
+// Topic complet ("usine/salle1/passbox-07/cycle/etape" ou "cycle/etape") :
+// identifiant du nom final et longueur du préfixe du poste ('/' exclu).
+// -1 si le topic n'est pas suivi.
+int store_topic_id(const char *topic, size_t *prefixe);
+
+// Identifiant du poste de préfixe [prefixe, prefixe + len), ajouté à
+// postes.txt à la première rencontre. -1 si la table est pleine.
+int store_poste_id(store_t *s, const char *prefixe, size_t len);
+
+// Ouvre (ou crée) le magasin dans dir et le réconcilie après une coupure :
+// un enregistrement partiel est tronqué, les événements absents de l'index y
+// sont rejoués.
+int store_ouvrir(store_t *s, const char *dir);
+int store_ajouter(store_t *s, int64_t ts_ms, int topic, int poste, const char *valeur, size_t len);
+void store_fermer(store_t *s);
+
+// Lit l'événement d'index i (0 = le plus ancien)
+int store_lire(store_t *s, uint64_t i, store_evt_t *evt);
+
+// Topic complet de l'événement, tel que publié par le poste
+void store_nom_topic(const store_t *s, const store_evt_t *evt, char *buf, size_t len);
+
+// Premier événement d'horodatage >= ts_ms (recherche dichotomique sur les
+// buckets puis parcours d'une heure au plus). Les horodatages sont supposés
+// croissants ; un événement en retard est compté dans le bucket courant.
+uint64_t store_chercher(store_t *s, int64_t ts_ms);
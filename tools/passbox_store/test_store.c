@@ -0,0 +1,183 @@
+// Tests du magasin d'événements : relecture des enregistrements et des
+// postes, reprise après une coupure, migration d'un magasin version 1.
+//
+//   ctest --test-dir build-tools -R store
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "store.h"
+
+static int echecs = 0;
+
+#define VERIFIER(cond)                                                          \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: échec : %s\n", __FILE__, __LINE__, #cond);  \
+            echecs++;                                                           \
+        }                                                                       \
+    } while (0)
+
+static char dir[64];
+
+static void chemin(char *buf, size_t len, const char *nom)
+{
+    snprintf(buf, len, "%s/%s", dir, nom);
+}
+
+static void vider(void)
+{
+    const char *noms[] = { "events.bin", "index.bin", "postes.txt" };
+    char p[128];
+    for (size_t i = 0; i < sizeof(noms) / sizeof(noms[0]); i++) {
+        chemin(p, sizeof(p), noms[i]);
+        unlink(p);
+    }
+}
+
+// Ajout comme passbox_store ingest : topic complet -> topic et poste
+static int ajouter(store_t *s, int64_t ts, const char *topic, const char *valeur)
+{
+    size_t prefixe;
+    int id = store_topic_id(topic, &prefixe);
+    if (id < 0) return -1;
+    int poste = store_poste_id(s, topic, prefixe);
+    if (poste < 0) return -1;
+    return store_ajouter(s, ts, id, poste, valeur, strlen(valeur));
+}
+
+static void test_relecture(void)
+{
+    vider();
+    store_t s;
+    VERIFIER(store_ouvrir(&s, dir) == 0);
+    VERIFIER(ajouter(&s, 1000, "usine/salle1/passbox-07/cycle/etape", "1: Extraction air") == 0);
+    VERIFIER(ajouter(&s, 2000, "cycle/depart", "true") == 0);
+    VERIFIER(ajouter(&s, 3600000 + 5, "usine/salle1/passbox-08/urgence", "false") == 0);
+    VERIFIER(ajouter(&s, 3600000 + 6, "usine/salle1/passbox-07/cmd/urgence", "true") < 0);   // commande
+    store_fermer(&s);
+
+    VERIFIER(store_ouvrir(&s, dir) == 0);
+    VERIFIER(s.e.total == 3);
+    VERIFIER(s.e.nb_buckets == 2);
+    VERIFIER(s.nb_postes == 3);
+    VERIFIER(s.e.premier_ts == 1000 && s.e.dernier_ts == 3600005);
+
+    store_evt_t evt;
+    char topic[128];
+    VERIFIER(store_lire(&s, 0, &evt) == 0);
+    store_nom_topic(&s, &evt, topic, sizeof(topic));
+    VERIFIER(strcmp(topic, "usine/salle1/passbox-07/cycle/etape") == 0);
+    VERIFIER(evt.len == 17 && memcmp(evt.valeur, "1: Extraction air", 17) == 0);
+    VERIFIER(store_lire(&s, 1, &evt) == 0 && evt.poste == 0);
+    store_nom_topic(&s, &evt, topic, sizeof(topic));
+    VERIFIER(strcmp(topic, "cycle/depart") == 0);
+
+    VERIFIER(store_chercher(&s, 0) == 0);
+    VERIFIER(store_chercher(&s, 1500) == 1);
+    VERIFIER(store_chercher(&s, 3600000) == 2);
+    VERIFIER(store_chercher(&s, 4000000) == 3);
+    store_fermer(&s);
+}
+
+// Coupure après l'écriture d'un événement et d'une partie du suivant, avant
+// la mise à jour de l'index
+static void test_reprise(void)
+{
+    vider();
+    store_t s;
+    VERIFIER(store_ouvrir(&s, dir) == 0);
+    VERIFIER(ajouter(&s, 1000, "cycle/etape", "1: Extraction air") == 0);
+    store_entete_t avant = s.e;
+    VERIFIER(ajouter(&s, 2000, "cycle/etape", "2: Arret air") == 0);
+    store_fermer(&s);
+
+    char p[128];
+    chemin(p, sizeof(p), "index.bin");
+    int fd = open(p, O_WRONLY);
+    VERIFIER(fd >= 0 && pwrite(fd, &avant, sizeof(avant), 0) == (ssize_t)sizeof(avant));
+    close(fd);
+    chemin(p, sizeof(p), "events.bin");
+    fd = open(p, O_WRONLY | O_APPEND);
+    VERIFIER(fd >= 0 && write(fd, "partiel", 7) == 7);
+    close(fd);
+
+    VERIFIER(store_ouvrir(&s, dir) == 0);
+    VERIFIER(s.e.total == 2);
+    VERIFIER(s.e.compteurs[1] == 2);
+    VERIFIER(ajouter(&s, 3000, "cycle/etape", "3: Injection produit") == 0);
+    store_evt_t evt;
+    VERIFIER(store_lire(&s, 2, &evt) == 0 && evt.ts_ms == 3000);
+    store_fermer(&s);
+}
+
+// Format version 1 : valeur sur 54 octets, pas d'octet poste
+static void test_migration_v1(void)
+{
+    vider();
+    store_t s;
+    VERIFIER(store_ouvrir(&s, dir) == 0);
+    VERIFIER(ajouter(&s, 1000, "cycle/etape", "x") == 0);
+    store_fermer(&s);
+
+    char p[128];
+    chemin(p, sizeof(p), "events.bin");
+    int fd = open(p, O_WRONLY);
+    uint8_t v1[64] = { 0 };
+    int64_t ts = 1000;
+    memcpy(v1, &ts, sizeof(ts));
+    v1[8] = 1;                          // cycle/etape
+    v1[9] = 54;
+    memset(v1 + 10, 'a', 54);           // le 54e octet tombe sur le poste en version 2
+    VERIFIER(fd >= 0 && pwrite(fd, v1, sizeof(v1), 0) == (ssize_t)sizeof(v1));
+    close(fd);
+    chemin(p, sizeof(p), "index.bin");
+    fd = open(p, O_WRONLY);
+    uint32_t version = 1;
+    VERIFIER(fd >= 0 && pwrite(fd, &version, sizeof(version), offsetof(store_entete_t, version)) == sizeof(version));
+    close(fd);
+
+    VERIFIER(store_ouvrir(&s, dir) == 0);
+    VERIFIER(s.e.version == 2 && s.e.total == 1);
+    store_evt_t evt;
+    VERIFIER(store_lire(&s, 0, &evt) == 0);
+    VERIFIER(evt.len == STORE_VALEUR_MAX && evt.poste == 0 && evt.topic == 1);
+    store_fermer(&s);
+
+    // Version plus récente que l'outil : refusée, pas reconstruite, aucun
+    // fichier laissé ouvert (le prochain descripteur libre est le même)
+    fd = open(p, O_WRONLY);
+    version = 3;
+    VERIFIER(fd >= 0 && pwrite(fd, &version, sizeof(version), offsetof(store_entete_t, version)) == sizeof(version));
+    close(fd);
+    VERIFIER(store_ouvrir(&s, dir) < 0);
+    int libre = open(p, O_RDONLY);
+    VERIFIER(libre == fd);
+    close(libre);
+}
+
+int main(void)
+{
+    snprintf(dir, sizeof(dir), "/tmp/test_store_XXXXXX");
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    test_relecture();
+    test_reprise();
+    test_migration_v1();
+
+    vider();
+    rmdir(dir);
+    if (echecs) {
+        fprintf(stderr, "%d échec(s)\n", echecs);
+        return 1;
+    }
+    printf("store : OK\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Compare les profils de build debug et production du Pass-Box.
+
+1. Occupation flash/RAM par composant, lue avec esp_idf_size sur les fichiers
+   .map des deux répertoires de build.
+2. Écarts de benchmarks, lus dans deux captures console contenant les lignes
+   "BENCH <nom> <ns>" (firmware construit avec CONFIG_PASSBOX_BENCH=y).
+
+    cmake --preset debug && cmake --build --preset debug
+    cmake --preset prod  && cmake --build --preset prod
+    python3 tools/profil_rapport.py --debug build --prod build-prod \\
+        --bench-debug debug.log --bench-prod prod.log
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import subprocess
+import sys
+
+BENCH_RE = re.compile(r'BENCH\s+(\S+)\s+(\d+)')
+# Regroupement des types mémoire esp_idf_size en deux colonnes
+FLASH = ('Flash Code', 'Flash Data', '.flash.text', '.flash.rodata', '.flash.appdesc')
+RAM = ('DRAM', 'IRAM', 'DIRAM', 'RTC FAST', 'RTC SLOW')
+
+
+def fichier_map(build_dir):
+    maps = [m for m in glob.glob(os.path.join(build_dir, '*.map')) if 'bootloader' not in m]
+    if not maps:
+        sys.exit(f'aucun fichier .map dans {build_dir} (build effectué ?)')
+    return maps[0]
+
+
+def tailles_par_composant(build_dir):
+    sortie = subprocess.run([sys.executable, '-m', 'esp_idf_size', '--archives', '--format', 'json2',
+                             fichier_map(build_dir)], check=True, capture_output=True, text=True).stdout
+    archives = json.loads(sortie)
+    resultat = {}
+    for nom, info in archives.items():
+        flash = ram = 0
+        for type_mem, detail in info.get('memory_types', {}).items():
+            taille = detail.get('size', 0) if isinstance(detail, dict) else detail
+            if type_mem.startswith(FLASH):
+                flash += taille
+            elif type_mem.startswith(RAM):
+                ram += taille
+        composant = os.path.basename(nom).removeprefix('lib').removesuffix('.a')
+        resultat[composant] = (flash, ram)
+    return resultat
+
+
+def lire_bench(chemin):
+    resultats = {}
+    with open(chemin, encoding='utf-8', errors='replace') as f:
+        for ligne in f:
+            m = BENCH_RE.search(ligne)
+            if m:
+                resultats[m.group(1)] = int(m.group(2))
+    return resultats
+
+
+def delta(a, b):
+    return f'{(b - a) * 100 / a:+.1f} %' if a else 'n/a'
+
+
+def rapport_tailles(debug, prod, top):
+    composants = sorted(set(debug) | set(prod),
+                        key=lambda c: -sum(prod.get(c, debug.get(c, (0, 0)))))
+    print(f'{"Composant":<28}{"Flash dbg":>11}{"Flash prod":>11}{"RAM dbg":>10}{"RAM prod":>10}')
+    for c in composants[:top]:
+        fd, rd = debug.get(c, (0, 0))
+        fp, rp = prod.get(c, (0, 0))
+        print(f'{c:<28}{fd:>11}{fp:>11}{rd:>10}{rp:>10}')
+    tfd = sum(v[0] for v in debug.values())
+    tfp = sum(v[0] for v in prod.values())
+    trd = sum(v[1] for v in debug.values())
+    trp = sum(v[1] for v in prod.values())
+    print(f'{"TOTAL":<28}{tfd:>11}{tfp:>11}{trd:>10}{trp:>10}')
+    print(f'Flash {delta(tfd, tfp)}, RAM {delta(trd, trp)}\n')
+
+
+def rapport_bench(debug, prod):
+    print(f'{"Benchmark":<20}{"debug ns":>12}{"prod ns":>12}{"écart":>10}')
+    for nom in sorted(set(debug) | set(prod)):
+        d, p = debug.get(nom), prod.get(nom)
+        print(f'{nom:<20}{d if d is not None else "-":>12}{p if p is not None else "-":>12}'
+              f'{delta(d, p) if d and p else "-":>10}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--debug', default='build', help='répertoire de build debug')
+    parser.add_argument('--prod', default='build-prod', help='répertoire de build production')
+    parser.add_argument('--bench-debug', help='capture console du profil debug')
+    parser.add_argument('--bench-prod', help='capture console du profil production')
+    parser.add_argument('--top', type=int, default=20, help='nombre de composants affichés')
+    args = parser.parse_args()
+
+    rapport_tailles(tailles_par_composant(args.debug), tailles_par_composant(args.prod), args.top)
+    if args.bench_debug and args.bench_prod:
+        rapport_bench(lire_bench(args.bench_debug), lire_bench(args.bench_prod))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,152 @@
+// Temps reconnexion -> premier publish sur un broker MQTT TLS, handshake
+// complet contre reprise de session par ticket, dans les conditions de
+// l'ESP32 (TLS 1.2, suites ECDHE AES-GCM).
+//
+//   tls_reprise [-h localhost] [-p 8883] [-c ca.pem] [-n 20] [-e] [-3]
+//
+//   -e  suites ECDHE-ECDSA uniquement (certificat ECDSA exigé)
+//   -3  autorise TLS 1.3 (l'ESP32 reste en TLS 1.2)
+//
+// Les connexions alternent ticket oublié / ticket présenté. Chacune
+// s'abonne au topic de mesure, publie et attend l'écho du broker : le
+// premier publish est compté quand le broker l'a redistribué.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqtt_mini.h"
+
+#define TOPIC_MESURE    "passbox/bench/reprise"
+#define ECHO_DELAI_MS   5000
+#define MAX_MESURES     1000
+
+typedef struct {
+    double connexion_ms[MAX_MESURES];   // TCP + TLS + CONNACK
+    double publish_ms[MAX_MESURES];     // jusqu'à l'écho du premier publish
+    int nb;
+    int reprises;                       // handshakes réellement abrégés
+} serie_t;
+
+// ======================= MESURE =======================
+static double maintenant_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void sur_message(void *ctx, const char *topic, const uint8_t *payload, size_t len)
+{
+    (void)payload;
+    (void)len;
+    if (strcmp(topic, TOPIC_MESURE) == 0) *(int *)ctx = 1;
+}
+
+static int mesurer(const char *hote, int port, mqtt_mini_tls_t *tls, serie_t *s)
+{
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "tls_reprise_%d", (int)getpid());
+
+    mqtt_mini_t c;
+    double t0 = maintenant_ms();
+    if (mqtt_mini_connect_tls(&c, hote, port, client_id, 30, tls) < 0) {
+        mqtt_mini_close(&c);
+        return -1;
+    }
+    double t_connexion = maintenant_ms();
+
+    const char *topics[] = { TOPIC_MESURE };
+    int echo = 0;
+    int err = mqtt_mini_subscribe(&c, topics, 1) ||
+              mqtt_mini_publish(&c, TOPIC_MESURE, "1", 1, false);
+    while (!err && !echo && maintenant_ms() - t0 < ECHO_DELAI_MS) {
+        err = mqtt_mini_loop(&c, 100, sur_message, &echo) < 0;
+    }
+    double t_publish = maintenant_ms();
+    bool reprise = mqtt_mini_session_reprise(&c);
+    mqtt_mini_close(&c);
+    if (err || !echo) return -1;
+
+    if (s->nb < MAX_MESURES) {
+        s->connexion_ms[s->nb] = t_connexion - t0;
+        s->publish_ms[s->nb] = t_publish - t0;
+        s->nb++;
+    }
+    if (reprise) s->reprises++;
+    return 0;
+}
+
+// ======================= RAPPORT =======================
+static int comparer(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void afficher(const char *nom, serie_t *s)
+{
+    if (!s->nb) {
+        printf("%-10s aucune mesure\n", nom);
+        return;
+    }
+    qsort(s->connexion_ms, s->nb, sizeof(double), comparer);
+    qsort(s->publish_ms, s->nb, sizeof(double), comparer);
+    printf("%-10s n=%-4d reprises=%-4d connexion med %7.2f ms max %7.2f | "
+           "premier publish med %7.2f ms max %7.2f\n",
+           nom, s->nb, s->reprises, s->connexion_ms[s->nb / 2], s->connexion_ms[s->nb - 1],
+           s->publish_ms[s->nb / 2], s->publish_ms[s->nb - 1]);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: tls_reprise [-h hote] [-p port] [-c ca.pem] [-n connexions] [-e] [-3]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *hote = "localhost";
+    const char *ca = NULL;
+    int port = 8883;
+    int n = 20;
+    bool ecdsa_seul = false, tls13 = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:c:n:e3")) != -1) {
+        switch (opt) {
+        case 'h': hote = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'c': ca = optarg; break;
+        case 'n': n = atoi(optarg); break;
+        case 'e': ecdsa_seul = true; break;
+        case '3': tls13 = true; break;
+        default: usage();
+        }
+    }
+    if (n < 2) usage();
+
+    mqtt_mini_tls_t *tls = mqtt_mini_tls_new(ca, ecdsa_seul, tls13);
+    if (!tls) return 1;
+
+    static serie_t complet, repris;
+    int echecs = 0;
+    for (int i = 0; i < n; i++) {
+        // Paire : sans ticket (comme après un redémarrage) ; impaire : ticket
+        // de la connexion précédente (comme après une coupure Wi-Fi)
+        bool avec_ticket = i % 2;
+        if (!avec_ticket) mqtt_mini_tls_oublier_session(tls);
+        if (mesurer(hote, port, tls, avec_ticket ? &repris : &complet) < 0) echecs++;
+    }
+    mqtt_mini_tls_free(tls);
+
+    printf("%s:%d, TLS %s%s\n", hote, port, tls13 ? "1.2/1.3" : "1.2", ecdsa_seul ? ", ECDSA seul" : "");
+    afficher("complet", &complet);
+    afficher("ticket", &repris);
+    if (echecs) printf("%d connexion(s) en échec\n", echecs);
+    return echecs == n;
+}